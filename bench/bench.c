@@ -0,0 +1,811 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/cjson.h"
+#include "../include/dynamic_array.h"
+
+// Encoder/decoder throughput over synthetic corpora built in memory. Every
+// corpus is one document shape, encoded and decoded over and over; a round
+// covers about --mb megabytes and the best of --rounds rounds is reported.
+//
+//   MB/s        document bytes per second
+//   ns/field    time per mapped value (struct member or array element)
+//   allocs/doc  allocator calls (alloc + realloc) per document
+//
+// Usage: cjson_bench [--csv] [--compare baseline.csv] [--threshold pct]
+//                    [--rounds n] [--mb n] [corpus...]
+// --csv prints one machine-readable row per measurement; saved to a file it is
+// the baseline that --compare reads. --compare exits with 1 when a measurement
+// lost more than --threshold percent of its MB/s or allocates more per document.
+
+#define BENCH_MAX_ROWS 64
+
+// --- Allocation counting ---
+
+// Installed with cjson_set_allocator, so only the library's allocations count.
+static size_t alloc_count = 0;
+
+static void *counting_alloc(void *ctx, t_size size)
+{
+  (void)ctx;
+  alloc_count++;
+  return malloc(size);
+}
+
+static void *counting_realloc(void *ctx, void *ptr, t_size size)
+{
+  (void)ctx;
+  alloc_count++;
+  return realloc(ptr, size);
+}
+
+static void counting_free(void *ctx, void *ptr)
+{
+  (void)ctx;
+  free(ptr);
+}
+
+// --- Corpora ---
+
+typedef struct
+{
+  const char *name;
+  t_json_model *model;
+  size_t size;    // instance size
+  void *instance; // encoded by the encode benchmark, NULL = decode only
+  char *json;     // decoded by the decode benchmark
+  size_t length;
+  size_t fields;  // mapped values per document
+} t_corpus;
+
+typedef struct
+{
+  char *data;
+  size_t length;
+  size_t capacity;
+} Buffer;
+
+static void *xcalloc(size_t count, size_t size)
+{
+  void *ptr = calloc(count, size);
+  if (!ptr)
+  {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+  return ptr;
+}
+
+static char *xstrdup(const char *text)
+{
+  size_t length = strlen(text) + 1;
+  return memcpy(xcalloc(length, 1), text, length);
+}
+
+static void buffer_append(Buffer *buffer, const char *text)
+{
+  size_t length = strlen(text);
+  if (buffer->length + length + 1 > buffer->capacity)
+  {
+    buffer->capacity = (buffer->length + length + 1) * 2;
+    buffer->data = (char *)realloc(buffer->data, buffer->capacity);
+    if (!buffer->data)
+    {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+    }
+  }
+  memcpy(buffer->data + buffer->length, text, length + 1);
+  buffer->length += length;
+}
+
+static Array *int_array(int count, int seed)
+{
+  Array *array = array_create(sizeof(int));
+  for (int i = 0; i < count; i++)
+  {
+    int value = (i * 7919 + seed) % 200003 - 100000;
+    array_add(array, &value);
+  }
+  return array;
+}
+
+static Array *double_array(int count, int seed)
+{
+  static const double scales[] = {1e-6, 0.01, 1.0, 1000.0, 1e9, 6.02e23};
+  Array *array = array_create(sizeof(double));
+  for (int i = 0; i < count; i++)
+  {
+    double value = ((i * 7919 + seed) % 10007 - 5003) / 7.0 * scales[i % 6];
+    array_add(array, &value);
+  }
+  return array;
+}
+
+// The encoder's output is the document, so decode reads exactly what encode writes.
+static void corpus_finish(t_corpus *corpus)
+{
+  corpus->json = cjson_encode(corpus->instance, corpus->model, false);
+  if (!corpus->json)
+  {
+    fprintf(stderr, "%s: encode failed\n", corpus->name);
+    exit(1);
+  }
+  corpus->length = strlen(corpus->json);
+}
+
+// Wide: one flat object with 64 scalar members of all four types.
+#define WIDE_PER_TYPE 16
+
+typedef struct
+{
+  int ints[WIDE_PER_TYPE];
+  double doubles[WIDE_PER_TYPE];
+  char *strings[WIDE_PER_TYPE];
+  bool bools[WIDE_PER_TYPE];
+} Wide;
+
+static void build_wide(t_corpus *corpus)
+{
+  static char names[WIDE_PER_TYPE * 4][16];
+  static t_reflect_field fields[WIDE_PER_TYPE * 4 + 1];
+  static t_json_field_config configs[WIDE_PER_TYPE * 4 + 1];
+  static const char *prefixes[] = {"count_", "ratio_", "label_", "enabled_"};
+  static const t_reflect_type types[] = {REFLECT_TYPE_INTEGER, REFLECT_TYPE_DOUBLE, REFLECT_TYPE_STRING, REFLECT_TYPE_BOOL};
+  static const size_t offsets[] = {offsetof(Wide, ints), offsetof(Wide, doubles), offsetof(Wide, strings), offsetof(Wide, bools)};
+  static const size_t sizes[] = {sizeof(int), sizeof(double), sizeof(char *), sizeof(bool)};
+
+  for (int t = 0; t < 4; t++)
+  {
+    for (int i = 0; i < WIDE_PER_TYPE; i++)
+    {
+      int n = t * WIDE_PER_TYPE + i;
+      snprintf(names[n], sizeof(names[n]), "%s%d", prefixes[t], i);
+      fields[n] = (t_reflect_field){names[n], types[t], offsets[t] + sizes[t] * i, NULL};
+      configs[n] = (t_json_field_config){names[n], NULL, false};
+    }
+  }
+
+  Wide *wide = xcalloc(1, sizeof(Wide));
+  for (int i = 0; i < WIDE_PER_TYPE; i++)
+  {
+    char text[32];
+    wide->ints[i] = i * 1234567 - 7000000;
+    wide->doubles[i] = i * 3.25 - 11.5;
+    snprintf(text, sizeof(text), "value-%d", i);
+    wide->strings[i] = xstrdup(text);
+    wide->bools[i] = i % 3 == 0;
+  }
+
+  corpus->model = cjson_create_model("Wide", sizeof(Wide), fields, configs);
+  corpus->size = sizeof(Wide);
+  corpus->instance = wide;
+  corpus->fields = WIDE_PER_TYPE * 4;
+  corpus_finish(corpus);
+}
+
+// Deep: a chain of nested objects.
+#define DEEP_LEVELS 48
+
+typedef struct s_node
+{
+  int level;
+  char *name;
+  double weight;
+  struct s_node *child;
+} Node;
+
+static t_reflect_field node_fields[] = {
+    {"level", REFLECT_TYPE_INTEGER, REFLECT_OFFSET(Node, level), NULL},
+    {"name", REFLECT_TYPE_STRING, REFLECT_OFFSET(Node, name), NULL},
+    {"weight", REFLECT_TYPE_DOUBLE, REFLECT_OFFSET(Node, weight), NULL},
+    {"child", REFLECT_TYPE_OBJECT, REFLECT_OFFSET(Node, child), NULL},
+    NO_MORE_FIELDS};
+
+static t_json_field_config node_json_fields[] = {
+    {"level", NULL, false},
+    {"name", NULL, false},
+    {"weight", NULL, false},
+    {"child", NULL, false},
+    NO_MORE_FIELDS};
+
+static void build_deep(t_corpus *corpus)
+{
+  Node *root = NULL;
+  for (int level = DEEP_LEVELS - 1; level >= 0; level--)
+  {
+    char text[32];
+    Node *node = xcalloc(1, sizeof(Node));
+    node->level = level;
+    snprintf(text, sizeof(text), "node-%d", level);
+    node->name = xstrdup(text);
+    node->weight = level / 8.0;
+    node->child = root;
+    root = node;
+  }
+
+  corpus->model = cjson_create_model("Node", sizeof(Node), node_fields, node_json_fields);
+  cjson_register_child(corpus->model, "child", corpus->model);
+  corpus->size = sizeof(Node);
+  corpus->instance = root;
+  corpus->fields = DEEP_LEVELS * 4;
+  corpus_finish(corpus);
+}
+
+// Strings: long text with escapes and multi-byte UTF-8.
+#define STRING_LINES 64
+
+typedef struct
+{
+  char *title;
+  char *body;
+  Array *lines;
+} Text;
+
+static t_reflect_field text_fields[] = {
+    {"title", REFLECT_TYPE_STRING, REFLECT_OFFSET(Text, title), NULL},
+    {"body", REFLECT_TYPE_STRING, REFLECT_OFFSET(Text, body), NULL},
+    {"lines", REFLECT_TYPE_ARRAY_STRING, REFLECT_OFFSET(Text, lines), NULL},
+    NO_MORE_FIELDS};
+
+static t_json_field_config text_json_fields[] = {
+    {"title", NULL, false},
+    {"body", NULL, false},
+    {"lines", NULL, false},
+    NO_MORE_FIELDS};
+
+static void build_strings(t_corpus *corpus)
+{
+  static const char *pieces[] = {
+      "Lorem ipsum dolor sit amet, consectetur adipiscing elit. ",
+      "She said \"hello\" and left a C:\\path\\to\\file behind.\n",
+      "Caf\xc3\xa9 cr\xc3\xa8me br\xc3\xbbl\xc3\xa9" "e, \xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e, \xf0\x9f\x98\x80. ",
+      "tab\tseparated\tcolumns\tand a bell-free line. "};
+
+  Text *text = xcalloc(1, sizeof(Text));
+  Buffer body = {NULL, 0, 0};
+  for (int i = 0; i < 32; i++)
+    buffer_append(&body, pieces[i % 4]);
+
+  text->title = xstrdup("A \"quoted\" title with \xc3\xbc" "nicode");
+  text->body = body.data;
+  text->lines = array_create(sizeof(char *));
+  for (int i = 0; i < STRING_LINES; i++)
+  {
+    Buffer line = {NULL, 0, 0};
+    for (int j = 0; j <= i % 4; j++)
+      buffer_append(&line, pieces[(i + j) % 4]);
+    array_add(text->lines, &line.data);
+  }
+
+  corpus->model = cjson_create_model("Text", sizeof(Text), text_fields, text_json_fields);
+  corpus->size = sizeof(Text);
+  corpus->instance = text;
+  corpus->fields = 2 + STRING_LINES;
+  corpus_finish(corpus);
+}
+
+// Numbers: integer and double arrays over several magnitudes.
+#define NUMBER_COUNT 512
+
+typedef struct
+{
+  int count;
+  double mean;
+  Array *ints;
+  Array *doubles;
+} Numbers;
+
+static t_reflect_field numbers_fields[] = {
+    {"count", REFLECT_TYPE_INTEGER, REFLECT_OFFSET(Numbers, count), NULL},
+    {"mean", REFLECT_TYPE_DOUBLE, REFLECT_OFFSET(Numbers, mean), NULL},
+    {"ints", REFLECT_TYPE_ARRAY_INT, REFLECT_OFFSET(Numbers, ints), NULL},
+    {"doubles", REFLECT_TYPE_ARRAY_DOUBLE, REFLECT_OFFSET(Numbers, doubles), NULL},
+    NO_MORE_FIELDS};
+
+static t_json_field_config numbers_json_fields[] = {
+    {"count", NULL, false},
+    {"mean", NULL, false},
+    {"ints", NULL, false},
+    {"doubles", NULL, false},
+    NO_MORE_FIELDS};
+
+static void build_numbers(t_corpus *corpus)
+{
+  Numbers *numbers = xcalloc(1, sizeof(Numbers));
+  numbers->count = NUMBER_COUNT * 2;
+  numbers->mean = 0.1 + 0.2;
+  numbers->ints = int_array(NUMBER_COUNT, 17);
+  numbers->doubles = double_array(NUMBER_COUNT, 29);
+
+  corpus->model = cjson_create_model("Numbers", sizeof(Numbers), numbers_fields, numbers_json_fields);
+  corpus->size = sizeof(Numbers);
+  corpus->instance = numbers;
+  corpus->fields = 2 + NUMBER_COUNT * 2;
+  corpus_finish(corpus);
+}
+
+// Objects: a large REFLECT_TYPE_ARRAY_OBJECT of small records. Structs: the
+// same document with the records stored contiguously (CJSON_TYPE_ARRAY_STRUCT).
+#define ORDER_ITEMS 2000
+
+typedef struct
+{
+  int id;
+  int quantity;
+  double price;
+  char *sku;
+  bool active;
+} Item;
+
+typedef struct
+{
+  char *customer;
+  Array *items;
+} Order;
+
+static t_reflect_field item_fields[] = {
+    {"id", REFLECT_TYPE_INTEGER, REFLECT_OFFSET(Item, id), NULL},
+    {"quantity", REFLECT_TYPE_INTEGER, REFLECT_OFFSET(Item, quantity), NULL},
+    {"price", REFLECT_TYPE_DOUBLE, REFLECT_OFFSET(Item, price), NULL},
+    {"sku", REFLECT_TYPE_STRING, REFLECT_OFFSET(Item, sku), NULL},
+    {"active", REFLECT_TYPE_BOOL, REFLECT_OFFSET(Item, active), NULL},
+    NO_MORE_FIELDS};
+
+static t_json_field_config item_json_fields[] = {
+    {"id", NULL, false},
+    {"quantity", "qty", false},
+    {"price", NULL, false},
+    {"sku", NULL, false},
+    {"active", NULL, false},
+    NO_MORE_FIELDS};
+
+static t_reflect_field order_fields[] = {
+    {"customer", REFLECT_TYPE_STRING, REFLECT_OFFSET(Order, customer), NULL},
+    {"items", REFLECT_TYPE_ARRAY_OBJECT, REFLECT_OFFSET(Order, items), NULL},
+    NO_MORE_FIELDS};
+
+static t_reflect_field order_struct_fields[] = {
+    {"customer", REFLECT_TYPE_STRING, REFLECT_OFFSET(Order, customer), NULL},
+    {"items", CJSON_FIELD_TYPE(CJSON_TYPE_ARRAY_STRUCT), REFLECT_OFFSET(Order, items), NULL},
+    NO_MORE_FIELDS};
+
+static t_json_field_config order_json_fields[] = {
+    {"customer", NULL, false},
+    {"items", NULL, false},
+    NO_MORE_FIELDS};
+
+static void build_order(t_corpus *corpus, bool contiguous)
+{
+  Order *order = xcalloc(1, sizeof(Order));
+  order->customer = xstrdup("ACME Corporation");
+  order->items = array_create(contiguous ? sizeof(Item) : sizeof(Item *));
+  for (int i = 0; i < ORDER_ITEMS; i++)
+  {
+    char sku[32];
+    Item *item = xcalloc(1, sizeof(Item));
+    item->id = 100000 + i;
+    item->quantity = i % 17 + 1;
+    item->price = (i % 1000) * 0.25 + 0.99;
+    snprintf(sku, sizeof(sku), "SKU-%06d-%c", i * 37 % 1000000, 'A' + i % 26);
+    item->sku = xstrdup(sku);
+    item->active = i % 5 != 0;
+    if (contiguous)
+    {
+      array_add(order->items, item);
+      free(item);
+    }
+    else
+    {
+      array_add(order->items, &item);
+    }
+  }
+
+  t_json_model *item_model = cjson_create_model("Item", sizeof(Item), item_fields, item_json_fields);
+  corpus->model = cjson_create_model("Order", sizeof(Order), contiguous ? order_struct_fields : order_fields,
+                                     order_json_fields);
+  cjson_register_child(corpus->model, "items", item_model);
+  corpus->size = sizeof(Order);
+  corpus->instance = order;
+  corpus->fields = 2 + ORDER_ITEMS * 5;
+  corpus_finish(corpus);
+}
+
+static void build_objects(t_corpus *corpus)
+{
+  build_order(corpus, false);
+}
+
+static void build_structs(t_corpus *corpus)
+{
+  build_order(corpus, true);
+}
+
+// Unmapped: about 95% of the bytes are members the model does not know, so
+// the decoder mostly steps over nested objects, arrays and long strings.
+#define UNMAPPED_RECORDS 2000
+
+typedef struct
+{
+  int id;
+  char *name;
+} Record;
+
+static t_reflect_field record_fields[] = {
+    {"id", REFLECT_TYPE_INTEGER, REFLECT_OFFSET(Record, id), NULL},
+    {"name", REFLECT_TYPE_STRING, REFLECT_OFFSET(Record, name), NULL},
+    NO_MORE_FIELDS};
+
+static t_json_field_config record_json_fields[] = {
+    {"id", NULL, false},
+    {"name", NULL, false},
+    NO_MORE_FIELDS};
+
+static void append_record(Buffer *buffer, int index)
+{
+  char line[512];
+
+  snprintf(line, sizeof(line), "{\"meta\":{\"source\":\"upstream-%d\",\"labels\":[\"a\",\"b}\",\"c]\"],\"score\":%d.25},",
+           index % 97, index);
+  buffer_append(buffer, line);
+  snprintf(line, sizeof(line), "\"id\":%d,", index);
+  buffer_append(buffer, line);
+  buffer_append(buffer, "\"history\":[[1,2,3],[4,5,6],{\"at\":1700000000,\"by\":\"svc\\\"x\\\"\",\"ok\":true,\"prev\":null}],");
+  buffer_append(buffer, "\"description\":\"Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod "
+                        "tempor incididunt ut labore et dolore magna aliqua {[\",");
+  snprintf(line, sizeof(line), "\"name\":\"r%d\",", index);
+  buffer_append(buffer, line);
+  buffer_append(buffer, "\"extra\":{\"a\":{\"b\":{\"c\":[\"deep\",{\"d\":[0.5,-1e10,false]}]}},\"flags\":[true,false,null]}}");
+}
+
+static void build_unmapped(t_corpus *corpus)
+{
+  Buffer buffer = {NULL, 0, 0};
+  append_record(&buffer, 42);
+
+  corpus->model = cjson_create_model("Record", sizeof(Record), record_fields, record_json_fields);
+  corpus->size = sizeof(Record);
+  corpus->json = buffer.data;
+  corpus->length = buffer.length;
+  corpus->fields = 2;
+}
+
+// The mapped members sit after one huge unmapped array.
+static void build_unmapped_large(t_corpus *corpus)
+{
+  Buffer buffer = {NULL, 0, 0};
+  buffer_append(&buffer, "{\"payload\":[");
+  for (int i = 0; i < UNMAPPED_RECORDS; i++)
+  {
+    if (i > 0)
+      buffer_append(&buffer, ",");
+    append_record(&buffer, i);
+  }
+  buffer_append(&buffer, "],\"id\":42,\"name\":\"document\"}");
+
+  corpus->model = cjson_create_model("Record", sizeof(Record), record_fields, record_json_fields);
+  corpus->size = sizeof(Record);
+  corpus->json = buffer.data;
+  corpus->length = buffer.length;
+  corpus->fields = 2;
+}
+
+static const struct
+{
+  const char *name;
+  void (*build)(t_corpus *corpus);
+} corpus_builders[] = {
+    {"wide", build_wide},
+    {"deep", build_deep},
+    {"strings", build_strings},
+    {"numbers", build_numbers},
+    {"objects", build_objects},
+    {"structs", build_structs},
+    {"unmapped", build_unmapped},
+    {"unmapped-large", build_unmapped_large},
+    {NULL, NULL}};
+
+// --- Measurement ---
+
+typedef struct
+{
+  char corpus[32];
+  char op[8];
+  size_t bytes; // per document
+  double mb_per_s;
+  double ns_per_field;
+  double allocs_per_doc;
+} t_row;
+
+static double now_seconds(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void fill_row(t_row *row, const t_corpus *corpus, const char *op, size_t docs, double seconds, size_t allocs)
+{
+  snprintf(row->corpus, sizeof(row->corpus), "%s", corpus->name);
+  snprintf(row->op, sizeof(row->op), "%s", op);
+  row->bytes = corpus->length;
+  row->mb_per_s = (double)corpus->length * docs / seconds / 1e6;
+  row->ns_per_field = seconds * 1e9 / ((double)docs * corpus->fields);
+  row->allocs_per_doc = (double)allocs / docs;
+}
+
+static void bench_encode(t_row *row, const t_corpus *corpus, size_t docs, int rounds)
+{
+  double best = 0;
+  size_t allocs = 0;
+
+  for (int round = 0; round < rounds; round++)
+  {
+    size_t before = alloc_count;
+    double start = now_seconds();
+    for (size_t i = 0; i < docs; i++)
+    {
+      char *json = cjson_encode(corpus->instance, corpus->model, false);
+      if (!json)
+      {
+        fprintf(stderr, "%s: encode failed\n", corpus->name);
+        exit(1);
+      }
+      free(json);
+    }
+    double elapsed = now_seconds() - start;
+
+    allocs = alloc_count - before;
+    if (round == 0 || elapsed < best)
+      best = elapsed;
+  }
+  fill_row(row, corpus, "encode", docs, best, allocs);
+}
+
+// Decodes into fresh instances; freeing them is not timed.
+static void bench_decode(t_row *row, const t_corpus *corpus, size_t docs, int rounds)
+{
+  char *instances = xcalloc(docs, corpus->size);
+  double best = 0;
+  size_t allocs = 0;
+
+  for (int round = 0; round < rounds; round++)
+  {
+    size_t before = alloc_count;
+    double start = now_seconds();
+    for (size_t i = 0; i < docs; i++)
+    {
+      if (cjson_decode_n(corpus->json, corpus->length, corpus->model, instances + i * corpus->size) != 0)
+      {
+        fprintf(stderr, "%s: decode failed\n", corpus->name);
+        exit(1);
+      }
+    }
+    double elapsed = now_seconds() - start;
+
+    allocs = alloc_count - before;
+    if (round == 0 || elapsed < best)
+      best = elapsed;
+
+    for (size_t i = 0; i < docs; i++)
+      cjson_free_instance(instances + i * corpus->size, corpus->model);
+    memset(instances, 0, docs * corpus->size);
+  }
+
+  free(instances);
+  fill_row(row, corpus, "decode", docs, best, allocs);
+}
+
+// Decoding the document and encoding the result again must give it back.
+static void check_round_trip(const t_corpus *corpus)
+{
+  void *instance = xcalloc(1, corpus->size);
+  if (cjson_decode_n(corpus->json, corpus->length, corpus->model, instance) != 0)
+  {
+    fprintf(stderr, "%s: decode failed\n", corpus->name);
+    exit(1);
+  }
+
+  if (corpus->instance)
+  {
+    char *json = cjson_encode(instance, corpus->model, false);
+    if (!json || strcmp(json, corpus->json) != 0)
+    {
+      fprintf(stderr, "%s: round trip changed the document\n", corpus->name);
+      exit(1);
+    }
+    free(json);
+  }
+  else if (((Record *)instance)->id != 42)
+  {
+    fprintf(stderr, "%s: mapped fields not decoded\n", corpus->name);
+    exit(1);
+  }
+
+  cjson_free_instance(instance, corpus->model);
+  free(instance);
+}
+
+// --- Output ---
+
+static void print_header(bool csv)
+{
+  if (csv)
+    printf("corpus,op,bytes,mb_per_s,ns_per_field,allocs_per_doc\n");
+  else
+    printf("%-16s %-6s %10s %10s %10s %11s\n", "corpus", "op", "bytes/doc", "MB/s", "ns/field", "allocs/doc");
+}
+
+static void print_row(const t_row *row, bool csv)
+{
+  if (csv)
+  {
+    printf("%s,%s,%zu,%.1f,%.2f,%.2f\n", row->corpus, row->op, row->bytes, row->mb_per_s, row->ns_per_field,
+           row->allocs_per_doc);
+    return;
+  }
+
+  printf("%-16s %-6s %10zu %10.1f %10.2f %11.2f\n", row->corpus, row->op, row->bytes, row->mb_per_s, row->ns_per_field,
+         row->allocs_per_doc);
+}
+
+static int load_baseline(const char *path, t_row *rows, int capacity)
+{
+  FILE *file = fopen(path, "r");
+  if (!file)
+  {
+    perror(path);
+    exit(1);
+  }
+
+  char line[256];
+  int count = 0;
+  while (fgets(line, sizeof(line), file) && count < capacity)
+  {
+    t_row *row = &rows[count];
+    if (sscanf(line, "%31[^,],%7[^,],%zu,%lf,%lf,%lf", row->corpus, row->op, &row->bytes, &row->mb_per_s,
+               &row->ns_per_field, &row->allocs_per_doc) == 6)
+      count++;
+  }
+  fclose(file);
+  return count;
+}
+
+// Prints every measurement next to its baseline; returns the number of regressions.
+static int compare_rows(const t_row *rows, int count, const t_row *baseline, int baseline_count, double threshold)
+{
+  int regressions = 0;
+
+  printf("%-16s %-6s %10s %10s %8s %11s %11s\n", "corpus", "op", "base MB/s", "MB/s", "change", "base allocs",
+         "allocs/doc");
+  for (int i = 0; i < count; i++)
+  {
+    const t_row *row = &rows[i];
+    const t_row *base = NULL;
+    for (int j = 0; j < baseline_count && !base; j++)
+    {
+      if (strcmp(baseline[j].corpus, row->corpus) == 0 && strcmp(baseline[j].op, row->op) == 0)
+        base = &baseline[j];
+    }
+
+    if (!base)
+    {
+      printf("%-16s %-6s %10s %10.1f %8s\n", row->corpus, row->op, "-", row->mb_per_s, "new");
+      continue;
+    }
+
+    double change = (row->mb_per_s - base->mb_per_s) / base->mb_per_s * 100.0;
+    bool slower = change < -threshold;
+    bool more_allocs = row->allocs_per_doc > base->allocs_per_doc + 0.005;
+
+    printf("%-16s %-6s %10.1f %10.1f %+7.1f%% %11.2f %11.2f%s\n", row->corpus, row->op, base->mb_per_s, row->mb_per_s,
+           change, base->allocs_per_doc, row->allocs_per_doc,
+           slower ? "  SLOWER" : more_allocs ? "  MORE ALLOCS" : "");
+    if (slower || more_allocs)
+      regressions++;
+  }
+  return regressions;
+}
+
+static bool selected(const char *name, char **names, int count)
+{
+  if (count == 0)
+    return true;
+  for (int i = 0; i < count; i++)
+  {
+    if (strcmp(names[i], name) == 0)
+      return true;
+  }
+  return false;
+}
+
+int main(int argc, char **argv)
+{
+  bool csv = false;
+  const char *baseline_path = NULL;
+  double threshold = 10.0;
+  int rounds = 5;
+  double megabytes = 8.0;
+  char **names = xcalloc(argc, sizeof(char *));
+  int name_count = 0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--csv") == 0)
+      csv = true;
+    else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc)
+      baseline_path = argv[++i];
+    else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+      threshold = atof(argv[++i]);
+    else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc)
+      rounds = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--mb") == 0 && i + 1 < argc)
+      megabytes = atof(argv[++i]);
+    else if (argv[i][0] != '-')
+      names[name_count++] = argv[i];
+    else
+    {
+      fprintf(stderr, "usage: %s [--csv] [--compare baseline.csv] [--threshold pct] [--rounds n] [--mb n] [corpus...]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (rounds < 1)
+    rounds = 1;
+
+  t_row rows[BENCH_MAX_ROWS];
+  int count = 0;
+
+  cjson_set_allocator(counting_alloc, counting_realloc, counting_free, NULL);
+
+  if (!baseline_path)
+    print_header(csv);
+
+  for (int b = 0; corpus_builders[b].name; b++)
+  {
+    if (!selected(corpus_builders[b].name, names, name_count))
+      continue;
+
+    t_corpus corpus = {0};
+    corpus.name = corpus_builders[b].name;
+    corpus_builders[b].build(&corpus);
+    check_round_trip(&corpus);
+
+    size_t docs = (size_t)(megabytes * 1e6 / corpus.length);
+    if (docs == 0)
+      docs = 1;
+
+    if (corpus.instance)
+    {
+      bench_encode(&rows[count], &corpus, docs, rounds);
+      if (!baseline_path)
+        print_row(&rows[count], csv);
+      count++;
+    }
+    bench_decode(&rows[count], &corpus, docs, rounds);
+    if (!baseline_path)
+      print_row(&rows[count], csv);
+    count++;
+
+    fflush(stdout);
+    // Corpus data (instances, models) is left to process exit.
+  }
+
+  if (baseline_path)
+  {
+    t_row baseline[BENCH_MAX_ROWS];
+    int baseline_count = load_baseline(baseline_path, baseline, BENCH_MAX_ROWS);
+    int regressions = compare_rows(rows, count, baseline, baseline_count, threshold);
+    if (regressions > 0)
+    {
+      printf("%d regression(s) beyond %.1f%%\n", regressions, threshold);
+      return 1;
+    }
+  }
+
+  free(names);
+  return 0;
+}
@@ -143,5 +143,10 @@ int main(void)
     printf("Pets: NULL (Error)\n");
   }
 
+  cjson_free_instance(decoded_user, user_model);
+  free(decoded_user);
+  cjson_model_free(user_model);
+  cjson_model_free(address_model);
+  cjson_model_free(pets_model);
   return 0;
 }
@@ -120,5 +120,8 @@ int main(void)
   free(dog);
   free(cat);
 
+  cjson_model_free(user_model);
+  cjson_model_free(address_model);
+  cjson_model_free(pets_model);
   return 0;
 }
@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// user_gen.h / user_gen.c are written by `make gen` from examples/user.schema.
+#include "user_gen.h"
+
+int main(void)
+{
+  const char *json_payload =
+      "{\n"
+      "  \"user_age\": 25,\n"
+      "  \"user_name\": \"John Doe\",\n"
+      "  \"user_pets\": [\n"
+      "    {\"pet_type\": \"Dog\", \"pet_name\": \"Rex\", \"pet_age\": 5},\n"
+      "    {\"pet_type\": \"Cat\", \"pet_name\": \"Felix\", \"pet_age\": 3}\n"
+      "  ],\n"
+      "  \"address\": {\n"
+      "    \"user_address_street\": \"Street Example\",\n"
+      "    \"user_address_county\": \"United States\",\n"
+      "    \"user_address_city\": \"Las Vegas\"\n"
+      "  }\n"
+      "}";
+
+  User user = {0};
+  if (decode_User(json_payload, strlen(json_payload), &user) != 0)
+  {
+    printf("decode_User failed\n");
+    return 1;
+  }
+
+  printf("--- Decoded by decode_User ---\n");
+  printf("Name: %s, Age: %d\n", user.name, user.age);
+  printf("Address: %s, %s\n", user.address.street, user.address.city);
+  if (user.pets)
+  {
+    for (t_size i = 0; i < user.pets->count; i++)
+    {
+      Pets *pet = &((Pets *)user.pets->data)[i];
+      printf("Pet %zu: %s (%s), %d\n", (size_t)i, pet->name, pet->type, pet->age);
+    }
+  }
+
+  char *json = encode_User(&user, true);
+  printf("\n--- Encoded by encode_User ---\n%s\n", json ? json : "NULL");
+  cjson_free(json);
+
+  free_User(&user);
+  return 0;
+}
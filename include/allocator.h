@@ -0,0 +1,55 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+#include <string.h>
+#include "../deps/creflect/reflection.h"
+
+// Heap memory used by the library. ctx is passed back on every call; realloc
+// and free are never handed a pointer from a different allocator.
+typedef void *(*t_json_alloc_fn)(void *ctx, t_size size);
+typedef void *(*t_json_realloc_fn)(void *ctx, void *ptr, t_size size);
+typedef void (*t_json_free_fn)(void *ctx, void *ptr);
+
+typedef struct s_json_allocator
+{
+  t_json_alloc_fn alloc;
+  t_json_realloc_fn realloc;
+  t_json_free_fn free;
+  void *ctx;
+} t_json_allocator;
+
+// Process-wide allocator (malloc/realloc/free until cjson_set_allocator).
+extern t_json_allocator json_global_allocator;
+
+// allocator may be NULL for the process-wide one.
+static inline void *allocator_alloc(const t_json_allocator *allocator, t_size size)
+{
+  if (!allocator)
+    allocator = &json_global_allocator;
+  return allocator->alloc(allocator->ctx, size);
+}
+
+static inline void *allocator_calloc(const t_json_allocator *allocator, t_size size)
+{
+  void *ptr = allocator_alloc(allocator, size);
+  if (ptr)
+    memset(ptr, 0, size);
+  return ptr;
+}
+
+static inline void *allocator_realloc(const t_json_allocator *allocator, void *ptr, t_size size)
+{
+  if (!allocator)
+    allocator = &json_global_allocator;
+  return allocator->realloc(allocator->ctx, ptr, size);
+}
+
+static inline void allocator_free(const t_json_allocator *allocator, void *ptr)
+{
+  if (!ptr)
+    return;
+  if (!allocator)
+    allocator = &json_global_allocator;
+  allocator->free(allocator->ctx, ptr);
+}
+
+#endif
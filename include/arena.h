@@ -0,0 +1,38 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <stddef.h>
+#include <stdbool.h>
+#include "../deps/creflect/reflection.h"
+
+#define ARENA_ALIGNMENT 16
+
+typedef struct s_arena_block
+{
+  struct s_arena_block *next;
+  t_size capacity; // bytes available after the header
+} t_arena_block;
+
+// Bump allocator. Memory comes first from the caller buffer, then (only when
+// block_size > 0) from malloc'd blocks that are kept across resets.
+typedef struct
+{
+  char *buffer; // block currently being carved
+  t_size capacity;
+  t_size offset;
+  char *first_buffer; // caller-supplied storage, may be NULL
+  t_size first_capacity;
+  t_arena_block *blocks;  // overflow blocks, in allocation order
+  t_arena_block *current; // overflow block in use, NULL while in first_buffer
+  t_size block_size;      // 0 = fixed arena, never calls malloc
+} t_json_arena;
+
+void arena_init(t_json_arena *arena, void *buffer, t_size capacity, t_size block_size);
+void *arena_alloc(t_json_arena *arena, t_size size);
+void *arena_calloc(t_json_arena *arena, t_size size);
+void arena_reset(t_json_arena *arena);
+void arena_destroy(t_json_arena *arena);
+// Moves every block src allocated from into arena, so data carved from src stays
+// valid and is released with arena. src must not use a caller buffer; it is left empty.
+bool arena_adopt(t_json_arena *arena, t_json_arena *src);
+
+#endif
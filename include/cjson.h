@@ -2,9 +2,92 @@
 #define CJSON_H
 #include <stdbool.h>
 #include "../deps/creflect/reflection.h"
+#include "./arena.h"
+#include "./allocator.h"
 
 #define NO_MORE_FIELDS {NULL, 0, 0}
 
+// Field kinds cjson handles on top of t_reflect_type, numbered past it. Put them in
+// t_reflect_field.type with CJSON_FIELD_TYPE; child_meta is the child model, as for
+// REFLECT_TYPE_OBJECT. Children are decoded in place instead of one calloc each.
+typedef enum
+{
+  CJSON_TYPE_STRUCT = 0x100, // child struct embedded by value; always encoded as an object
+  CJSON_TYPE_ARRAY_STRUCT,   // Array * of child structs stored contiguously (element_size = struct size)
+  CJSON_TYPE_INT8,           // int8_t .. uint64_t: out-of-range numbers fail the decode
+  CJSON_TYPE_INT16,
+  CJSON_TYPE_INT32,
+  CJSON_TYPE_INT64,
+  CJSON_TYPE_UINT8,
+  CJSON_TYPE_UINT16,
+  CJSON_TYPE_UINT32,
+  CJSON_TYPE_UINT64,
+  CJSON_TYPE_FLOAT,
+  CJSON_TYPE_CHARS,          // char[N] with N in the type (CJSON_FIELD_CHARS); NUL-terminated, no allocation
+  CJSON_TYPE_FIXED_ARRAY     // T[N] (CJSON_FIELD_ARRAY_OF), as returned by cjson_field_kind
+} t_json_field_kind;
+
+#define CJSON_FIELD_TYPE(kind) ((t_reflect_type)(kind))
+
+// t_reflect_field has no length slot, so char[N] and T[N] carry N in the type:
+// bits 0-9 hold the (element) kind, bit 10 flags a fixed array, the rest is N.
+#define CJSON_FIELD_KIND_MASK 0x3FF
+#define CJSON_FIELD_FIXED_ARRAY 0x400
+#define CJSON_FIELD_COUNT_SHIFT 11
+#define CJSON_FIELD_CHARS(capacity) \
+  ((t_reflect_type)(CJSON_TYPE_CHARS | ((unsigned long)(capacity) << CJSON_FIELD_COUNT_SHIFT)))
+// kind: any scalar (REFLECT_TYPE_INTEGER, REFLECT_TYPE_DOUBLE, REFLECT_TYPE_BOOL or
+// CJSON_TYPE_INT8 .. CJSON_TYPE_FLOAT); encoded as a JSON array of exactly count values.
+#define CJSON_FIELD_ARRAY_OF(kind, count) \
+  ((t_reflect_type)((kind) | CJSON_FIELD_FIXED_ARRAY | ((unsigned long)(count) << CJSON_FIELD_COUNT_SHIFT)))
+
+static inline int cjson_field_kind(t_reflect_type type)
+{
+  if ((unsigned long)type & CJSON_FIELD_FIXED_ARRAY)
+    return CJSON_TYPE_FIXED_ARRAY;
+  return (int)((unsigned long)type & CJSON_FIELD_KIND_MASK);
+}
+
+static inline int cjson_field_element_kind(t_reflect_type type)
+{
+  return (int)((unsigned long)type & CJSON_FIELD_KIND_MASK);
+}
+
+// N of char[N] / T[N]
+static inline t_size cjson_field_count(t_reflect_type type)
+{
+  return (t_size)((unsigned long)type >> CJSON_FIELD_COUNT_SHIFT);
+}
+
+// Bytes of one scalar of that kind, 0 for kinds that are not fixed-size scalars.
+static inline t_size cjson_scalar_size(int kind)
+{
+  switch (kind)
+  {
+  case REFLECT_TYPE_INTEGER:
+    return sizeof(int);
+  case REFLECT_TYPE_DOUBLE:
+    return sizeof(double);
+  case REFLECT_TYPE_BOOL:
+    return sizeof(bool);
+  case CJSON_TYPE_INT8:
+  case CJSON_TYPE_UINT8:
+    return 1;
+  case CJSON_TYPE_INT16:
+  case CJSON_TYPE_UINT16:
+    return 2;
+  case CJSON_TYPE_INT32:
+  case CJSON_TYPE_UINT32:
+  case CJSON_TYPE_FLOAT:
+    return 4;
+  case CJSON_TYPE_INT64:
+  case CJSON_TYPE_UINT64:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
 typedef struct
 {
   const char *field_name;      // reflection field name default
@@ -12,12 +95,42 @@ typedef struct
   bool ignore;                 // 0 false, 1 true : basically that field is a flag to show or not an information on json
 } t_json_field_config;
 
+typedef struct
+{
+  const char *name; // resolved json name (json_field_name or field_name), NULL for empty slot
+  t_size length;
+  t_size field_index;
+} t_json_key_slot;
+
+typedef struct
+{
+  t_size capacity; // power of two, 0 when the index could not be built
+  t_json_key_slot *slots;
+} t_json_key_index;
+
+typedef struct
+{
+  const char *text; // "name": with the key already escaped; NULL for ignored fields
+  t_size length;    // pretty form length; the compact form drops the trailing space
+} t_json_key_fragment;
+
 typedef struct
 {
   t_reflect_object *reflect;
   t_json_field_config *fields_config;
+  t_json_key_index key_index;          // hash table over json names, built by cjson_create_model
+  t_json_key_fragment *key_fragments;  // per field, parallel to reflect->fields
+  t_size encode_size_hint;             // initial JsonWriter capacity, grows to the largest output seen (capped at 64KB)
+  const struct s_json_program *program; // set by cjson_compile_model, NULL = interpreted
+  t_json_allocator allocator;          // process-wide allocator at creation; owns everything above
 } t_json_model;
 
+typedef struct
+{
+  const char *ptr; // points into the json input, not NUL-terminated
+  t_size length;
+} t_json_slice;
+
 typedef enum
 {
   JSON_TYPE_OBJECT,  // Começa com {
@@ -29,14 +142,103 @@ typedef enum
   JSON_TYPE_UNKNOWN  // Erro ou lixo
 } t_json_type;
 
-char *cjson_encode(void *data, t_json_model *model, bool pretty);
+// Resumable decoder fed with arbitrary chunks of one JSON object (see json_stream_decoder.c).
+typedef struct s_json_stream_decoder t_json_stream_decoder;
+
+// A decoded file; owns the mapping and every allocation of the decoded instance.
+typedef struct s_json_file t_json_file;
+
+// Byte spans of the top-level fields of a document, decoded on demand (see json_lazy.c).
+typedef struct s_json_lazy t_json_lazy;
+
+// Called once per NDJSON record; instance is reused and its strings and Arrays are
+// only valid until the callback returns. Return 0 to continue, non-zero to stop.
+typedef int (*t_json_record_fn)(void *ctx, void *instance, t_size record_index);
+
+// Receives encoded output in chunks; return 0 to continue, non-zero to abort.
+typedef int (*t_json_write_fn)(void *ctx, const char *data, t_size length);
+
+// Routes every heap allocation of the library (decoded strings, objects and Arrays,
+// encoder buffers, models) through alloc_fn/realloc_fn/free_fn; NULLs restore malloc.
+// Call it before anything else: memory must be released by the allocator it came from.
+void cjson_set_allocator(t_json_alloc_fn alloc_fn, t_json_realloc_fn realloc_fn, t_json_free_fn free_fn, void *ctx);
+
+char *cjson_encode(void *data, t_json_model *model, bool pretty); // NULL on allocation failure
+// Same as cjson_encode with the buffer from allocator (NULL = process-wide); release it there.
+char *cjson_encode_using(void *data, t_json_model *model, bool pretty, const t_json_allocator *allocator);
+// Encodes into buffer and NUL-terminates it. *out_length receives the JSON length
+// either way; returns -1 when buffer needs *out_length + 1 bytes and got fewer.
+int cjson_encode_to(char *buffer, t_size capacity, void *data, t_json_model *model, bool pretty, t_size *out_length);
+// Streams the output through write_fn in chunks of up to 4 KiB, without heap allocations.
+int cjson_encode_to_sink(t_json_write_fn write_fn, void *sink_ctx, void *data, t_json_model *model, bool pretty);
 int cjson_decode(const char *json, t_json_model *metadata_json, void *output_instance); // string -> object
+// Decodes exactly len bytes: json needs no terminator and nothing past json + len is read.
+int cjson_decode_n(const char *json, t_size len, t_json_model *model, void *instance);
+// Same as cjson_decode_n, allocating from allocator instead of the process-wide one.
+// Release the instance with cjson_free_instance_using and the same allocator.
+int cjson_decode_using(const char *json, t_size len, t_json_model *model, void *instance, const t_json_allocator *allocator);
+// Same as cjson_decode, but every string, child object and Array comes from the arena.
+// Release the whole document with arena_reset; never call cjson_free_instance on it.
+int cjson_decode_arena(const char *json, t_json_model *model, void *instance, t_json_arena *arena);
+// Incremental decoding: chunks may split anywhere, including inside strings and numbers.
+// feed/finish return -1 on malformed input or allocation failure; errors are sticky.
+t_json_stream_decoder *cjson_decoder_new(t_json_model *model, void *instance);
+int cjson_decoder_feed(t_json_stream_decoder *decoder, const char *chunk, t_size len);
+int cjson_decoder_finish(t_json_stream_decoder *decoder); // 0 once a complete object was decoded
+void cjson_decoder_free(t_json_stream_decoder *decoder);
+// Decode newline-delimited records one by one; blank lines are skipped. Returns -1 on a
+// malformed record, a read error or when the callback stops the walk.
+int cjson_decode_ndjson(const char *buffer, t_size length, t_json_model *model, t_json_record_fn callback, void *ctx);
+int cjson_decode_ndjson_fd(int fd, t_json_model *model, t_json_record_fn callback, void *ctx);
+struct s_array; // Array, see dynamic_array.h
+
+// Decode every object of a top-level array (or every NDJSON line) on nthreads threads,
+// 0 = one per online CPU. *out_array receives an Array of instance pointers in document
+// order; the Array, the instances and everything they own live in arena.
+int cjson_decode_array_parallel(const char *json, t_size len, t_json_model *model, int nthreads, struct s_array **out_array, t_json_arena *arena);
+int cjson_decode_ndjson_parallel(const char *buffer, t_size len, t_json_model *model, int nthreads, struct s_array **out_array, t_json_arena *arena);
+// Maps path read-only and decodes it into instance. Every string and Array is copied into an
+// arena owned by the returned handle, and the mapping is gone by the time this returns: release
+// the instance with cjson_file_close, never cjson_free_instance.
+t_json_file *cjson_decode_file(const char *path, t_json_model *model, void *instance); // NULL on error
+void cjson_file_close(t_json_file *file);
+int cjson_encode_file(const char *path, void *data, t_json_model *model, bool pretty); // buffered writes, -1 on error
+// Lazy decoding: only locates each mapped top-level field; cjson_get_field decodes it into
+// instance on first access and returns its address, or NULL when the key is absent or its
+// value is malformed. json must outlive the handle. Decoded values belong to instance
+// (cjson_free_instance); fields never asked for stay zeroed.
+t_json_lazy *cjson_decode_lazy(const char *json, t_size len, t_json_model *model, void *instance); // NULL on error
+void *cjson_get_field(t_json_lazy *lazy, const char *json_key);
+void cjson_lazy_free(t_json_lazy *lazy);
+// JSON Pointer lookup without a model: out receives the raw text of the value at pointer
+// ("" = the whole document, "/items/3/id"), strings with their quotes. Nothing is allocated;
+// returns -1 when the path does not exist or the document is malformed along it.
+int cjson_extract(const char *json, t_size len, const char *pointer, t_json_slice *out);
+// Typed reads of an extracted scalar; -1 when the slice holds another type or does not fit.
+int cjson_slice_to_int(const t_json_slice *slice, int *out);
+int cjson_slice_to_double(const t_json_slice *slice, double *out);
+int cjson_slice_to_bool(const t_json_slice *slice, bool *out);
+// Unescapes a string slice into buffer, which needs slice->length - 1 bytes. Returns its length.
+int cjson_slice_to_string(const t_json_slice *slice, char *buffer, t_size capacity);
 char *parse_key(const char **cursor);
+int parse_key_slice(const char **cursor, const char *end, t_json_slice *out_key);
 
-void cjson_free(char *json_string);
+void cjson_free(char *json_string); // output of cjson_encode
 void cjson_free_instance(void *instance, t_json_model *model);
+void cjson_free_instance_using(void *instance, t_json_model *model, const t_json_allocator *allocator);
 
 t_json_model *cjson_create_model(const char *struct_name, t_size struct_size, t_reflect_field *fields, t_json_field_config *configs);
 bool cjson_register_child(t_json_model *parent_model, const char *child_field_name, t_json_model *child_model);
+t_reflect_field *cjson_model_find_field(t_json_model *model, const char *json_key, t_size length);
+// Flattens model and every child reachable from it into one compact program that
+// cjson_decode* and cjson_encode* then run instead of walking the reflection data.
+// Call it once the tree is complete (after cjson_register_child) and before sharing
+// the model between threads; compiling again rebuilds it. Returns -1 on allocation failure.
+int cjson_compile_model(t_json_model *model);
+// Releases what cjson_create_model and cjson_compile_model allocated for model, through
+// the allocator that was current when it was created. The field and config tables and
+// registered child models belong to the caller; free a child only once no model it is
+// registered in (compiled or not) is used anymore.
+void cjson_model_free(t_json_model *model);
 
 #endif
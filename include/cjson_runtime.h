@@ -0,0 +1,63 @@
+#ifndef CJSON_RUNTIME_H
+#define CJSON_RUNTIME_H
+#include "./cjson.h"
+#include "./dynamic_array.h"
+
+// Entry points for code emitted by tools/cjson_gen.c. Generated functions
+// decode and encode through the same value routines as cjson_decode and
+// cjson_encode, so both paths accept and produce exactly the same JSON.
+
+typedef struct s_decode_context t_json_decode_ctx;
+typedef struct s_json_writer t_json_writer;
+
+// Decodes the object at *cursor into instance; returns -1 when it is not an object.
+typedef int (*t_json_decode_fn)(t_json_decode_ctx *ctx, const char **cursor, void *instance);
+// Writes instance as an object; depth is its indentation level when pretty.
+typedef void (*t_json_encode_fn)(t_json_writer *w, const void *instance, bool pretty, int depth);
+
+// Like cjson_decode_n / cjson_encode, with a generated function as the root model.
+int cjson_decode_with(const char *json, t_size len, t_json_decode_fn fn, void *instance);
+char *cjson_encode_with(t_json_encode_fn fn, const void *instance, bool pretty); // NULL on allocation failure
+
+// Object walk: begin consumes '{'; key returns 1 with the next raw key and the
+// cursor on its value, 0 once the closing '}' is consumed, -1 on malformed input.
+int cjson_rt_object_begin(t_json_decode_ctx *ctx, const char **cursor);
+int cjson_rt_object_key(t_json_decode_ctx *ctx, const char **cursor, t_json_slice *key);
+
+// Field values. A value of the wrong JSON type is skipped and leaves the target
+// untouched; allocation failures and out-of-range numbers fail the whole decode.
+void cjson_rt_skip(t_json_decode_ctx *ctx, const char **cursor);
+void cjson_rt_int(t_json_decode_ctx *ctx, const char **cursor, int *target);
+void cjson_rt_double(t_json_decode_ctx *ctx, const char **cursor, double *target);
+void cjson_rt_string(t_json_decode_ctx *ctx, const char **cursor, char **target);
+void cjson_rt_bool(t_json_decode_ctx *ctx, const char **cursor, bool *target);
+void cjson_rt_int_array(t_json_decode_ctx *ctx, const char **cursor, Array **target);
+void cjson_rt_double_array(t_json_decode_ctx *ctx, const char **cursor, Array **target);
+void cjson_rt_string_array(t_json_decode_ctx *ctx, const char **cursor, Array **target);
+void cjson_rt_object(t_json_decode_ctx *ctx, const char **cursor, void **target, t_size size, t_json_decode_fn fn);
+void cjson_rt_object_array(t_json_decode_ctx *ctx, const char **cursor, Array **target, t_size size, t_json_decode_fn fn);
+void cjson_rt_struct(t_json_decode_ctx *ctx, const char **cursor, void *target, t_json_decode_fn fn); // in place
+void cjson_rt_struct_array(t_json_decode_ctx *ctx, const char **cursor, Array **target, t_size size, t_json_decode_fn fn);
+// kind is a CJSON_TYPE_* scalar (fixed arrays also take int, double and bool).
+void cjson_rt_number(t_json_decode_ctx *ctx, const char **cursor, void *target, int kind);
+void cjson_rt_chars(t_json_decode_ctx *ctx, const char **cursor, char *target, t_size capacity);
+void cjson_rt_fixed_array(t_json_decode_ctx *ctx, const char **cursor, void *target, int kind, t_size count);
+
+void cjson_rt_write_raw(t_json_writer *w, const char *text, t_size length);
+void cjson_rt_write_indent(t_json_writer *w, int depth);
+void cjson_rt_write_int(t_json_writer *w, int value);
+void cjson_rt_write_double(t_json_writer *w, double value);
+void cjson_rt_write_string(t_json_writer *w, const char *value); // escaped, NULL as null
+void cjson_rt_write_bool(t_json_writer *w, bool value);
+void cjson_rt_write_int_array(t_json_writer *w, const Array *values);
+void cjson_rt_write_double_array(t_json_writer *w, const Array *values);
+void cjson_rt_write_string_array(t_json_writer *w, const Array *values);
+void cjson_rt_write_object(t_json_writer *w, const void *child, t_json_encode_fn fn, bool pretty, int depth);
+void cjson_rt_write_object_array(t_json_writer *w, const Array *items, t_json_encode_fn fn, bool pretty, int depth);
+void cjson_rt_write_struct(t_json_writer *w, const void *child, t_json_encode_fn fn, bool pretty, int depth);
+void cjson_rt_write_struct_array(t_json_writer *w, const Array *items, t_json_encode_fn fn, bool pretty, int depth);
+void cjson_rt_write_number(t_json_writer *w, const void *value, int kind);
+void cjson_rt_write_chars(t_json_writer *w, const char *value, t_size capacity);
+void cjson_rt_write_fixed_array(t_json_writer *w, const void *values, int kind, t_size count);
+
+#endif
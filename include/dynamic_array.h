@@ -3,19 +3,76 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include "./cjson.h"
+#include "./arena.h"
 
-typedef struct
+// Elements that fit in this many bytes live inside the Array itself, so a
+// short array costs a single allocation (or none, for a pooled header).
+#define ARRAY_INLINE_BYTES 32
+
+typedef struct s_array
 {
   t_size element_size;
   t_size count;
   t_size capacity;
-  void *data;
+  void *data; // points at inline_data until the elements outgrow it
+  t_json_arena *arena; // NULL = heap owned, otherwise released with the arena
+  t_json_allocator allocator; // heap owned: copy of the allocator data lives in, alloc == NULL = process-wide
+  union
+  {
+    unsigned char bytes[ARRAY_INLINE_BYTES];
+    double align_double;
+    void *align_pointer;
+    long long align_long;
+  } inline_data;
 } Array;
 
 // Mudei de bool para Array* (Retorna o objeto criado)
 Array *array_create(t_size element_size);
+Array *array_create_in(t_json_arena *arena, t_size element_size);
+// allocator (NULL = process-wide) is copied into the Array, so it may be a temporary.
+Array *array_create_using(const t_json_allocator *allocator, t_size element_size);
 
 void array_add(Array *array, void *item_ptr);
 void array_free(Array *array);
 
+// Frees the calling thread's pooled Array headers now; other threads free theirs, through
+// the allocator each header came from, on their next create/free or at exit.
+void array_pool_release(void);
+
+// Room for at least capacity elements; -1 (array untouched) when out of memory.
+int array_reserve(Array *array, t_size capacity);
+// Appends count elements stored contiguously at items.
+int array_append(Array *array, const void *items, t_size count);
+// Doubles the capacity (at least 8 elements); used by the typed adds below.
+int array_grow(Array *array);
+// Appends one zero-filled element and returns its address, valid until the next
+// add; NULL when out of memory. For filling struct elements in place.
+void *array_add_zeroed(Array *array);
+
+// Typed appends for arrays created with sizeof(int), sizeof(double) and
+// sizeof(void *) elements: a store instead of a byte copy. -1 when out of memory.
+static inline int array_add_int(Array *array, int value)
+{
+  if (array->count == array->capacity && array_grow(array) != 0)
+    return -1;
+  ((int *)array->data)[array->count++] = value;
+  return 0;
+}
+
+static inline int array_add_double(Array *array, double value)
+{
+  if (array->count == array->capacity && array_grow(array) != 0)
+    return -1;
+  ((double *)array->data)[array->count++] = value;
+  return 0;
+}
+
+static inline int array_add_ptr(Array *array, void *value)
+{
+  if (array->count == array->capacity && array_grow(array) != 0)
+    return -1;
+  ((void **)array->data)[array->count++] = value;
+  return 0;
+}
+
 #endif
@@ -0,0 +1,103 @@
+#ifndef JSON_PROGRAM_H
+#define JSON_PROGRAM_H
+#include <stdint.h>
+#include <string.h>
+#include "./cjson.h"
+#include "./cjson_runtime.h"
+
+// A model compiled by cjson_compile_model: one program per reachable model,
+// all of them (instructions, key tables and key text included) in a single
+// allocation owned by the root model. Instructions follow field order and skip
+// ignored fields; child programs are resolved at compile time.
+
+typedef enum
+{
+  OP_INT,
+  OP_DOUBLE,
+  OP_STRING,
+  OP_BOOL,
+  OP_OBJECT,
+  OP_ARRAY_INT,
+  OP_ARRAY_DOUBLE,
+  OP_ARRAY_STRING,
+  OP_ARRAY_OBJECT,
+  OP_STRUCT,
+  OP_ARRAY_STRUCT,
+  OP_NUMBER,      // sized integers and float, the kind is in the instruction
+  OP_CHARS,
+  OP_FIXED_ARRAY,
+  OP_UNSUPPORTED
+} t_json_opcode;
+
+#define OP_FLAG_SHADOWED 1 // an earlier field has the same json name; never decoded into
+
+typedef struct s_json_program t_json_program;
+
+typedef struct
+{
+  uint8_t opcode;
+  uint8_t flags;
+  uint16_t key_length;
+  uint32_t offset;
+  uint32_t key_hash;
+  uint32_t fragment_length; // "name": with the trailing space (pretty form)
+  uint32_t count;           // OP_CHARS capacity, OP_FIXED_ARRAY length
+  uint16_t kind;            // OP_NUMBER field kind, OP_FIXED_ARRAY element kind
+  const char *key;          // raw json name
+  const char *fragment;     // encoder key text, escaped
+  const t_json_program *child; // object and struct opcodes, NULL when unregistered
+} t_json_instruction;
+
+struct s_json_program
+{
+  t_size size; // struct size
+  uint32_t count;
+  uint32_t table_mask;
+  const t_json_instruction *ops;
+  const uint16_t *table; // key hash -> instruction index + 1, 0 = empty
+};
+
+// What a child object is processed with: its model (interpreted), its compiled
+// program, or functions emitted by cjson_gen. Exactly one of them is set.
+typedef struct
+{
+  t_json_model *model;
+  const t_json_program *program;
+  t_json_decode_fn decode;
+  t_json_encode_fn encode;
+  t_size size; // struct size, for decode
+} t_json_child;
+
+// FNV-1a over the key, shared by the model key index and compiled programs.
+unsigned int hash_json_key(const char *key, t_size length);
+
+// Instruction for a raw json key. *expected is the instruction that follows the
+// previous match: keys usually arrive in field order, so it is tried first.
+static inline const t_json_instruction *program_find_key(const t_json_program *program, const char *key, t_size length, uint32_t *expected)
+{
+  if (*expected < program->count)
+  {
+    const t_json_instruction *op = &program->ops[*expected];
+    if (op->key_length == length && !(op->flags & OP_FLAG_SHADOWED) && memcmp(op->key, key, length) == 0)
+    {
+      (*expected)++;
+      return op;
+    }
+  }
+
+  uint32_t hash = hash_json_key(key, length);
+  uint32_t pos = hash & program->table_mask;
+  while (program->table[pos] != 0)
+  {
+    const t_json_instruction *op = &program->ops[program->table[pos] - 1];
+    if (op->key_hash == hash && op->key_length == length && memcmp(op->key, key, length) == 0)
+    {
+      *expected = program->table[pos];
+      return op;
+    }
+    pos = (pos + 1) & program->table_mask;
+  }
+  return NULL;
+}
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#define NUMBER_FORMAT_INT_MAX 21    // "-9223372036854775808" plus one spare byte
+#define NUMBER_FORMAT_DOUBLE_MAX 32 // "-1.2345678901234567e-308" with room to spare
+
+// Both write without a NUL terminator and return the number of bytes written.
+int format_int64(char *buffer, long long value);
+int format_uint64(char *buffer, unsigned long long value);
+
+// Shortest digits that read back to the same double (Grisu2). Non-finite
+// values have no JSON form and are written as null.
+int format_double(char *buffer, double value);
+// Shortest digits that read back to the same float.
+int format_float(char *buffer, float value);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef NUMBER_UTILS_H
+#define NUMBER_UTILS_H
+#include <stdbool.h>
+#include "../deps/creflect/reflection.h"
+
+typedef struct
+{
+  unsigned long long mantissa; // first 19 significant digits
+  long long exponent;          // value = mantissa * 10^exponent
+  bool negative;
+  bool is_integer; // no fraction and no exponent part
+  bool truncated;  // more than 19 significant digits were seen
+  const char *start;
+  const char *end;
+} t_json_number;
+
+// Scans a JSON number at *cursor without reading past end. Locale independent.
+// Returns 0 and advances the cursor, or -1 (cursor untouched) on malformed input.
+int scan_json_number(const char **cursor, const char *end, t_json_number *out);
+
+// Returns 0, or -1 when the value is not an integer or does not fit in a long long.
+int json_number_to_int64(const t_json_number *number, long long *out);
+
+// Converts to int, truncating a fractional value toward zero. Returns -1 when
+// the value does not fit in an int.
+int json_number_to_int(const t_json_number *number, int *out);
+// Same rules for any integer width: the value must land in [min, max] / [0, max].
+int json_number_to_int_range(const t_json_number *number, long long min, long long max, long long *out);
+int json_number_to_uint_range(const t_json_number *number, unsigned long long max, unsigned long long *out);
+
+// Correctly rounded conversion (round to nearest, ties to even).
+double json_number_to_double(const t_json_number *number);
+
+#endif
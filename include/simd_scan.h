@@ -0,0 +1,14 @@
+#ifndef SIMD_SCAN_H
+#define SIMD_SCAN_H
+
+// Returns the first byte in [p, end) that is '"', '\\' or a control byte
+// (< 0x20), or end when there is none. Loads never reach past end. Picks AVX2,
+// SSE2 or a scalar loop on first use; build with -DCJSON_NO_SIMD to force the
+// scalar loop.
+const char *scan_string_special_n(const char *p, const char *end);
+
+// First byte in [p, end) that is '"', '{', '}', '[' or ']', or end. Used to
+// cross the parts of a skipped container that lie between strings.
+const char *scan_container_special_n(const char *p, const char *end);
+
+#endif
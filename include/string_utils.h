@@ -1,12 +1,17 @@
 #ifndef STRING_UTILS_H
 #define STRING_UTILS_H
+#include <stddef.h>
 
-char peek_next(const char *text);
-char peek_current(const char *text);
-void consume_and_append(const char **text, char **out);
-int match_and_consume(const char **cursor, char expected);
+// end is one past the last readable byte; nothing at or beyond it is touched.
+char peek_next(const char *text, const char *end);
+char peek_current(const char *text, const char *end);
+void consume_and_append(const char **text, const char *end, char **out);
+int match_and_consume(const char **cursor, const char *end, char expected);
 char *get_string_buffer(int length);
-void skip_whitespace(const char **text);
-void consume_until_delimiter(const char **cursor, char **out, char delimiter);
+void skip_whitespace(const char **text, const char *end);
+void consume_until_delimiter(const char **cursor, const char *end, char **out, char delimiter);
+int unescape_json_string(const char *src, const char *end, char *out);
+// Same, writing at most capacity bytes; -2 when the decoded text does not fit.
+int unescape_json_string_n(const char *src, const char *end, char *out, size_t capacity);
 
 #endif
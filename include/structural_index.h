@@ -0,0 +1,55 @@
+#ifndef STRUCTURAL_INDEX_H
+#define STRUCTURAL_INDEX_H
+#include <stdint.h>
+#include "../deps/creflect/reflection.h"
+
+// Input bytes classified per refill; bounds the positions buffer below.
+#define STRUCTURAL_INDEX_WINDOW 4096
+
+// Stage 1 of the decoder: classifies the input 64 bytes at a time (AVX2,
+// SSE4.2 or scalar, picked at runtime) and records, in order, every position
+// a parser stops at outside of whitespace:
+//   - both quotes of every string (escaped quotes are content),
+//   - { } [ ] : , outside strings,
+//   - the first byte of every number or literal.
+// Nothing inside a string is recorded, so the entry after an opening quote is
+// its closing quote and the entry after any whitespace is the next token.
+// The index is built lazily one window at a time, so memory does not grow
+// with the input.
+typedef struct
+{
+  const char *input;
+  const char *end;
+  const char *classified; // next block to classify
+  uint64_t prev_in_string; // all ones while a string spans the block boundary
+  uint64_t prev_escaped;   // the next block's first byte is escaped
+  uint64_t prev_scalar;    // the last byte classified was part of an atom
+  const char *window;      // base of the positions below
+  uint32_t count;
+  uint32_t next;
+  uint32_t positions[STRUCTURAL_INDEX_WINDOW];
+} t_structural_index;
+
+void structural_index_init(t_structural_index *index, const char *input, const char *end);
+// Classifies further windows until an entry at or after from shows up.
+const char *structural_index_refill_next(t_structural_index *index, const char *from);
+
+// Elements of the array opening at open ('[' already indexed), counted from
+// the entries classified so far without moving the cursor. -1 when the array
+// does not close within max_entries entries of the current window.
+long structural_index_count_elements(const t_structural_index *index, const char *open, uint32_t max_entries);
+
+// First indexed position at or after from, or end. Calls must not go backwards.
+static inline const char *structural_index_next(t_structural_index *index, const char *from)
+{
+  while (index->next < index->count)
+  {
+    const char *position = index->window + index->positions[index->next];
+    if (position >= from)
+      return position;
+    index->next++;
+  }
+  return structural_index_refill_next(index, from);
+}
+
+#endif
@@ -3,21 +3,29 @@
 #include <string.h>
 #include "../include/cjson.h"
 #include "../include/dynamic_array.h"
+#include "../include/json_program.h"
 
 t_size count_fields(t_reflect_field *fields);
+static void build_key_index(t_json_model *model);
+void encoder_prepare_model(t_json_model *model);
+static void free_instance(void *instance, t_json_model *model, const t_json_allocator *allocator);
 
 t_json_model *cjson_create_model(const char *struct_name, t_size struct_size, t_reflect_field *fields, t_json_field_config *configs)
 {
   if (struct_name == NULL || struct_size <= 0 || fields == NULL || configs == NULL)
     return NULL;
 
-  t_json_model *model = (t_json_model *)calloc(1, sizeof(t_json_model));
+  t_json_model *model = (t_json_model *)allocator_calloc(NULL, sizeof(t_json_model));
   if (!model)
     return NULL;
+  model->allocator = json_global_allocator;
 
-  t_reflect_object *r_obj = (t_reflect_object *)calloc(1, sizeof(t_reflect_object));
+  t_reflect_object *r_obj = (t_reflect_object *)allocator_calloc(&model->allocator, sizeof(t_reflect_object));
   if (!r_obj)
+  {
+    allocator_free(&model->allocator, model);
     return NULL;
+  }
 
   r_obj->name = struct_name;
   r_obj->size = struct_size;
@@ -26,10 +34,129 @@ t_json_model *cjson_create_model(const char *struct_name, t_size struct_size, t_
 
   model->reflect = r_obj;
   model->fields_config = configs;
+  build_key_index(model);
+  encoder_prepare_model(model);
 
   return model;
 }
 
+void cjson_model_free(t_json_model *model)
+{
+  if (!model)
+    return;
+
+  // The allocator lives in the model, which goes last.
+  t_json_allocator allocator = model->allocator;
+  allocator_free(&allocator, (void *)model->program);
+  allocator_free(&allocator, model->key_fragments);
+  allocator_free(&allocator, model->key_index.slots);
+  allocator_free(&allocator, model->reflect);
+  allocator_free(&allocator, model);
+}
+
+static const char *resolve_json_name(t_json_field_config *config)
+{
+  return config->json_field_name != NULL ? config->json_field_name : config->field_name;
+}
+
+unsigned int hash_json_key(const char *key, t_size length)
+{
+  unsigned int hash = 2166136261u;
+  for (t_size i = 0; i < length; i++)
+  {
+    hash ^= (unsigned char)key[i];
+    hash *= 16777619u;
+  }
+  hash ^= (unsigned int)length;
+  hash ^= hash >> 15;
+  return hash;
+}
+
+// Open-addressed table over the visible json names, kept at most half full so
+// a lookup touches one or two slots. Duplicate names keep the first field, like
+// the old linear lookup did. Leaves the index empty (linear lookup) on OOM.
+static void build_key_index(t_json_model *model)
+{
+  t_json_key_index *index = &model->key_index;
+  index->capacity = 0;
+  index->slots = NULL;
+
+  t_size visible = 0;
+  for (t_size i = 0; i < model->reflect->field_count; i++)
+  {
+    if (!model->fields_config[i].ignore)
+      visible++;
+  }
+  if (visible == 0)
+    return;
+
+  t_size capacity = 1;
+  while (capacity < visible * 2)
+    capacity <<= 1;
+
+  t_json_key_slot *slots = (t_json_key_slot *)allocator_calloc(&model->allocator, capacity * sizeof(t_json_key_slot));
+  if (!slots)
+    return;
+
+  for (t_size i = 0; i < model->reflect->field_count; i++)
+  {
+    t_json_field_config *config = &model->fields_config[i];
+    if (config->ignore)
+      continue;
+
+    const char *name = resolve_json_name(config);
+    t_size length = strlen(name);
+    t_size pos = hash_json_key(name, length) & (capacity - 1);
+
+    while (slots[pos].name != NULL &&
+           !(slots[pos].length == length && memcmp(slots[pos].name, name, length) == 0))
+      pos = (pos + 1) & (capacity - 1);
+
+    if (slots[pos].name != NULL)
+      continue;
+
+    slots[pos].name = name;
+    slots[pos].length = length;
+    slots[pos].field_index = i;
+  }
+
+  index->capacity = capacity;
+  index->slots = slots;
+}
+
+t_reflect_field *cjson_model_find_field(t_json_model *model, const char *json_key, t_size length)
+{
+  if (model == NULL || json_key == NULL)
+    return NULL;
+
+  t_json_key_index *index = &model->key_index;
+  if (index->capacity > 0)
+  {
+    t_size pos = hash_json_key(json_key, length) & (index->capacity - 1);
+    while (index->slots[pos].name != NULL)
+    {
+      t_json_key_slot *slot = &index->slots[pos];
+      if (slot->length == length && memcmp(slot->name, json_key, length) == 0)
+        return &model->reflect->fields[slot->field_index];
+      pos = (pos + 1) & (index->capacity - 1);
+    }
+    return NULL;
+  }
+
+  for (t_size i = 0; i < model->reflect->field_count; i++)
+  {
+    t_json_field_config *config = &model->fields_config[i];
+    if (config->ignore)
+      continue;
+
+    const char *target_name = resolve_json_name(config);
+    if (strncmp(target_name, json_key, length) == 0 && target_name[length] == '\0')
+      return &model->reflect->fields[i];
+  }
+
+  return NULL;
+}
+
 t_size count_fields(t_reflect_field *fields)
 {
   t_size count = 0;
@@ -60,7 +187,22 @@ bool cjson_register_child(t_json_model *parent_model, const char *child_field_na
   return false;
 }
 
+void cjson_free(char *json_string)
+{
+  allocator_free(NULL, json_string);
+}
+
 void cjson_free_instance(void *instance, t_json_model *model)
+{
+  free_instance(instance, model, NULL);
+}
+
+void cjson_free_instance_using(void *instance, t_json_model *model, const t_json_allocator *allocator)
+{
+  free_instance(instance, model, allocator);
+}
+
+static void free_instance(void *instance, t_json_model *model, const t_json_allocator *allocator)
 {
   if (!instance || !model)
     return;
@@ -73,14 +215,14 @@ void cjson_free_instance(void *instance, t_json_model *model)
     t_reflect_field *field = &fields[i];
     void *field_ptr = (char *)instance + field->offset;
 
-    switch (field->type)
+    switch (cjson_field_kind(field->type))
     {
     case REFLECT_TYPE_STRING:
     {
       char **str_ptr = (char **)field_ptr;
       if (*str_ptr)
       {
-        free(*str_ptr);
+        allocator_free(allocator, *str_ptr);
         *str_ptr = NULL;
       }
       break;
@@ -97,7 +239,7 @@ void cjson_free_instance(void *instance, t_json_model *model)
         {
           if (strings[k])
           {
-            free(strings[k]);
+            allocator_free(allocator, strings[k]);
           }
         }
         array_free(arr);
@@ -111,8 +253,8 @@ void cjson_free_instance(void *instance, t_json_model *model)
       void **child_struct_ptr = (void **)field_ptr;
       if (*child_struct_ptr)
       {
-        cjson_free_instance(*child_struct_ptr, child_model);
-        free(*child_struct_ptr);
+        free_instance(*child_struct_ptr, child_model, allocator);
+        allocator_free(allocator, *child_struct_ptr);
         *child_struct_ptr = NULL;
       }
       break;
@@ -128,6 +270,42 @@ void cjson_free_instance(void *instance, t_json_model *model)
       }
       break;
     }
+    case REFLECT_TYPE_ARRAY_OBJECT:
+    {
+      t_json_model *child_model = (t_json_model *)field->child_meta;
+      Array **arr_ptr = (Array **)field_ptr;
+      if (*arr_ptr)
+      {
+        Array *arr = *arr_ptr;
+
+        void **items = (void **)arr->data;
+        for (t_size k = 0; k < arr->count; k++)
+        {
+          free_instance(items[k], child_model, allocator);
+          allocator_free(allocator, items[k]);
+        }
+        array_free(arr);
+        *arr_ptr = NULL;
+      }
+      break;
+    }
+    case CJSON_TYPE_STRUCT:
+      free_instance(field_ptr, (t_json_model *)field->child_meta, allocator);
+      break;
+    case CJSON_TYPE_ARRAY_STRUCT:
+    {
+      t_json_model *child_model = (t_json_model *)field->child_meta;
+      Array **arr_ptr = (Array **)field_ptr;
+      if (*arr_ptr)
+      {
+        Array *arr = *arr_ptr;
+        for (t_size k = 0; k < arr->count; k++)
+          free_instance((char *)arr->data + k * arr->element_size, child_model, allocator);
+        array_free(arr);
+        *arr_ptr = NULL;
+      }
+      break;
+    }
 
     default:
       break;
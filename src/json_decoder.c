@@ -3,37 +3,172 @@
 #include "../include/string_utils.h"
 #include "../include/cjson.h"
 #include "../include/dynamic_array.h"
+#include "../include/arena.h"
+#include "../include/simd_scan.h"
+#include "../include/number_utils.h"
+#include "../include/structural_index.h"
+#include "../include/json_program.h"
 #include <string.h>
+#include <stdint.h>
+#include <float.h>
 
-int parse_int(const char **cursor);
-double parse_double(const char **cursor);
-char *parse_string(const char **cursor);
-int parse_boolean(const char **cursor);
-
-void skip_json_value(const char **cursor);
-void parse_value(t_json_model *model, const char *json_key, const char **cursor, void *output_instance);
-t_json_type detect_json_type(const char *cursor);
+typedef struct s_decode_context
+{
+  const char *end;     // one past the last input byte
+  t_json_arena *arena; // NULL = every allocation goes to the heap
+  bool out_of_memory;
+  bool out_of_range; // a number did not fit its field
+  bool borrow_strings; // input is writable and outlives the instance (requires arena)
+  bool syntax_error;   // an array element could not be consumed
+  t_structural_index *index; // NULL = find token boundaries byte by byte
+  const t_json_allocator *allocator; // heap allocations when there is no arena, NULL = process-wide
+} t_decode_context;
+
+// Inputs from this size on may get a stage-1 structural index. It only pays
+// off when there is whitespace to jump over: on compact documents the byte
+// scanners are already cheaper than building the index.
+#ifndef CJSON_STRUCTURAL_INDEX_MIN
+#define CJSON_STRUCTURAL_INDEX_MIN (64 * 1024)
+#endif
+#define STRUCTURAL_INDEX_SAMPLE 256
+// Index entries scanned ahead to size an array before filling it.
+#define DECODER_PRESIZE_LOOKAHEAD 512
+// FLT_MAX plus half an ulp: doubles from here on round to an infinite float.
+#define FLOAT_OVERFLOW_LIMIT 3.4028235677973366e38
+
+int parse_int(t_decode_context *ctx, const char **cursor, int *out);
+int parse_double(t_decode_context *ctx, const char **cursor, double *out);
+static int parse_number_as(t_decode_context *ctx, const char **cursor, int kind, void *target);
+int _cjson_store_number(const t_json_number *number, int kind, void *target);
+char *parse_string(t_decode_context *ctx, const char **cursor);
+int get_json_string_length(const char *cursor, const char *end);
+int parse_boolean(const char **cursor, const char *end);
+
+void skip_json_value(t_decode_context *ctx, const char **cursor);
+void parse_value(t_decode_context *ctx, t_json_model *model, const t_json_slice *json_key, const char **cursor, void *output_instance);
+static void decode_field_value(t_decode_context *ctx, t_reflect_field *field, const char **cursor, void *output_instance);
+static int run_program(t_decode_context *ctx, const char **cursor, const t_json_program *program, void *instance);
+t_json_type detect_json_type(const char *cursor, const char *end);
 t_reflect_field *find_field_by_jsonkey(t_json_model *model, const char *json_key);
-int _cjson_decode_internal(const char **cursor, t_json_model *model, void *instance);
+int _cjson_decode_internal(t_decode_context *ctx, const char **cursor, t_json_model *model, void *instance);
+int _cjson_decode_range(const char *json, const char *end, t_json_model *model, void *instance, t_json_arena *arena, bool borrow_strings);
+int _cjson_locate_fields(const char *json, const char *end, t_json_model *model, t_json_slice *values);
+int _cjson_decode_field(const t_json_slice *value, t_reflect_field *field, void *instance);
+const char *_cjson_skip_value(const char *cursor, const char *end);
+static bool wants_structural_index(const char *json, const char *end);
+static int decode_document(t_decode_context *ctx, const char *json, t_json_model *model, void *instance);
+static int decode_child(t_decode_context *ctx, const char **cursor, const t_json_child *child, void *instance);
+
+static void *decoder_calloc(t_decode_context *ctx, t_size size)
+{
+  void *ptr = ctx->arena ? arena_calloc(ctx->arena, size) : allocator_calloc(ctx->allocator, size);
+  if (!ptr)
+    ctx->out_of_memory = true;
+  return ptr;
+}
 
-int get_json_string_length(const char *cursor)
+static Array *decoder_array_create(t_decode_context *ctx, t_size element_size)
 {
-  int length = 0;
+  Array *list = ctx->arena ? array_create_in(ctx->arena, element_size) : array_create_using(ctx->allocator, element_size);
+  if (!list)
+    ctx->out_of_memory = true;
+  return list;
+}
+
+// Sizes a freshly opened array (cursor just past '[') from the structural
+// index, when the closing bracket is already classified. Arrays that fit the
+// inline buffer are left alone.
+static void decoder_array_presize(t_decode_context *ctx, Array *list, const char *cursor)
+{
+  if (!ctx->index)
+    return;
 
-  while (*cursor != '\0' && *cursor != '"')
+  long elements = structural_index_count_elements(ctx->index, cursor - 1, DECODER_PRESIZE_LOOKAHEAD);
+  if (elements > (long)list->capacity && array_reserve(list, (t_size)elements) != 0)
+    ctx->out_of_memory = true;
+}
+
+static void decoder_skip_whitespace(t_decode_context *ctx, const char **cursor)
+{
+  const char *p = *cursor;
+  if (ctx->index && p < ctx->end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
   {
-    length++;
-    cursor++;
+    // Whitespace is never indexed, so the next entry is the next token.
+    *cursor = structural_index_next(ctx->index, p);
+    return;
   }
+  skip_whitespace(cursor, ctx->end);
+}
 
-  if (*cursor == '"')
-    return length;
-  return -1;
+// Raw length of the string whose opening quote was just consumed.
+static int decoder_string_length(t_decode_context *ctx, const char *start)
+{
+  if (ctx->index)
+  {
+    // Nothing inside a string is indexed: the next entry is the closing quote.
+    const char *close = structural_index_next(ctx->index, start);
+    if (close < ctx->end && *close == '"')
+      return (int)(close - start);
+  }
+  return get_json_string_length(start, ctx->end);
+}
+
+static int decoder_parse_key(t_decode_context *ctx, const char **cursor, t_json_slice *out_key)
+{
+  decoder_skip_whitespace(ctx, cursor);
+
+  if (!match_and_consume(cursor, ctx->end, '"'))
+    return -1;
+
+  const char *start = *cursor;
+  int length = decoder_string_length(ctx, start);
+  if (length < 0)
+    return -1;
+
+  out_key->ptr = start;
+  out_key->length = (t_size)length;
+  *cursor = start + length + 1;
+  return 0;
+}
+
+// An array element that leaves the cursor where it was can never be consumed;
+// stop there instead of spinning on it.
+static bool array_element_consumed(t_decode_context *ctx, const char *before, const char *after)
+{
+  if (after != before)
+    return true;
+  ctx->syntax_error = true;
+  return false;
+}
+
+// Raw length (escape sequences included) up to the closing quote, or -1 when
+// the string is not terminated before end.
+int get_json_string_length(const char *cursor, const char *end)
+{
+  const char *p = cursor;
+
+  for (;;)
+  {
+    p = scan_string_special_n(p, end);
+
+    if (p >= end)
+      return -1;
+    if (*p == '"')
+      return (int)(p - cursor);
+    if (*p == '\\')
+    {
+      if (p + 1 >= end)
+        return -1;
+      p += 2;
+      continue;
+    }
+    p++; // raw control byte, tolerated as content
+  }
 }
 
-t_json_type detect_json_type(const char *cursor)
+t_json_type detect_json_type(const char *cursor, const char *end)
 {
-  char c = peek_current(cursor);
+  char c = peek_current(cursor, end);
 
   if (c == '{')
     return JSON_TYPE_OBJECT;
@@ -59,412 +194,1219 @@ t_reflect_field *find_field_by_jsonkey(t_json_model *model, const char *json_key
   if (model == NULL || json_key == NULL)
     return NULL;
 
-  for (t_size i = 0; i < model->reflect->field_count; i++)
+  return cjson_model_find_field(model, json_key, strlen(json_key));
+}
+
+// Container bodies with an index: nothing inside strings is indexed, so every
+// bracket entry is structural and depth can be counted entry by entry.
+static const char *skip_container_indexed(t_decode_context *ctx, const char *p)
+{
+  t_size depth = 0;
+
+  while (p < ctx->end)
   {
-    t_json_field_config *config = &model->fields_config[i];
-    if (config->ignore)
-    {
-      continue;
-    }
+    p = structural_index_next(ctx->index, p);
+    if (p >= ctx->end)
+      break;
 
-    const char *target_name = config->field_name;
+    char c = *p++;
+    if (c == '{' || c == '[')
+      depth++;
+    else if ((c == '}' || c == ']') && --depth == 0)
+      return p;
+  }
+  return NULL;
+}
+
+// Same walk without an index: jumps from one quote or bracket to the next and
+// over string bodies with the SIMD scanners.
+static const char *skip_container(t_decode_context *ctx, const char *p)
+{
+  t_size depth = 0;
+
+  while (p < ctx->end)
+  {
+    p = scan_container_special_n(p, ctx->end);
+    if (p >= ctx->end)
+      break;
 
-    if (config->json_field_name != NULL)
+    char c = *p++;
+    if (c == '"')
     {
-      target_name = config->json_field_name;
+      int length = get_json_string_length(p, ctx->end);
+      if (length < 0)
+        break;
+      p += length + 1;
     }
-
-    if (strcmp(json_key, target_name) == 0)
+    else if (c == '{' || c == '[')
+    {
+      depth++;
+    }
+    else if (--depth == 0)
     {
-      return &model->reflect->fields[i];
+      return p;
     }
   }
-
   return NULL;
 }
 
-void skip_json_value(const char **cursor)
+// Steps over one value of any kind without allocating. Brackets are counted,
+// not matched against each other; a malformed container is caught by the
+// caller when the delimiter it expects is not there.
+void skip_json_value(t_decode_context *ctx, const char **cursor)
 {
-  if (peek_current(*cursor) == '"')
+  const char *end = ctx->end;
+  char c = peek_current(*cursor, end);
+
+  if (c == '"')
+  {
+    int length = decoder_string_length(ctx, *cursor + 1);
+    if (length < 0)
+      ctx->syntax_error = true;
+    *cursor = length < 0 ? end : *cursor + length + 2;
+    return;
+  }
+
+  if (c == '{' || c == '[')
   {
-    char *trash = parse_string(cursor);
-    if (trash)
-      free(trash);
+    const char *after = ctx->index ? skip_container_indexed(ctx, *cursor) : skip_container(ctx, *cursor);
+    if (after == NULL)
+      ctx->syntax_error = true;
+    *cursor = after ? after : end;
     return;
   }
 
-  while (**cursor != '\0' && **cursor != ',' && **cursor != '}' && **cursor != ']' &&
-         **cursor != ' ' && **cursor != '\n' && **cursor != '\t')
+  while (*cursor < end && **cursor != ',' && **cursor != '}' && **cursor != ']' &&
+         **cursor != ' ' && **cursor != '\n' && **cursor != '\t' && **cursor != '\r')
   {
     (*cursor)++;
   }
 }
 
-int cjson_decode(const char *json, t_json_model *model, void *instance)
+// skip_json_value for callers outside the decoder: the cursor past the value,
+// or NULL when a string or container is not terminated before end.
+const char *_cjson_skip_value(const char *cursor, const char *end)
 {
-  const char *cursor = json;
-  return _cjson_decode_internal(&cursor, model, instance);
+  t_decode_context ctx = {end, NULL, false, false, false, false, NULL, NULL};
+  skip_json_value(&ctx, &cursor);
+  return ctx.syntax_error ? NULL : cursor;
 }
 
-int _cjson_decode_internal(const char **cursor, t_json_model *model, void *instance)
+int cjson_decode(const char *json, t_json_model *model, void *instance)
 {
-  skip_whitespace(cursor);
-  if (!match_and_consume(cursor, '{'))
+  if (json == NULL)
     return -1;
+  return cjson_decode_n(json, strlen(json), model, instance);
+}
 
-  while (peek_current(*cursor) != '}' && **cursor != '\0')
-  {
-    skip_whitespace(cursor);
-    char *key = parse_key(cursor);
-    if (!key)
-      return -1;
-
-    skip_whitespace(cursor);
-    match_and_consume(cursor, ':');
-    skip_whitespace(cursor);
-
-    parse_value(model, key, cursor, instance);
+int cjson_decode_n(const char *json, t_size len, t_json_model *model, void *instance)
+{
+  if (json == NULL)
+    return -1;
 
-    free(key);
-    skip_whitespace(cursor);
-    match_and_consume(cursor, ',');
-  }
+  t_decode_context ctx = {json + len, NULL, false, false, false, false, NULL, NULL};
+  return decode_document(&ctx, json, model, instance);
+}
 
-  if (!match_and_consume(cursor, '}'))
+int cjson_decode_using(const char *json, t_size len, t_json_model *model, void *instance, const t_json_allocator *allocator)
+{
+  if (json == NULL)
     return -1;
-  return 0;
+
+  t_decode_context ctx = {json + len, NULL, false, false, false, false, NULL, allocator};
+  return decode_document(&ctx, json, model, instance);
 }
 
-char *parse_key(const char **cursor)
+int cjson_decode_arena(const char *json, t_json_model *model, void *instance, t_json_arena *arena)
 {
-  skip_whitespace(cursor);
-
-  if (!match_and_consume(cursor, '"'))
-    return NULL;
+  if (json == NULL || arena == NULL)
+    return -1;
 
-  char *key_name = get_string_buffer(100);
-  char *writer = key_name;
+  t_decode_context ctx = {json + strlen(json), arena, false, false, false, false, NULL, NULL};
+  return decode_document(&ctx, json, model, instance);
+}
 
-  consume_until_delimiter(cursor, &writer, '"');
-  return key_name;
+// Decodes one object that ends at or before end; the bytes after it need not be
+// NUL. Used by the parallel decoder on records found by its pre-scan, by the
+// file decoder and by the NDJSON decoders; the fd reader also lets escape-free
+// strings borrow from its buffer (only while no structural index is in use,
+// see decode_root).
+int _cjson_decode_range(const char *json, const char *end, t_json_model *model, void *instance, t_json_arena *arena, bool borrow_strings)
+{
+  t_decode_context ctx = {end, arena, false, false, borrow_strings && arena != NULL, false, NULL, NULL};
+  return decode_document(&ctx, json, model, instance);
 }
 
-void parse_value(t_json_model *model, const char *json_key, const char **cursor, void *output_instance)
+// Pretty-printed input: at least one byte in eight of the first ones is whitespace.
+static bool wants_structural_index(const char *json, const char *end)
 {
-  t_reflect_field *field = find_field_by_jsonkey(model, json_key);
-  t_json_type json_type = detect_json_type(*cursor);
+  if ((t_size)(end - json) < CJSON_STRUCTURAL_INDEX_MIN)
+    return false;
 
-  if (field == NULL)
+  t_size whitespace = 0;
+  const char *sample_end = json + STRUCTURAL_INDEX_SAMPLE < end ? json + STRUCTURAL_INDEX_SAMPLE : end;
+  for (const char *p = json; p < sample_end; p++)
   {
-    skip_json_value(cursor);
-    return;
+    if (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+      whitespace++;
   }
+  return whitespace * 8 >= (t_size)(sample_end - json);
+}
 
-  switch (field->type)
-  {
-  case REFLECT_TYPE_OBJECT:
-    if (json_type == JSON_TYPE_OBJECT)
-    {
-      t_json_model *child_model = (t_json_model *)field->child_meta;
-      if (!child_model)
-      {
-        skip_json_value(cursor);
-        return;
-      }
-
-      void **ptr_to_child_ptr = (void **)((char *)output_instance + field->offset);
-      t_size child_size = child_model->reflect->size;
-      void *child_instance = calloc(1, child_size);
-
-      *ptr_to_child_ptr = child_instance;
-      if (_cjson_decode_internal(cursor, child_model, child_instance) != 0)
-      {
-      }
-      break;
-    }
-    else
-    {
-      skip_json_value(cursor);
-      return;
-    }
-  case REFLECT_TYPE_ARRAY_INT:
+static int decode_root(t_decode_context *ctx, const char *json, const t_json_child *root, void *instance)
+{
+  t_structural_index index;
+  bool borrow_strings = ctx->borrow_strings;
+  if (wants_structural_index(json, ctx->end))
   {
-    if (json_type == JSON_TYPE_ARRAY)
-    {
-      if (!match_and_consume(cursor, '['))
-      {
-        skip_json_value(cursor);
-        return;
-      }
-
-      Array *list = array_create(sizeof(int));
-
-      while (**cursor != '\0' && peek_current(*cursor) != ']')
-      {
-        skip_whitespace(cursor);
-
-        int val = parse_int(cursor);
-        array_add(list, &val);
+    structural_index_init(&index, json, ctx->end);
+    ctx->index = &index;
+    // The index is classified lazily, one window at a time: a terminator
+    // written over a closing quote it has not reached yet flips its string
+    // parity for the rest of the input.
+    ctx->borrow_strings = false;
+  }
 
-        skip_whitespace(cursor);
-        match_and_consume(cursor, ',');
-      }
+  const char *cursor = json;
+  int status = decode_child(ctx, &cursor, root, instance);
+  ctx->index = NULL;
+  ctx->borrow_strings = borrow_strings;
 
-      match_and_consume(cursor, ']');
+  if (status != 0 || ctx->out_of_memory || ctx->out_of_range || ctx->syntax_error)
+    return -1;
+  return 0;
+}
 
-      Array **target_ptr = (Array **)((char *)output_instance + field->offset);
-      *target_ptr = list;
+static int decode_document(t_decode_context *ctx, const char *json, t_json_model *model, void *instance)
+{
+  t_json_child root = {model, model ? model->program : NULL, NULL, NULL, 0};
+  return decode_root(ctx, json, &root, instance);
+}
 
-      break;
-    }
-    else
-    {
-      skip_json_value(cursor);
-    }
-    break;
+// Walks the top-level object without decoding anything: values[i] receives the
+// span of the value of model field i, or stays untouched when the key is absent.
+// A repeated key keeps its last value, as in a full decode.
+int _cjson_locate_fields(const char *json, const char *end, t_json_model *model, t_json_slice *values)
+{
+  t_decode_context ctx = {end, NULL, false, false, false, false, NULL, NULL};
+  t_structural_index index;
+  if (wants_structural_index(json, end))
+  {
+    structural_index_init(&index, json, end);
+    ctx.index = &index;
   }
-  case REFLECT_TYPE_ARRAY_DOUBLE:
-    if (json_type == JSON_TYPE_ARRAY)
-    {
-      if (!match_and_consume(cursor, '['))
-      {
-        skip_json_value(cursor);
-        return;
-      }
 
-      Array *list = array_create(sizeof(double));
+  const char *cursor = json;
+  decoder_skip_whitespace(&ctx, &cursor);
+  if (!match_and_consume(&cursor, end, '{'))
+    return -1;
 
-      while (**cursor != '\0' && peek_current(*cursor) != ']')
-      {
-        skip_whitespace(cursor);
+  decoder_skip_whitespace(&ctx, &cursor);
+  if (match_and_consume(&cursor, end, '}'))
+    return 0;
 
-        double val = parse_double(cursor);
-        array_add(list, &val);
+  for (;;)
+  {
+    t_json_slice key;
+    if (decoder_parse_key(&ctx, &cursor, &key) != 0)
+      return -1;
 
-        skip_whitespace(cursor);
-        match_and_consume(cursor, ',');
-      }
+    decoder_skip_whitespace(&ctx, &cursor);
+    if (!match_and_consume(&cursor, end, ':'))
+      return -1;
+    decoder_skip_whitespace(&ctx, &cursor);
 
-      match_and_consume(cursor, ']');
-      Array **target_ptr = (Array **)((char *)output_instance + field->offset);
-      *target_ptr = list;
+    const char *value = cursor;
+    skip_json_value(&ctx, &cursor);
+    if (cursor == value || cursor >= end)
+      return -1;
 
-      break;
-    }
-    else
+    t_reflect_field *field = cjson_model_find_field(model, key.ptr, key.length);
+    if (field)
     {
-      skip_json_value(cursor);
+      t_size i = (t_size)(field - model->reflect->fields);
+      values[i].ptr = value;
+      values[i].length = (t_size)(cursor - value);
     }
-    break;
-
-  case REFLECT_TYPE_ARRAY_STRING:
-    if (json_type == JSON_TYPE_ARRAY)
-    {
-      if (!match_and_consume(cursor, '['))
-      {
-        skip_json_value(cursor);
-        return;
-      }
-
-      Array *list = array_create(sizeof(char *));
 
-      while (**cursor != '\0' && peek_current(*cursor) != ']')
-      {
-        skip_whitespace(cursor);
-
-        char *value = parse_string(cursor);
-        array_add(list, &value);
+    decoder_skip_whitespace(&ctx, &cursor);
+    if (match_and_consume(&cursor, end, ','))
+      continue;
+    return match_and_consume(&cursor, end, '}') ? 0 : -1;
+  }
+}
 
-        skip_whitespace(cursor);
-        match_and_consume(cursor, ',');
-      }
+// Decodes one value found by _cjson_locate_fields into its field. Allocations
+// go to the heap, as with cjson_decode.
+int _cjson_decode_field(const t_json_slice *value, t_reflect_field *field, void *instance)
+{
+  t_decode_context ctx = {value->ptr + value->length, NULL, false, false, false, false, NULL, NULL};
+  const char *cursor = value->ptr;
 
-      match_and_consume(cursor, ']');
+  decode_field_value(&ctx, field, &cursor, instance);
+  if (ctx.out_of_memory || ctx.out_of_range || ctx.syntax_error)
+    return -1;
+  return 0;
+}
 
-      Array **target_ptr = (Array **)((char *)output_instance + field->offset);
-      *target_ptr = list;
-    }
-    else
-    {
-      skip_json_value(cursor);
-    }
-    break;
+int _cjson_decode_internal(t_decode_context *ctx, const char **cursor, t_json_model *model, void *instance)
+{
+  decoder_skip_whitespace(ctx, cursor);
+  if (!match_and_consume(cursor, ctx->end, '{'))
+    return -1;
 
-  case REFLECT_TYPE_ARRAY_OBJECT:
-    if (json_type == JSON_TYPE_ARRAY)
-    {
-      if (!match_and_consume(cursor, '['))
-      {
-        skip_json_value(cursor);
-        return;
-      }
+  while (peek_current(*cursor, ctx->end) != '}' && *cursor < ctx->end)
+  {
+    decoder_skip_whitespace(ctx, cursor);
+    t_json_slice key;
+    if (decoder_parse_key(ctx, cursor, &key) != 0)
+      return -1;
 
-      t_json_model *child_model = (t_json_model *)field->child_meta;
-      if (!child_model)
-      {
-        skip_json_value(cursor);
-        return;
-      }
+    decoder_skip_whitespace(ctx, cursor);
+    match_and_consume(cursor, ctx->end, ':');
+    decoder_skip_whitespace(ctx, cursor);
 
-      Array *list = array_create(sizeof(void *));
+    parse_value(ctx, model, &key, cursor, instance);
 
-      while (**cursor != '\0' && peek_current(*cursor) != ']')
-      {
-        skip_whitespace(cursor);
-        void *item_instance = calloc(1, child_model->reflect->size);
+    decoder_skip_whitespace(ctx, cursor);
+    match_and_consume(cursor, ctx->end, ',');
+  }
 
-        if (peek_current(*cursor) == '{')
-        {
-          _cjson_decode_internal(cursor, child_model, item_instance);
-        }
+  if (!match_and_consume(cursor, ctx->end, '}'))
+    return -1;
+  return 0;
+}
 
-        array_add(list, &item_instance);
+// Scans a quoted key in place: out_key points at the raw bytes between the
+// quotes (escape sequences are left as-is) and nothing is allocated.
+int parse_key_slice(const char **cursor, const char *end, t_json_slice *out_key)
+{
+  skip_whitespace(cursor, end);
 
-        skip_whitespace(cursor);
-        match_and_consume(cursor, ',');
-      }
+  if (!match_and_consume(cursor, end, '"'))
+    return -1;
 
-      match_and_consume(cursor, ']');
+  const char *start = *cursor;
+  int length = get_json_string_length(start, end);
+  if (length < 0)
+    return -1;
 
-      Array **target_ptr = (Array **)((char *)output_instance + field->offset);
-      *target_ptr = list;
-    }
-    else
-    {
-      skip_json_value(cursor);
-    }
-    break;
-  case REFLECT_TYPE_INTEGER:
-    if (json_type == JSON_TYPE_NUMBER)
-    {
-      int val = parse_int(cursor);
-      REFLECT_SET(output_instance, field->offset, int, val);
-    }
-    else
-    {
-      skip_json_value(cursor);
-    }
-    break;
+  out_key->ptr = start;
+  out_key->length = (t_size)length;
+  *cursor = start + length + 1;
+  return 0;
+}
 
-  case REFLECT_TYPE_DOUBLE:
-    if (json_type == JSON_TYPE_NUMBER)
-    {
-      double val = parse_double(cursor);
-      REFLECT_SET(output_instance, field->offset, double, val);
-    }
-    else
-    {
-      skip_json_value(cursor);
-    }
-    break;
+char *parse_key(const char **cursor)
+{
+  t_json_slice key;
+  if (*cursor == NULL || parse_key_slice(cursor, *cursor + strlen(*cursor), &key) != 0)
+    return NULL;
 
-  case REFLECT_TYPE_STRING:
-    if (json_type == JSON_TYPE_STRING)
-    {
-      char *val = parse_string(cursor);
-      REFLECT_SET(output_instance, field->offset, char *, val);
-    }
-    else
-    {
-      skip_json_value(cursor);
-    }
-    break;
+  char *key_name = get_string_buffer((int)key.length);
+  if (!key_name)
+    return NULL;
 
-  case REFLECT_TYPE_BOOL:
-    if (json_type == JSON_TYPE_BOOLEAN)
-    {
-      int val = parse_boolean(cursor);
-      if (val != -1)
-      {
-        REFLECT_SET(output_instance, field->offset, bool, val == 1);
-      }
-      else
-      {
-        skip_json_value(cursor);
-      }
-    }
-    else
-    {
-      skip_json_value(cursor);
-    }
-    break;
+  memcpy(key_name, key.ptr, key.length);
+  key_name[key.length] = '\0';
+  return key_name;
+}
 
-  default:
-    skip_json_value(cursor);
-    break;
+void parse_value(t_decode_context *ctx, t_json_model *model, const t_json_slice *json_key, const char **cursor, void *output_instance)
+{
+  t_reflect_field *field = cjson_model_find_field(model, json_key->ptr, json_key->length);
+  if (field == NULL)
+  {
+    skip_json_value(ctx, cursor);
+    return;
   }
+  decode_field_value(ctx, field, cursor, output_instance);
+}
+
+static int decode_child(t_decode_context *ctx, const char **cursor, const t_json_child *child, void *instance)
+{
+  if (child->program)
+    return run_program(ctx, cursor, child->program, instance);
+  if (child->decode)
+    return child->decode(ctx, cursor, instance);
+  return _cjson_decode_internal(ctx, cursor, child->model, instance);
 }
 
-double parse_double(const char **cursor)
+static t_size child_size(const t_json_child *child)
 {
-  char *endptr;
-  double val = strtod(*cursor, &endptr);
+  if (child->program)
+    return child->program->size;
+  return child->model ? child->model->reflect->size : child->size;
+}
 
-  *cursor = endptr;
-  return val;
+static bool child_known(const t_json_child *child)
+{
+  return child->model || child->program || child->decode;
 }
 
-int parse_int(const char **cursor)
+// The value helpers below serve the interpreted path, compiled programs and
+// generated code alike. A value of the wrong JSON type is skipped and leaves
+// the target untouched.
+
+static void decode_object_value(t_decode_context *ctx, const char **cursor, void **target, const t_json_child *child)
 {
-  char *endptr;
-  long val = strtol(*cursor, &endptr, 10);
+  if (detect_json_type(*cursor, ctx->end) != JSON_TYPE_OBJECT || !child_known(child))
+  {
+    skip_json_value(ctx, cursor);
+    return;
+  }
 
-  if (*endptr == '.')
+  void *child_instance = decoder_calloc(ctx, child_size(child));
+  if (!child_instance)
   {
-    double temp = strtod(*cursor, &endptr);
-    val = (long)temp;
+    skip_json_value(ctx, cursor);
+    return;
   }
 
-  *cursor = endptr;
-  return (int)val;
+  *target = child_instance;
+  decode_child(ctx, cursor, child, child_instance);
 }
 
-char *parse_string(const char **cursor)
+static void decode_int_array_value(t_decode_context *ctx, const char **cursor, Array **target)
 {
-  if (!match_and_consume(cursor, '"'))
-    return NULL;
-
-  int len = get_json_string_length(*cursor);
-  if (len < 0)
-    return NULL;
-
-  char *str = get_string_buffer(len + 1);
-  if (!str)
-    return NULL;
+  if (detect_json_type(*cursor, ctx->end) != JSON_TYPE_ARRAY || !match_and_consume(cursor, ctx->end, '['))
+  {
+    skip_json_value(ctx, cursor);
+    return;
+  }
 
-  char *writer = str;
+  Array *list = decoder_array_create(ctx, sizeof(int));
+  if (!list)
+  {
+    skip_json_value(ctx, cursor);
+    return;
+  }
+  decoder_array_presize(ctx, list, *cursor);
 
-  consume_until_delimiter(cursor, &writer, '"');
+  while (*cursor < ctx->end && peek_current(*cursor, ctx->end) != ']')
+  {
+    const char *element_start = *cursor;
+    decoder_skip_whitespace(ctx, cursor);
+
+    int val;
+    if (parse_int(ctx, cursor, &val) != 0)
+      skip_json_value(ctx, cursor);
+    else if (array_add_int(list, val) != 0)
+      ctx->out_of_memory = true;
+
+    decoder_skip_whitespace(ctx, cursor);
+    match_and_consume(cursor, ctx->end, ',');
+    if (!array_element_consumed(ctx, element_start, *cursor))
+      break;
+  }
 
-  return str;
+  match_and_consume(cursor, ctx->end, ']');
+  *target = list;
 }
 
-int parse_boolean(const char **cursor)
+static void decode_double_array_value(t_decode_context *ctx, const char **cursor, Array **target)
 {
-  if (peek_current(*cursor) == 't')
+  if (detect_json_type(*cursor, ctx->end) != JSON_TYPE_ARRAY || !match_and_consume(cursor, ctx->end, '['))
   {
-    if (match_and_consume(cursor, 't') &&
-        match_and_consume(cursor, 'r') &&
-        match_and_consume(cursor, 'u') &&
-        match_and_consume(cursor, 'e'))
-    {
-      return 1;
-    }
-    return -1;
+    skip_json_value(ctx, cursor);
+    return;
   }
 
-  if (peek_current(*cursor) == 'f')
+  Array *list = decoder_array_create(ctx, sizeof(double));
+  if (!list)
   {
-    if (match_and_consume(cursor, 'f') &&
-        match_and_consume(cursor, 'a') &&
-        match_and_consume(cursor, 'l') &&
-        match_and_consume(cursor, 's') &&
-        match_and_consume(cursor, 'e'))
-    {
-      return 0;
-    }
-    return -1;
+    skip_json_value(ctx, cursor);
+    return;
   }
+  decoder_array_presize(ctx, list, *cursor);
 
-  return -1;
+  while (*cursor < ctx->end && peek_current(*cursor, ctx->end) != ']')
+  {
+    const char *element_start = *cursor;
+    decoder_skip_whitespace(ctx, cursor);
+
+    double val;
+    if (parse_double(ctx, cursor, &val) != 0)
+      skip_json_value(ctx, cursor);
+    else if (array_add_double(list, val) != 0)
+      ctx->out_of_memory = true;
+
+    decoder_skip_whitespace(ctx, cursor);
+    match_and_consume(cursor, ctx->end, ',');
+    if (!array_element_consumed(ctx, element_start, *cursor))
+      break;
+  }
+
+  match_and_consume(cursor, ctx->end, ']');
+  *target = list;
+}
+
+static void decode_string_array_value(t_decode_context *ctx, const char **cursor, Array **target)
+{
+  if (detect_json_type(*cursor, ctx->end) != JSON_TYPE_ARRAY || !match_and_consume(cursor, ctx->end, '['))
+  {
+    skip_json_value(ctx, cursor);
+    return;
+  }
+
+  Array *list = decoder_array_create(ctx, sizeof(char *));
+  if (!list)
+  {
+    skip_json_value(ctx, cursor);
+    return;
+  }
+  decoder_array_presize(ctx, list, *cursor);
+
+  while (*cursor < ctx->end && peek_current(*cursor, ctx->end) != ']')
+  {
+    const char *element_start = *cursor;
+    decoder_skip_whitespace(ctx, cursor);
+
+    // The slot exists before the string is allocated, so the add cannot fail
+    // and leave the string owned by nobody.
+    if (list->count == list->capacity && array_grow(list) != 0)
+    {
+      ctx->out_of_memory = true;
+      break;
+    }
+    array_add_ptr(list, parse_string(ctx, cursor));
+
+    decoder_skip_whitespace(ctx, cursor);
+    match_and_consume(cursor, ctx->end, ',');
+    if (!array_element_consumed(ctx, element_start, *cursor))
+      break;
+  }
+
+  match_and_consume(cursor, ctx->end, ']');
+  *target = list;
+}
+
+static void decode_object_array_value(t_decode_context *ctx, const char **cursor, Array **target, const t_json_child *child)
+{
+  if (detect_json_type(*cursor, ctx->end) != JSON_TYPE_ARRAY || !match_and_consume(cursor, ctx->end, '['))
+  {
+    skip_json_value(ctx, cursor);
+    return;
+  }
+
+  if (!child_known(child))
+  {
+    (*cursor)--; // back onto '[' so the whole array is skipped
+    skip_json_value(ctx, cursor);
+    return;
+  }
+
+  Array *list = decoder_array_create(ctx, sizeof(void *));
+  if (!list)
+  {
+    skip_json_value(ctx, cursor);
+    return;
+  }
+  decoder_array_presize(ctx, list, *cursor);
+
+  t_size item_size = child_size(child);
+  while (*cursor < ctx->end && peek_current(*cursor, ctx->end) != ']')
+  {
+    const char *element_start = *cursor;
+    decoder_skip_whitespace(ctx, cursor);
+    // Same for the element: once decoded it may own strings and arrays, and
+    // compiled or generated children have no model to free them with.
+    if (list->count == list->capacity && array_grow(list) != 0)
+    {
+      ctx->out_of_memory = true;
+      break;
+    }
+    void *item_instance = decoder_calloc(ctx, item_size);
+    if (!item_instance)
+      break;
+    array_add_ptr(list, item_instance);
+
+    if (peek_current(*cursor, ctx->end) == '{')
+      decode_child(ctx, cursor, child, item_instance);
+
+    decoder_skip_whitespace(ctx, cursor);
+    match_and_consume(cursor, ctx->end, ',');
+    if (!array_element_consumed(ctx, element_start, *cursor))
+      break;
+  }
+
+  match_and_consume(cursor, ctx->end, ']');
+  *target = list;
+}
+
+// Embedded struct: decoded in place, nothing is allocated for the child itself.
+static void decode_struct_value(t_decode_context *ctx, const char **cursor, void *target, const t_json_child *child)
+{
+  if (detect_json_type(*cursor, ctx->end) != JSON_TYPE_OBJECT || !child_known(child))
+  {
+    skip_json_value(ctx, cursor);
+    return;
+  }
+  decode_child(ctx, cursor, child, target);
+}
+
+// Array of structs laid out back to back; each element is decoded where it lands.
+static void decode_struct_array_value(t_decode_context *ctx, const char **cursor, Array **target, const t_json_child *child)
+{
+  if (detect_json_type(*cursor, ctx->end) != JSON_TYPE_ARRAY || !match_and_consume(cursor, ctx->end, '['))
+  {
+    skip_json_value(ctx, cursor);
+    return;
+  }
+
+  if (!child_known(child))
+  {
+    (*cursor)--; // back onto '[' so the whole array is skipped
+    skip_json_value(ctx, cursor);
+    return;
+  }
+
+  Array *list = decoder_array_create(ctx, child_size(child));
+  if (!list)
+  {
+    skip_json_value(ctx, cursor);
+    return;
+  }
+  decoder_array_presize(ctx, list, *cursor);
+
+  while (*cursor < ctx->end && peek_current(*cursor, ctx->end) != ']')
+  {
+    const char *element_start = *cursor;
+    decoder_skip_whitespace(ctx, cursor);
+    void *item = array_add_zeroed(list);
+    if (!item)
+    {
+      ctx->out_of_memory = true;
+      break;
+    }
+
+    if (peek_current(*cursor, ctx->end) == '{')
+      decode_child(ctx, cursor, child, item);
+
+    decoder_skip_whitespace(ctx, cursor);
+    match_and_consume(cursor, ctx->end, ',');
+    if (!array_element_consumed(ctx, element_start, *cursor))
+      break;
+  }
+
+  match_and_consume(cursor, ctx->end, ']');
+  *target = list;
+}
+
+static void decode_int_value(t_decode_context *ctx, const char **cursor, int *target)
+{
+  int val;
+  if (detect_json_type(*cursor, ctx->end) == JSON_TYPE_NUMBER && parse_int(ctx, cursor, &val) == 0)
+    *target = val;
+  else
+    skip_json_value(ctx, cursor);
+}
+
+static void decode_double_value(t_decode_context *ctx, const char **cursor, double *target)
+{
+  double val;
+  if (detect_json_type(*cursor, ctx->end) == JSON_TYPE_NUMBER && parse_double(ctx, cursor, &val) == 0)
+    *target = val;
+  else
+    skip_json_value(ctx, cursor);
+}
+
+static void decode_number_value(t_decode_context *ctx, const char **cursor, int kind, void *target)
+{
+  if (detect_json_type(*cursor, ctx->end) != JSON_TYPE_NUMBER || parse_number_as(ctx, cursor, kind, target) != 0)
+    skip_json_value(ctx, cursor);
+}
+
+static void decode_string_value(t_decode_context *ctx, const char **cursor, char **target)
+{
+  if (detect_json_type(*cursor, ctx->end) == JSON_TYPE_STRING)
+    *target = parse_string(ctx, cursor);
+  else
+    skip_json_value(ctx, cursor);
+}
+
+static void decode_bool_value(t_decode_context *ctx, const char **cursor, bool *target)
+{
+  int val = -1;
+  if (detect_json_type(*cursor, ctx->end) == JSON_TYPE_BOOLEAN)
+    val = parse_boolean(cursor, ctx->end);
+
+  if (val != -1)
+    *target = val == 1;
+  else
+    skip_json_value(ctx, cursor);
+}
+
+static void decode_scalar_value(t_decode_context *ctx, const char **cursor, int kind, void *target)
+{
+  switch (kind)
+  {
+  case REFLECT_TYPE_INTEGER:
+    decode_int_value(ctx, cursor, (int *)target);
+    break;
+  case REFLECT_TYPE_DOUBLE:
+    decode_double_value(ctx, cursor, (double *)target);
+    break;
+  case REFLECT_TYPE_BOOL:
+    decode_bool_value(ctx, cursor, (bool *)target);
+    break;
+  default:
+    decode_number_value(ctx, cursor, kind, target);
+    break;
+  }
+}
+
+// char[capacity]: unescaped straight into the field and NUL-terminated. A string
+// that does not fit fails the decode instead of being cut short.
+static void decode_chars_value(t_decode_context *ctx, const char **cursor, char *target, t_size capacity)
+{
+  if (capacity == 0 || detect_json_type(*cursor, ctx->end) != JSON_TYPE_STRING)
+  {
+    skip_json_value(ctx, cursor);
+    return;
+  }
+
+  const char *start = *cursor + 1;
+  int raw_len = decoder_string_length(ctx, start);
+  if (raw_len < 0)
+  {
+    ctx->syntax_error = true;
+    *cursor = ctx->end;
+    return;
+  }
+
+  int len = unescape_json_string_n(start, start + raw_len, target, capacity - 1);
+  if (len < 0)
+  {
+    if (len == -2)
+      ctx->out_of_range = true;
+    else
+      ctx->syntax_error = true;
+    len = 0;
+  }
+  target[len] = '\0';
+  *cursor = start + raw_len + 1;
+}
+
+// T[count]: the array is zeroed first, so missing trailing values (and elements of
+// the wrong type) read as 0. More than count values fail the decode.
+static void decode_fixed_array_value(t_decode_context *ctx, const char **cursor, void *target, int kind, t_size count)
+{
+  t_size size = cjson_scalar_size(kind);
+  if (size == 0 || detect_json_type(*cursor, ctx->end) != JSON_TYPE_ARRAY || !match_and_consume(cursor, ctx->end, '['))
+  {
+    skip_json_value(ctx, cursor);
+    return;
+  }
+
+  memset(target, 0, size * count);
+  t_size index = 0;
+  while (*cursor < ctx->end && peek_current(*cursor, ctx->end) != ']')
+  {
+    const char *element_start = *cursor;
+    decoder_skip_whitespace(ctx, cursor);
+
+    if (index < count)
+      decode_scalar_value(ctx, cursor, kind, (char *)target + index * size);
+    else
+    {
+      ctx->out_of_range = true;
+      skip_json_value(ctx, cursor);
+    }
+    index++;
+
+    decoder_skip_whitespace(ctx, cursor);
+    match_and_consume(cursor, ctx->end, ',');
+    if (!array_element_consumed(ctx, element_start, *cursor))
+      break;
+  }
+
+  match_and_consume(cursor, ctx->end, ']');
+}
+
+static void decode_field_value(t_decode_context *ctx, t_reflect_field *field, const char **cursor, void *output_instance)
+{
+  void *target = (char *)output_instance + field->offset;
+  t_json_child child = {(t_json_model *)field->child_meta, NULL, NULL, NULL, 0};
+
+  switch (cjson_field_kind(field->type))
+  {
+  case REFLECT_TYPE_OBJECT:
+    decode_object_value(ctx, cursor, (void **)target, &child);
+    break;
+  case CJSON_TYPE_STRUCT:
+    decode_struct_value(ctx, cursor, target, &child);
+    break;
+  case CJSON_TYPE_ARRAY_STRUCT:
+    decode_struct_array_value(ctx, cursor, (Array **)target, &child);
+    break;
+  case REFLECT_TYPE_ARRAY_INT:
+    decode_int_array_value(ctx, cursor, (Array **)target);
+    break;
+  case REFLECT_TYPE_ARRAY_DOUBLE:
+    decode_double_array_value(ctx, cursor, (Array **)target);
+    break;
+  case REFLECT_TYPE_ARRAY_STRING:
+    decode_string_array_value(ctx, cursor, (Array **)target);
+    break;
+  case REFLECT_TYPE_ARRAY_OBJECT:
+    decode_object_array_value(ctx, cursor, (Array **)target, &child);
+    break;
+  case REFLECT_TYPE_INTEGER:
+    decode_int_value(ctx, cursor, (int *)target);
+    break;
+  case REFLECT_TYPE_DOUBLE:
+    decode_double_value(ctx, cursor, (double *)target);
+    break;
+  case REFLECT_TYPE_STRING:
+    decode_string_value(ctx, cursor, (char **)target);
+    break;
+  case REFLECT_TYPE_BOOL:
+    decode_bool_value(ctx, cursor, (bool *)target);
+    break;
+  case CJSON_TYPE_INT8:
+  case CJSON_TYPE_INT16:
+  case CJSON_TYPE_INT32:
+  case CJSON_TYPE_INT64:
+  case CJSON_TYPE_UINT8:
+  case CJSON_TYPE_UINT16:
+  case CJSON_TYPE_UINT32:
+  case CJSON_TYPE_UINT64:
+  case CJSON_TYPE_FLOAT:
+    decode_number_value(ctx, cursor, cjson_field_kind(field->type), target);
+    break;
+  case CJSON_TYPE_CHARS:
+    decode_chars_value(ctx, cursor, (char *)target, cjson_field_count(field->type));
+    break;
+  case CJSON_TYPE_FIXED_ARRAY:
+    decode_fixed_array_value(ctx, cursor, target, cjson_field_element_kind(field->type), cjson_field_count(field->type));
+    break;
+  default:
+    skip_json_value(ctx, cursor);
+    break;
+  }
+}
+
+static void run_instruction(t_decode_context *ctx, const t_json_instruction *op, const char **cursor, void *instance)
+{
+  void *target = (char *)instance + op->offset;
+  t_json_child child = {NULL, op->child, NULL, NULL, 0};
+
+  switch (op->opcode)
+  {
+  case OP_INT:
+    decode_int_value(ctx, cursor, (int *)target);
+    break;
+  case OP_DOUBLE:
+    decode_double_value(ctx, cursor, (double *)target);
+    break;
+  case OP_STRING:
+    decode_string_value(ctx, cursor, (char **)target);
+    break;
+  case OP_BOOL:
+    decode_bool_value(ctx, cursor, (bool *)target);
+    break;
+  case OP_OBJECT:
+    decode_object_value(ctx, cursor, (void **)target, &child);
+    break;
+  case OP_ARRAY_INT:
+    decode_int_array_value(ctx, cursor, (Array **)target);
+    break;
+  case OP_ARRAY_DOUBLE:
+    decode_double_array_value(ctx, cursor, (Array **)target);
+    break;
+  case OP_ARRAY_STRING:
+    decode_string_array_value(ctx, cursor, (Array **)target);
+    break;
+  case OP_ARRAY_OBJECT:
+    decode_object_array_value(ctx, cursor, (Array **)target, &child);
+    break;
+  case OP_STRUCT:
+    decode_struct_value(ctx, cursor, target, &child);
+    break;
+  case OP_ARRAY_STRUCT:
+    decode_struct_array_value(ctx, cursor, (Array **)target, &child);
+    break;
+  case OP_NUMBER:
+    decode_number_value(ctx, cursor, op->kind, target);
+    break;
+  case OP_CHARS:
+    decode_chars_value(ctx, cursor, (char *)target, op->count);
+    break;
+  case OP_FIXED_ARRAY:
+    decode_fixed_array_value(ctx, cursor, target, op->kind, op->count);
+    break;
+  default:
+    skip_json_value(ctx, cursor);
+    break;
+  }
+}
+
+// _cjson_decode_internal over a compiled program.
+static int run_program(t_decode_context *ctx, const char **cursor, const t_json_program *program, void *instance)
+{
+  decoder_skip_whitespace(ctx, cursor);
+  if (!match_and_consume(cursor, ctx->end, '{'))
+    return -1;
+
+  uint32_t expected = 0;
+  while (peek_current(*cursor, ctx->end) != '}' && *cursor < ctx->end)
+  {
+    decoder_skip_whitespace(ctx, cursor);
+    t_json_slice key;
+    if (decoder_parse_key(ctx, cursor, &key) != 0)
+      return -1;
+
+    decoder_skip_whitespace(ctx, cursor);
+    match_and_consume(cursor, ctx->end, ':');
+    decoder_skip_whitespace(ctx, cursor);
+
+    const t_json_instruction *op = program_find_key(program, key.ptr, key.length, &expected);
+    if (op)
+      run_instruction(ctx, op, cursor, instance);
+    else
+      skip_json_value(ctx, cursor);
+
+    decoder_skip_whitespace(ctx, cursor);
+    match_and_consume(cursor, ctx->end, ',');
+  }
+
+  if (!match_and_consume(cursor, ctx->end, '}'))
+    return -1;
+  return 0;
+}
+
+int parse_double(t_decode_context *ctx, const char **cursor, double *out)
+{
+  t_json_number number;
+  if (scan_json_number(cursor, ctx->end, &number) != 0)
+    return -1;
+
+  *out = json_number_to_double(&number);
+  return 0;
+}
+
+static int parse_number_as(t_decode_context *ctx, const char **cursor, int kind, void *target)
+{
+  t_json_number number;
+  if (scan_json_number(cursor, ctx->end, &number) != 0)
+    return -1;
+
+  if (_cjson_store_number(&number, kind, target) != 0)
+  {
+    ctx->out_of_range = true;
+    return -1;
+  }
+  return 0;
+}
+
+// Converts a number to the scalar kind (CJSON_TYPE_INT8 .. CJSON_TYPE_FLOAT) at target.
+// Returns -1, leaving target untouched, when the value is outside the kind's range.
+int _cjson_store_number(const t_json_number *number, int kind, void *target)
+{
+  long long value = 0;
+  unsigned long long unsigned_value = 0;
+  int status;
+  switch (kind)
+  {
+  case CJSON_TYPE_INT8:
+    status = json_number_to_int_range(number, INT8_MIN, INT8_MAX, &value);
+    break;
+  case CJSON_TYPE_INT16:
+    status = json_number_to_int_range(number, INT16_MIN, INT16_MAX, &value);
+    break;
+  case CJSON_TYPE_INT32:
+    status = json_number_to_int_range(number, INT32_MIN, INT32_MAX, &value);
+    break;
+  case CJSON_TYPE_INT64:
+    status = json_number_to_int_range(number, INT64_MIN, INT64_MAX, &value);
+    break;
+  case CJSON_TYPE_UINT8:
+    status = json_number_to_uint_range(number, UINT8_MAX, &unsigned_value);
+    break;
+  case CJSON_TYPE_UINT16:
+    status = json_number_to_uint_range(number, UINT16_MAX, &unsigned_value);
+    break;
+  case CJSON_TYPE_UINT32:
+    status = json_number_to_uint_range(number, UINT32_MAX, &unsigned_value);
+    break;
+  case CJSON_TYPE_UINT64:
+    status = json_number_to_uint_range(number, UINT64_MAX, &unsigned_value);
+    break;
+  case CJSON_TYPE_FLOAT:
+  {
+    double real = json_number_to_double(number);
+    status = real > -FLOAT_OVERFLOW_LIMIT && real < FLOAT_OVERFLOW_LIMIT ? 0 : -1;
+    if (status == 0)
+      *(float *)target = (float)real;
+    break;
+  }
+  default:
+    return -1;
+  }
+
+  if (status != 0)
+    return -1;
+
+  switch (kind)
+  {
+  case CJSON_TYPE_INT8:
+    *(int8_t *)target = (int8_t)value;
+    break;
+  case CJSON_TYPE_INT16:
+    *(int16_t *)target = (int16_t)value;
+    break;
+  case CJSON_TYPE_INT32:
+    *(int32_t *)target = (int32_t)value;
+    break;
+  case CJSON_TYPE_INT64:
+    *(int64_t *)target = (int64_t)value;
+    break;
+  case CJSON_TYPE_UINT8:
+    *(uint8_t *)target = (uint8_t)unsigned_value;
+    break;
+  case CJSON_TYPE_UINT16:
+    *(uint16_t *)target = (uint16_t)unsigned_value;
+    break;
+  case CJSON_TYPE_UINT32:
+    *(uint32_t *)target = (uint32_t)unsigned_value;
+    break;
+  case CJSON_TYPE_UINT64:
+    *(uint64_t *)target = (uint64_t)unsigned_value;
+    break;
+  }
+  return 0;
+}
+
+// Fractional values are truncated toward zero as before; anything outside the
+// int range is reported instead of being silently wrapped.
+int parse_int(t_decode_context *ctx, const char **cursor, int *out)
+{
+  t_json_number number;
+  if (scan_json_number(cursor, ctx->end, &number) != 0)
+    return -1;
+
+  if (json_number_to_int(&number, out) != 0)
+  {
+    ctx->out_of_range = true;
+    return -1;
+  }
+  return 0;
+}
+
+static char *decoder_string_alloc(t_decode_context *ctx, int length)
+{
+  if (ctx->arena)
+  {
+    char *str = (char *)arena_alloc(ctx->arena, length + 1);
+    if (!str)
+      ctx->out_of_memory = true;
+    return str;
+  }
+
+  char *str = (char *)allocator_alloc(ctx->allocator, length + 1);
+  if (!str)
+    ctx->out_of_memory = true;
+  return str;
+}
+
+char *parse_string(t_decode_context *ctx, const char **cursor)
+{
+  if (!match_and_consume(cursor, ctx->end, '"'))
+    return NULL;
+
+  const char *start = *cursor;
+  const char *special = scan_string_special_n(start, ctx->end);
+
+  // Common case: no escapes, so the first special byte is the closing quote.
+  if (special < ctx->end && *special == '"')
+  {
+    if (ctx->borrow_strings)
+    {
+      // The closing quote is never read again, so it becomes the terminator.
+      *(char *)special = '\0';
+      *cursor = special + 1;
+      return (char *)start;
+    }
+
+    int len = (int)(special - start);
+    char *str = decoder_string_alloc(ctx, len);
+    if (!str)
+      return NULL;
+
+    memcpy(str, start, len);
+    str[len] = '\0';
+    *cursor = special + 1;
+    return str;
+  }
+
+  int raw_len = decoder_string_length(ctx, start);
+  if (raw_len < 0)
+  {
+    ctx->syntax_error = true;
+    *cursor = ctx->end;
+    return NULL;
+  }
+
+  char *str = decoder_string_alloc(ctx, raw_len);
+  if (!str)
+    return NULL;
+
+  // A bad escape or surrogate fails the decode like any other malformed value.
+  int len = unescape_json_string(start, start + raw_len, str);
+  if (len < 0)
+  {
+    if (!ctx->arena)
+      allocator_free(ctx->allocator, str);
+    ctx->syntax_error = true;
+    *cursor = ctx->end;
+    return NULL;
+  }
+
+  str[len] = '\0';
+  *cursor = start + raw_len + 1;
+  return str;
+}
+
+int parse_boolean(const char **cursor, const char *end)
+{
+  if (peek_current(*cursor, end) == 't')
+  {
+    if (match_and_consume(cursor, end, 't') &&
+        match_and_consume(cursor, end, 'r') &&
+        match_and_consume(cursor, end, 'u') &&
+        match_and_consume(cursor, end, 'e'))
+    {
+      return 1;
+    }
+    return -1;
+  }
+
+  if (peek_current(*cursor, end) == 'f')
+  {
+    if (match_and_consume(cursor, end, 'f') &&
+        match_and_consume(cursor, end, 'a') &&
+        match_and_consume(cursor, end, 'l') &&
+        match_and_consume(cursor, end, 's') &&
+        match_and_consume(cursor, end, 'e'))
+    {
+      return 0;
+    }
+    return -1;
+  }
+
+  return -1;
+}
+
+int cjson_decode_with(const char *json, t_size len, t_json_decode_fn fn, void *instance)
+{
+  if (json == NULL || fn == NULL || instance == NULL)
+    return -1;
+
+  t_decode_context ctx = {json + len, NULL, false, false, false, false, NULL, NULL};
+  t_json_child root = {NULL, NULL, fn, NULL, 0};
+  return decode_root(&ctx, json, &root, instance);
+}
+
+int cjson_rt_object_begin(t_json_decode_ctx *ctx, const char **cursor)
+{
+  decoder_skip_whitespace(ctx, cursor);
+  return match_and_consume(cursor, ctx->end, '{') ? 0 : -1;
+}
+
+// Same leniency as _cjson_decode_internal: a missing ',' or ':' is tolerated.
+int cjson_rt_object_key(t_json_decode_ctx *ctx, const char **cursor, t_json_slice *key)
+{
+  decoder_skip_whitespace(ctx, cursor);
+  match_and_consume(cursor, ctx->end, ',');
+  decoder_skip_whitespace(ctx, cursor);
+
+  if (match_and_consume(cursor, ctx->end, '}'))
+    return 0;
+  if (decoder_parse_key(ctx, cursor, key) != 0)
+    return -1;
+
+  decoder_skip_whitespace(ctx, cursor);
+  match_and_consume(cursor, ctx->end, ':');
+  decoder_skip_whitespace(ctx, cursor);
+  return 1;
+}
+
+void cjson_rt_skip(t_json_decode_ctx *ctx, const char **cursor)
+{
+  skip_json_value(ctx, cursor);
+}
+
+void cjson_rt_int(t_json_decode_ctx *ctx, const char **cursor, int *target)
+{
+  decode_int_value(ctx, cursor, target);
+}
+
+void cjson_rt_double(t_json_decode_ctx *ctx, const char **cursor, double *target)
+{
+  decode_double_value(ctx, cursor, target);
+}
+
+void cjson_rt_string(t_json_decode_ctx *ctx, const char **cursor, char **target)
+{
+  decode_string_value(ctx, cursor, target);
+}
+
+void cjson_rt_bool(t_json_decode_ctx *ctx, const char **cursor, bool *target)
+{
+  decode_bool_value(ctx, cursor, target);
+}
+
+void cjson_rt_int_array(t_json_decode_ctx *ctx, const char **cursor, Array **target)
+{
+  decode_int_array_value(ctx, cursor, target);
+}
+
+void cjson_rt_double_array(t_json_decode_ctx *ctx, const char **cursor, Array **target)
+{
+  decode_double_array_value(ctx, cursor, target);
+}
+
+void cjson_rt_string_array(t_json_decode_ctx *ctx, const char **cursor, Array **target)
+{
+  decode_string_array_value(ctx, cursor, target);
+}
+
+void cjson_rt_object(t_json_decode_ctx *ctx, const char **cursor, void **target, t_size size, t_json_decode_fn fn)
+{
+  t_json_child child = {NULL, NULL, fn, NULL, size};
+  decode_object_value(ctx, cursor, target, &child);
+}
+
+void cjson_rt_object_array(t_json_decode_ctx *ctx, const char **cursor, Array **target, t_size size, t_json_decode_fn fn)
+{
+  t_json_child child = {NULL, NULL, fn, NULL, size};
+  decode_object_array_value(ctx, cursor, target, &child);
+}
+
+void cjson_rt_struct(t_json_decode_ctx *ctx, const char **cursor, void *target, t_json_decode_fn fn)
+{
+  t_json_child child = {NULL, NULL, fn, NULL, 0};
+  decode_struct_value(ctx, cursor, target, &child);
+}
+
+void cjson_rt_struct_array(t_json_decode_ctx *ctx, const char **cursor, Array **target, t_size size, t_json_decode_fn fn)
+{
+  t_json_child child = {NULL, NULL, fn, NULL, size};
+  decode_struct_array_value(ctx, cursor, target, &child);
+}
+
+void cjson_rt_number(t_json_decode_ctx *ctx, const char **cursor, void *target, int kind)
+{
+  decode_scalar_value(ctx, cursor, kind, target);
+}
+
+void cjson_rt_chars(t_json_decode_ctx *ctx, const char **cursor, char *target, t_size capacity)
+{
+  decode_chars_value(ctx, cursor, target, capacity);
+}
+
+void cjson_rt_fixed_array(t_json_decode_ctx *ctx, const char **cursor, void *target, int kind, t_size count)
+{
+  decode_fixed_array_value(ctx, cursor, target, kind, count);
 }
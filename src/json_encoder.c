@@ -1,133 +1,602 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stdarg.h>
+#include <stdint.h>
 #include "../include/cjson.h"
 #include "../include/dynamic_array.h"
+#include "../include/number_format.h"
+#include "../include/simd_scan.h"
+#include "../include/json_program.h"
 
-typedef struct
+typedef enum
+{
+  WRITER_GROWABLE, // heap buffer, doubled on demand
+  WRITER_FIXED,    // caller buffer, overflow only counted
+  WRITER_SINK      // fixed chunk, flushed to a callback when full
+} t_writer_mode;
+
+typedef struct s_json_writer
 {
   char *buffer;
   t_size length;
   t_size capacity;
+  t_writer_mode mode;
+  t_size total; // bytes produced so far, including those that did not fit
+  bool overflow;
+  bool failed; // out of memory or the sink reported an error
+  t_json_write_fn sink;
+  void *sink_ctx;
+  const t_json_allocator *allocator; // growable buffer, NULL = process-wide
 } JsonWriter;
 
-static void writer_init(JsonWriter *w)
+#define WRITER_MIN_CAPACITY 64
+#define WRITER_SINK_CHUNK 4096
+#define ENCODE_SIZE_HINT_DEFAULT 1024
+#define ENCODE_SIZE_HINT_MAX (64 * 1024) // one huge document must not pin huge buffers
+
+static const char indent_spaces[] = "                                                                ";
+
+static void writer_reset_state(JsonWriter *w, t_writer_mode mode)
+{
+  w->length = 0;
+  w->mode = mode;
+  w->total = 0;
+  w->overflow = false;
+  w->failed = false;
+  w->sink = NULL;
+  w->sink_ctx = NULL;
+  w->allocator = NULL;
+}
+
+static void writer_init(JsonWriter *w, t_size capacity, const t_json_allocator *allocator)
+{
+  writer_reset_state(w, WRITER_GROWABLE);
+  w->allocator = allocator;
+  w->capacity = capacity < WRITER_MIN_CAPACITY ? WRITER_MIN_CAPACITY : capacity;
+  w->buffer = allocator_alloc(allocator, w->capacity);
+  if (w->buffer)
+    w->buffer[0] = '\0';
+  else
+    w->failed = true;
+}
+
+static void writer_init_fixed(JsonWriter *w, char *buffer, t_size capacity)
 {
-  w->capacity = 1024;
+  writer_reset_state(w, WRITER_FIXED);
+  w->buffer = buffer;
+  w->capacity = capacity;
+  if (capacity > 0)
+    buffer[0] = '\0';
+}
+
+static void writer_init_sink(JsonWriter *w, char *chunk, t_size capacity, t_json_write_fn sink, void *sink_ctx)
+{
+  writer_reset_state(w, WRITER_SINK);
+  w->buffer = chunk;
+  w->capacity = capacity;
+  w->sink = sink;
+  w->sink_ctx = sink_ctx;
+}
+
+static void writer_flush(JsonWriter *w)
+{
+  if (w->mode != WRITER_SINK || w->failed || w->length == 0)
+    return;
+
+  if (w->sink(w->sink_ctx, w->buffer, w->length) != 0)
+    w->failed = true;
   w->length = 0;
-  w->buffer = calloc(1, w->capacity);
 }
 
-static void writer_ensure_capacity(JsonWriter *w, t_size len)
+// Makes room for len more bytes plus the NUL terminator (growable and fixed
+// writers keep the buffer terminated). Returns false when the bytes cannot be
+// stored in the buffer right now.
+static bool writer_ensure_capacity(JsonWriter *w, t_size len)
 {
-  if (w->length + len >= w->capacity)
+  if (w->failed || w->overflow)
+    return false;
+
+  if (w->length + len < w->capacity)
+    return true;
+
+  switch (w->mode)
   {
-    while (w->length + len >= w->capacity)
-    {
-      w->capacity *= 2;
-    }
-    char *new_buff = realloc(w->buffer, w->capacity);
+  case WRITER_GROWABLE:
+  {
+    t_size new_capacity = w->capacity;
+    while (w->length + len >= new_capacity)
+      new_capacity *= 2;
+
+    char *new_buff = allocator_realloc(w->allocator, w->buffer, new_capacity);
     if (!new_buff)
     {
-      perror("Failed to reallocate JSON buffer");
-      exit(1);
+      w->failed = true;
+      return false;
     }
     w->buffer = new_buff;
+    w->capacity = new_capacity;
+    return true;
   }
+  case WRITER_FIXED:
+    w->overflow = true;
+    return false;
+  case WRITER_SINK:
+    writer_flush(w);
+    return !w->failed && len < w->capacity;
+  }
+  return false;
+}
+
+// Room for a value of at most len bytes written in place. A fixed writer
+// that is nearly full returns NULL without flagging an overflow, since the
+// value itself may still fit through writer_append_raw.
+static char *writer_reserve(JsonWriter *w, t_size len)
+{
+  if (w->mode == WRITER_FIXED && w->length + len >= w->capacity)
+    return NULL;
+  return writer_ensure_capacity(w, len) ? w->buffer + w->length : NULL;
+}
+
+static void writer_commit(JsonWriter *w, t_size len)
+{
+  w->length += len;
+  w->total += len;
+  if (w->mode != WRITER_SINK)
+    w->buffer[w->length] = '\0';
+}
+
+static void writer_append_raw(JsonWriter *w, const char *data, t_size len)
+{
+  if (writer_ensure_capacity(w, len))
+  {
+    memcpy(w->buffer + w->length, data, len);
+    writer_commit(w, len);
+    return;
+  }
+
+  // Not stored: still counted so a fixed writer can report the size it needs,
+  // and handed straight to the sink when it is larger than a whole chunk.
+  w->total += len;
+  if (w->mode == WRITER_SINK && !w->failed && w->sink(w->sink_ctx, data, len) != 0)
+    w->failed = true;
 }
 
 static void writer_append(JsonWriter *w, const char *str)
 {
   if (!str)
     return;
-  t_size len = strlen(str);
+  writer_append_raw(w, str, strlen(str));
+}
 
-  writer_ensure_capacity(w, len);
+static void writer_append_escape(JsonWriter *w, char c)
+{
+  static const char hex_digits[] = "0123456789abcdef";
 
-  memcpy(w->buffer + w->length, str, len);
-  w->length += len;
-  w->buffer[w->length] = '\0';
+  switch (c)
+  {
+  case '\"':
+    writer_append_raw(w, "\\\"", 2);
+    break;
+  case '\\':
+    writer_append_raw(w, "\\\\", 2);
+    break;
+  case '\b':
+    writer_append_raw(w, "\\b", 2);
+    break;
+  case '\f':
+    writer_append_raw(w, "\\f", 2);
+    break;
+  case '\n':
+    writer_append_raw(w, "\\n", 2);
+    break;
+  case '\r':
+    writer_append_raw(w, "\\r", 2);
+    break;
+  case '\t':
+    writer_append_raw(w, "\\t", 2);
+    break;
+  default:
+  {
+    unsigned char byte = (unsigned char)c;
+    char esc[6] = {'\\', 'u', '0', '0', hex_digits[byte >> 4], hex_digits[byte & 0xF]};
+    writer_append_raw(w, esc, sizeof(esc));
+    break;
+  }
+  }
 }
 
+// Copies each run of bytes that need no escaping with a single reservation.
+// The first length bytes of str need not be NUL-terminated.
+static void writer_append_string_escaped_n(JsonWriter *w, const char *str, t_size length)
+{
+  const char *p = str;
+  const char *end = str + length;
+
+  writer_append_raw(w, "\"", 1);
+  while (p < end)
+  {
+    const char *run_end = scan_string_special_n(p, end);
+    if (run_end > p)
+      writer_append_raw(w, p, run_end - p);
+
+    p = run_end;
+    if (p < end)
+      writer_append_escape(w, *p++);
+  }
+  writer_append_raw(w, "\"", 1);
+}
+
+// NULL is written as an empty string.
 static void writer_append_string_escaped(JsonWriter *w, const char *str)
 {
-  writer_append(w, "\"");
+  writer_append_string_escaped_n(w, str ? str : "", str ? strlen(str) : 0);
+}
 
-  if (!str)
+static void writer_append_indent(JsonWriter *w, int depth)
+{
+  t_size remaining = (t_size)depth * 2;
+  while (remaining > 0)
+  {
+    t_size chunk = remaining < sizeof(indent_spaces) - 1 ? remaining : sizeof(indent_spaces) - 1;
+    writer_append_raw(w, indent_spaces, chunk);
+    remaining -= chunk;
+  }
+}
+
+static void writer_append_int(JsonWriter *w, long long value)
+{
+  char *out = writer_reserve(w, NUMBER_FORMAT_INT_MAX);
+  if (out)
   {
-    writer_append(w, "\"");
+    writer_commit(w, format_int64(out, value));
     return;
   }
 
-  const char *p = str;
-  while (*p)
+  char digits[NUMBER_FORMAT_INT_MAX];
+  writer_append_raw(w, digits, format_int64(digits, value));
+}
+
+static void writer_append_uint(JsonWriter *w, unsigned long long value)
+{
+  char *out = writer_reserve(w, NUMBER_FORMAT_INT_MAX);
+  if (out)
+  {
+    writer_commit(w, format_uint64(out, value));
+    return;
+  }
+
+  char digits[NUMBER_FORMAT_INT_MAX];
+  writer_append_raw(w, digits, format_uint64(digits, value));
+}
+
+static void writer_append_float(JsonWriter *w, float value)
+{
+  char *out = writer_reserve(w, NUMBER_FORMAT_DOUBLE_MAX);
+  if (out)
+  {
+    writer_commit(w, format_float(out, value));
+    return;
+  }
+
+  char digits[NUMBER_FORMAT_DOUBLE_MAX];
+  writer_append_raw(w, digits, format_float(digits, value));
+}
+
+static void writer_append_double(JsonWriter *w, double value)
+{
+  char *out = writer_reserve(w, NUMBER_FORMAT_DOUBLE_MAX);
+  if (out)
+  {
+    writer_commit(w, format_double(out, value));
+    return;
+  }
+
+  char digits[NUMBER_FORMAT_DOUBLE_MAX];
+  writer_append_raw(w, digits, format_double(digits, value));
+}
+
+// Rough output size of one instance, used as the first JsonWriter capacity
+// before any real output has been seen for the model.
+static t_size estimate_value_size(t_reflect_field *field)
+{
+  switch (cjson_field_kind(field->type))
+  {
+  case REFLECT_TYPE_INTEGER:
+    return 11;
+  case REFLECT_TYPE_DOUBLE:
+    return 24;
+  case REFLECT_TYPE_BOOL:
+    return 5;
+  case REFLECT_TYPE_STRING:
+    return 32;
+  case CJSON_TYPE_INT8:
+  case CJSON_TYPE_INT16:
+  case CJSON_TYPE_INT32:
+  case CJSON_TYPE_INT64:
+  case CJSON_TYPE_UINT8:
+  case CJSON_TYPE_UINT16:
+  case CJSON_TYPE_UINT32:
+  case CJSON_TYPE_UINT64:
+  case CJSON_TYPE_FLOAT:
+    return cjson_scalar_size(cjson_field_kind(field->type)) * 3;
+  case CJSON_TYPE_CHARS:
+    return cjson_field_count(field->type) + 2;
+  default:
+    return 128;
+  }
+}
+
+// Builds the "name": fragment of every visible field into one block, so the
+// encoder writes each field header with a single copy.
+void encoder_prepare_model(t_json_model *model)
+{
+  t_size field_count = model->reflect->field_count;
+  model->key_fragments = NULL;
+  model->encode_size_hint = ENCODE_SIZE_HINT_DEFAULT;
+
+  JsonWriter text;
+  writer_init(&text, WRITER_MIN_CAPACITY, NULL);
+  if (text.failed)
+    return;
+
+  t_size *offsets = (t_size *)allocator_calloc(NULL, (field_count + 1) * sizeof(t_size));
+  if (!offsets)
   {
-    const char *esc = NULL;
-    char buf[2];
+    allocator_free(NULL, text.buffer);
+    return;
+  }
 
-    switch (*p)
+  t_size estimate = 2;
+  for (t_size i = 0; i < field_count; i++)
+  {
+    t_json_field_config *config = &model->fields_config[i];
+    offsets[i] = text.length;
+    if (config->ignore)
+      continue;
+
+    const char *key = config->json_field_name ? config->json_field_name : model->reflect->fields[i].name;
+    writer_append_string_escaped(&text, key);
+    writer_append_raw(&text, ": ", 2);
+    estimate += (text.length - offsets[i]) + estimate_value_size(&model->reflect->fields[i]) + 2;
+  }
+  offsets[field_count] = text.length;
+
+  t_json_key_fragment *fragments = NULL;
+  if (!text.failed)
+    fragments = (t_json_key_fragment *)allocator_alloc(&model->allocator, field_count * sizeof(t_json_key_fragment) + text.length + 1);
+  if (fragments)
+  {
+    char *storage = (char *)(fragments + field_count);
+    memcpy(storage, text.buffer, text.length + 1);
+
+    for (t_size i = 0; i < field_count; i++)
     {
-    case '\"':
-      esc = "\\\"";
-      break;
-    case '\\':
-      esc = "\\\\";
-      break;
-    case '\b':
-      esc = "\\b";
-      break;
-    case '\f':
-      esc = "\\f";
-      break;
-    case '\n':
-      esc = "\\n";
-      break;
-    case '\r':
-      esc = "\\r";
-      break;
-    case '\t':
-      esc = "\\t";
-      break;
-    default:
-      buf[0] = *p;
-      buf[1] = '\0';
-      writer_append(w, buf);
-      break;
+      fragments[i].length = offsets[i + 1] - offsets[i];
+      fragments[i].text = fragments[i].length > 0 ? storage + offsets[i] : NULL;
     }
 
-    if (esc)
-      writer_append(w, esc);
-    p++;
+    model->key_fragments = fragments;
+    model->encode_size_hint = estimate < ENCODE_SIZE_HINT_MAX ? estimate : ENCODE_SIZE_HINT_MAX;
   }
 
-  writer_append(w, "\"");
+  allocator_free(NULL, offsets);
+  allocator_free(NULL, text.buffer);
+}
+
+static void writer_append_key(JsonWriter *w, t_json_model *model, t_size index, bool pretty)
+{
+  if (model->key_fragments && model->key_fragments[index].text)
+  {
+    t_json_key_fragment *fragment = &model->key_fragments[index];
+    writer_append_raw(w, fragment->text, pretty ? fragment->length : fragment->length - 1);
+    return;
+  }
+
+  t_json_field_config *config = &model->fields_config[index];
+  writer_append_string_escaped(w, config->json_field_name ? config->json_field_name : model->reflect->fields[index].name);
+  writer_append_raw(w, ": ", pretty ? 2 : 1);
+}
+
+static void _cjson_encode_internal(JsonWriter *w, void *instance, t_json_model *model, bool pretty, int depth);
+static void encode_program(JsonWriter *w, void *instance, const t_json_program *program, bool pretty, int depth);
+
+static void encode_object(JsonWriter *w, const void *instance, const t_json_child *child, bool pretty, int depth)
+{
+  if (child->program)
+    encode_program(w, (void *)instance, child->program, pretty, depth);
+  else if (child->encode)
+    child->encode(w, instance, pretty, depth);
+  else if (child->model)
+    _cjson_encode_internal(w, (void *)instance, child->model, pretty, depth);
+  else
+    writer_append(w, "null");
 }
 
-static void writer_printf(JsonWriter *w, const char *format, ...)
+static void encode_object_value(JsonWriter *w, const void *child_ptr, const t_json_child *child, bool pretty, int depth)
 {
-  va_list args;
+  if (child_ptr)
+    encode_object(w, child_ptr, child, pretty, depth + 1);
+  else
+    writer_append(w, "null");
+}
+
+static void encode_string_value(JsonWriter *w, const char *str)
+{
+  if (str)
+    writer_append_string_escaped(w, str);
+  else
+    writer_append(w, "null");
+}
+
+// Scalar of a sized kind (CJSON_TYPE_INT8 .. CJSON_TYPE_FLOAT) or int, double, bool.
+static void encode_number_value(JsonWriter *w, const void *ptr, int kind)
+{
+  switch (kind)
+  {
+  case REFLECT_TYPE_INTEGER:
+    writer_append_int(w, *(const int *)ptr);
+    break;
+  case REFLECT_TYPE_DOUBLE:
+    writer_append_double(w, *(const double *)ptr);
+    break;
+  case REFLECT_TYPE_BOOL:
+    if (*(const bool *)ptr)
+      writer_append_raw(w, "true", 4);
+    else
+      writer_append_raw(w, "false", 5);
+    break;
+  case CJSON_TYPE_INT8:
+    writer_append_int(w, *(const int8_t *)ptr);
+    break;
+  case CJSON_TYPE_INT16:
+    writer_append_int(w, *(const int16_t *)ptr);
+    break;
+  case CJSON_TYPE_INT32:
+    writer_append_int(w, *(const int32_t *)ptr);
+    break;
+  case CJSON_TYPE_INT64:
+    writer_append_int(w, *(const int64_t *)ptr);
+    break;
+  case CJSON_TYPE_UINT8:
+    writer_append_uint(w, *(const uint8_t *)ptr);
+    break;
+  case CJSON_TYPE_UINT16:
+    writer_append_uint(w, *(const uint16_t *)ptr);
+    break;
+  case CJSON_TYPE_UINT32:
+    writer_append_uint(w, *(const uint32_t *)ptr);
+    break;
+  case CJSON_TYPE_UINT64:
+    writer_append_uint(w, *(const uint64_t *)ptr);
+    break;
+  case CJSON_TYPE_FLOAT:
+    writer_append_float(w, *(const float *)ptr);
+    break;
+  default:
+    writer_append(w, "null");
+    break;
+  }
+}
+
+// char[capacity]: up to the first NUL, or all of it when the buffer is full.
+static void encode_chars_value(JsonWriter *w, const char *chars, t_size capacity)
+{
+  writer_append_string_escaped_n(w, chars, strnlen(chars, capacity));
+}
+
+// T[count] is always written in full.
+static void encode_fixed_array_value(JsonWriter *w, const void *values, int kind, t_size count)
+{
+  t_size size = cjson_scalar_size(kind);
+
+  writer_append(w, "[");
+  for (t_size k = 0; k < count; k++)
+  {
+    if (k > 0)
+      writer_append(w, ", ");
+    encode_number_value(w, (const char *)values + k * size, kind);
+  }
+  writer_append(w, "]");
+}
+
+static void encode_string_array_value(JsonWriter *w, const Array *arr)
+{
+  if (!arr || !arr->data)
+  {
+    writer_append(w, "null");
+    return;
+  }
+
+  writer_append(w, "[");
+  char **strings = (char **)arr->data;
+
+  for (t_size k = 0; k < arr->count; k++)
+  {
+    if (k > 0)
+      writer_append(w, ", ");
+    writer_append_string_escaped(w, strings[k]);
+  }
+  writer_append(w, "]");
+}
+
+static void encode_int_array_value(JsonWriter *w, const Array *arr)
+{
+  if (!arr || !arr->data)
+  {
+    writer_append(w, "null");
+    return;
+  }
+
+  writer_append(w, "[");
+  int *values = (int *)arr->data;
+
+  for (t_size k = 0; k < arr->count; k++)
+  {
+    if (k > 0)
+      writer_append(w, ", ");
+    writer_append_int(w, values[k]);
+  }
+  writer_append(w, "]");
+}
+
+static void encode_double_array_value(JsonWriter *w, const Array *arr)
+{
+  if (!arr || !arr->data)
+  {
+    writer_append(w, "null");
+    return;
+  }
+
+  writer_append(w, "[");
+  double *values = (double *)arr->data;
 
-  va_start(args, format);
-  int needed = vsnprintf(NULL, 0, format, args);
-  va_end(args);
+  for (t_size k = 0; k < arr->count; k++)
+  {
+    if (k > 0)
+      writer_append(w, ", ");
+    writer_append_double(w, values[k]);
+  }
+  writer_append(w, "]");
+}
 
-  if (needed < 0)
+// Items are instance pointers, or the instances themselves when contiguous.
+static void encode_object_array_value(JsonWriter *w, const Array *arr, const t_json_child *child, bool pretty, int depth, bool contiguous)
+{
+  const char *newline = pretty ? "\n" : "";
+
+  if (!arr || !arr->data)
+  {
+    writer_append(w, "null");
     return;
+  }
+
+  writer_append(w, "[");
+  writer_append(w, newline);
 
-  writer_ensure_capacity(w, needed + 1);
+  for (t_size k = 0; k < arr->count; k++)
+  {
+    if (k > 0)
+    {
+      writer_append(w, ",");
+      writer_append(w, newline);
+    }
 
-  va_start(args, format);
-  vsnprintf(w->buffer + w->length, needed + 1, format, args);
-  va_end(args);
+    if (pretty)
+      writer_append_indent(w, depth + 1);
+
+    const void *item = contiguous ? (const char *)arr->data + k * arr->element_size : ((void **)arr->data)[k];
+    encode_object(w, item, child, pretty, depth + 1);
+  }
 
-  w->length += needed;
+  writer_append(w, newline);
+  if (pretty)
+    writer_append_indent(w, depth);
+  writer_append(w, "]");
 }
 
 static void _cjson_encode_internal(JsonWriter *w, void *instance, t_json_model *model, bool pretty, int depth)
 {
   const char *newline = pretty ? "\n" : "";
-  const char *spacing = pretty ? "  " : "";
 
   writer_append(w, "{");
   writer_append(w, newline);
@@ -154,122 +623,65 @@ static void _cjson_encode_internal(JsonWriter *w, void *instance, t_json_model *
     }
 
     if (pretty)
-    {
-      for (int d = 0; d < depth + 1; d++)
-        writer_append(w, spacing);
-    }
+      writer_append_indent(w, depth + 1);
 
-    const char *key = config->json_field_name ? config->json_field_name : field->name;
-    writer_append(w, "\"");
-    writer_append(w, key);
-    writer_append(w, "\": ");
+    writer_append_key(w, model, i, pretty);
 
     void *ptr = (char *)instance + field->offset;
+    t_json_child child = {(t_json_model *)field->child_meta, NULL, NULL, NULL, 0};
 
-    switch (field->type)
+    switch (cjson_field_kind(field->type))
     {
     case REFLECT_TYPE_INTEGER:
-      writer_printf(w, "%d", *(int *)ptr);
+      writer_append_int(w, *(int *)ptr);
+      break;
+    case REFLECT_TYPE_DOUBLE:
+      writer_append_double(w, *(double *)ptr);
       break;
-
     case REFLECT_TYPE_STRING:
-    {
-      char *str = *(char **)ptr;
-      if (str)
-        writer_append_string_escaped(w, str);
-      else
-        writer_append(w, "null");
+      encode_string_value(w, *(char **)ptr);
       break;
-    }
-
     case REFLECT_TYPE_BOOL:
       writer_append(w, *(bool *)ptr ? "true" : "false");
       break;
-
     case REFLECT_TYPE_OBJECT:
-    {
-      void *child_ptr = *(void **)ptr;
-      if (child_ptr)
-      {
-        t_json_model *child_model = (t_json_model *)field->child_meta;
-        _cjson_encode_internal(w, child_ptr, child_model, pretty, depth + 1);
-      }
-      else
-      {
-        writer_append(w, "null");
-      }
+      encode_object_value(w, *(void **)ptr, &child, pretty, depth);
       break;
-    }
-
     case REFLECT_TYPE_ARRAY_STRING:
-    {
-      Array **arr_ptr = (Array **)ptr;
-      if (*arr_ptr && (*arr_ptr)->data)
-      {
-        Array *arr = *arr_ptr;
-        writer_append(w, "[");
-        char **strings = (char **)arr->data;
-
-        for (t_size k = 0; k < arr->count; k++)
-        {
-          if (k > 0)
-            writer_append(w, ", ");
-          writer_append_string_escaped(w, strings[k]);
-        }
-        writer_append(w, "]");
-      }
-      else
-      {
-        writer_append(w, "null");
-      }
+      encode_string_array_value(w, *(Array **)ptr);
+      break;
+    case REFLECT_TYPE_ARRAY_INT:
+      encode_int_array_value(w, *(Array **)ptr);
+      break;
+    case REFLECT_TYPE_ARRAY_DOUBLE:
+      encode_double_array_value(w, *(Array **)ptr);
       break;
-    }
     case REFLECT_TYPE_ARRAY_OBJECT:
-    {
-      Array **arr_ptr = (Array **)ptr;
-
-      if (*arr_ptr && (*arr_ptr)->data)
-      {
-        Array *arr = *arr_ptr;
-        writer_append(w, "[");
-        writer_append(w, newline);
-
-        t_json_model *child_model = (t_json_model *)field->child_meta;
-
-        void **items = (void **)arr->data;
-
-        for (t_size k = 0; k < arr->count; k++)
-        {
-          if (k > 0)
-          {
-            writer_append(w, ",");
-            writer_append(w, newline);
-          }
-
-          if (pretty)
-          {
-            for (int d = 0; d < depth + 1; d++)
-              writer_append(w, spacing);
-          }
-
-          _cjson_encode_internal(w, items[k], child_model, pretty, depth + 1);
-        }
-
-        writer_append(w, newline);
-        if (pretty)
-        {
-          for (int d = 0; d < depth; d++)
-            writer_append(w, spacing);
-        }
-        writer_append(w, "]");
-      }
-      else
-      {
-        writer_append(w, "null");
-      }
+      encode_object_array_value(w, *(Array **)ptr, &child, pretty, depth, false);
+      break;
+    case CJSON_TYPE_STRUCT:
+      encode_object_value(w, ptr, &child, pretty, depth);
+      break;
+    case CJSON_TYPE_ARRAY_STRUCT:
+      encode_object_array_value(w, *(Array **)ptr, &child, pretty, depth, true);
+      break;
+    case CJSON_TYPE_INT8:
+    case CJSON_TYPE_INT16:
+    case CJSON_TYPE_INT32:
+    case CJSON_TYPE_INT64:
+    case CJSON_TYPE_UINT8:
+    case CJSON_TYPE_UINT16:
+    case CJSON_TYPE_UINT32:
+    case CJSON_TYPE_UINT64:
+    case CJSON_TYPE_FLOAT:
+      encode_number_value(w, ptr, cjson_field_kind(field->type));
+      break;
+    case CJSON_TYPE_CHARS:
+      encode_chars_value(w, (const char *)ptr, cjson_field_count(field->type));
+      break;
+    case CJSON_TYPE_FIXED_ARRAY:
+      encode_fixed_array_value(w, ptr, cjson_field_element_kind(field->type), cjson_field_count(field->type));
       break;
-    }
-
     default:
       writer_append(w, "\"unsupported_type\"");
     }
@@ -279,23 +691,265 @@ static void _cjson_encode_internal(JsonWriter *w, void *instance, t_json_model *
   }
 
   writer_append(w, newline);
+  if (pretty)
+    writer_append_indent(w, depth);
+  writer_append(w, "}");
+}
+
+// _cjson_encode_internal over a compiled program: ignored fields are already
+// gone and every key fragment sits next to its instruction.
+static void encode_program(JsonWriter *w, void *instance, const t_json_program *program, bool pretty, int depth)
+{
+  writer_append_raw(w, "{\n", pretty ? 2 : 1);
+
+  for (uint32_t i = 0; i < program->count; i++)
+  {
+    const t_json_instruction *op = &program->ops[i];
+
+    if (i > 0)
+      writer_append_raw(w, ",\n", pretty ? 2 : 1);
+    if (pretty)
+      writer_append_indent(w, depth + 1);
+    writer_append_raw(w, op->fragment, pretty ? op->fragment_length : op->fragment_length - 1);
+
+    void *ptr = (char *)instance + op->offset;
+    t_json_child child = {NULL, op->child, NULL, NULL, 0};
+
+    switch (op->opcode)
+    {
+    case OP_INT:
+      writer_append_int(w, *(int *)ptr);
+      break;
+    case OP_DOUBLE:
+      writer_append_double(w, *(double *)ptr);
+      break;
+    case OP_STRING:
+      encode_string_value(w, *(char **)ptr);
+      break;
+    case OP_BOOL:
+      if (*(bool *)ptr)
+        writer_append_raw(w, "true", 4);
+      else
+        writer_append_raw(w, "false", 5);
+      break;
+    case OP_OBJECT:
+      encode_object_value(w, *(void **)ptr, &child, pretty, depth);
+      break;
+    case OP_ARRAY_STRING:
+      encode_string_array_value(w, *(Array **)ptr);
+      break;
+    case OP_ARRAY_INT:
+      encode_int_array_value(w, *(Array **)ptr);
+      break;
+    case OP_ARRAY_DOUBLE:
+      encode_double_array_value(w, *(Array **)ptr);
+      break;
+    case OP_ARRAY_OBJECT:
+      encode_object_array_value(w, *(Array **)ptr, &child, pretty, depth, false);
+      break;
+    case OP_STRUCT:
+      encode_object_value(w, ptr, &child, pretty, depth);
+      break;
+    case OP_ARRAY_STRUCT:
+      encode_object_array_value(w, *(Array **)ptr, &child, pretty, depth, true);
+      break;
+    case OP_NUMBER:
+      encode_number_value(w, ptr, op->kind);
+      break;
+    case OP_CHARS:
+      encode_chars_value(w, (const char *)ptr, op->count);
+      break;
+    case OP_FIXED_ARRAY:
+      encode_fixed_array_value(w, ptr, op->kind, op->count);
+      break;
+    default:
+      writer_append(w, "\"unsupported_type\"");
+    }
+  }
+
   if (pretty)
   {
-    for (int d = 0; d < depth; d++)
-      writer_append(w, spacing);
+    writer_append_raw(w, "\n", 1);
+    writer_append_indent(w, depth);
   }
-  writer_append(w, "}");
+  writer_append_raw(w, "}", 1);
 }
 
 char *cjson_encode(void *data, t_json_model *model, bool pretty)
+{
+  return cjson_encode_using(data, model, pretty, NULL);
+}
+
+char *cjson_encode_using(void *data, t_json_model *model, bool pretty, const t_json_allocator *allocator)
 {
   if (!data || !model)
     return NULL;
 
+  // Start from the largest output seen for this model, up to
+  // ENCODE_SIZE_HINT_MAX, so a typical document is written without a single
+  // realloc. Relaxed atomics: it is only a hint.
+  t_size hint = __atomic_load_n(&model->encode_size_hint, __ATOMIC_RELAXED);
+  if (hint == 0)
+    hint = ENCODE_SIZE_HINT_DEFAULT;
+
   JsonWriter w;
-  writer_init(&w);
+  writer_init(&w, pretty ? hint * 2 : hint + 1, allocator);
+
+  t_json_child root = {model, model->program, NULL, NULL, 0};
+  encode_object(&w, data, &root, pretty, 0);
 
-  _cjson_encode_internal(&w, data, model, pretty, 0);
+  if (w.failed)
+  {
+    allocator_free(allocator, w.buffer);
+    return NULL;
+  }
+
+  if (!pretty && w.length + 1 > hint && hint < ENCODE_SIZE_HINT_MAX)
+  {
+    t_size seen = w.length + 1 < ENCODE_SIZE_HINT_MAX ? w.length + 1 : ENCODE_SIZE_HINT_MAX;
+    __atomic_store_n(&model->encode_size_hint, seen, __ATOMIC_RELAXED);
+  }
 
   return w.buffer;
 }
+
+int cjson_encode_to(char *buffer, t_size capacity, void *data, t_json_model *model, bool pretty, t_size *out_length)
+{
+  if (!data || !model || (!buffer && capacity > 0))
+    return -1;
+
+  JsonWriter w;
+  writer_init_fixed(&w, buffer, capacity);
+
+  t_json_child root = {model, model->program, NULL, NULL, 0};
+  encode_object(&w, data, &root, pretty, 0);
+
+  if (out_length)
+    *out_length = w.total;
+
+  if (w.overflow || capacity == 0)
+  {
+    if (capacity > 0)
+      buffer[0] = '\0';
+    return -1;
+  }
+  return 0;
+}
+
+int cjson_encode_to_sink(t_json_write_fn write_fn, void *sink_ctx, void *data, t_json_model *model, bool pretty)
+{
+  if (!write_fn || !data || !model)
+    return -1;
+
+  char chunk[WRITER_SINK_CHUNK];
+  JsonWriter w;
+  writer_init_sink(&w, chunk, sizeof(chunk), write_fn, sink_ctx);
+
+  t_json_child root = {model, model->program, NULL, NULL, 0};
+  encode_object(&w, data, &root, pretty, 0);
+  writer_flush(&w);
+
+  return w.failed ? -1 : 0;
+}
+
+char *cjson_encode_with(t_json_encode_fn fn, const void *instance, bool pretty)
+{
+  if (!fn || !instance)
+    return NULL;
+
+  JsonWriter w;
+  writer_init(&w, ENCODE_SIZE_HINT_DEFAULT, NULL);
+
+  fn(&w, instance, pretty, 0);
+
+  if (w.failed)
+  {
+    allocator_free(NULL, w.buffer);
+    return NULL;
+  }
+  return w.buffer;
+}
+
+void cjson_rt_write_raw(t_json_writer *w, const char *text, t_size length)
+{
+  writer_append_raw(w, text, length);
+}
+
+void cjson_rt_write_indent(t_json_writer *w, int depth)
+{
+  writer_append_indent(w, depth);
+}
+
+void cjson_rt_write_int(t_json_writer *w, int value)
+{
+  writer_append_int(w, value);
+}
+
+void cjson_rt_write_double(t_json_writer *w, double value)
+{
+  writer_append_double(w, value);
+}
+
+void cjson_rt_write_string(t_json_writer *w, const char *value)
+{
+  encode_string_value(w, value);
+}
+
+void cjson_rt_write_bool(t_json_writer *w, bool value)
+{
+  writer_append_raw(w, value ? "true" : "false", value ? 4 : 5);
+}
+
+void cjson_rt_write_int_array(t_json_writer *w, const Array *values)
+{
+  encode_int_array_value(w, values);
+}
+
+void cjson_rt_write_double_array(t_json_writer *w, const Array *values)
+{
+  encode_double_array_value(w, values);
+}
+
+void cjson_rt_write_string_array(t_json_writer *w, const Array *values)
+{
+  encode_string_array_value(w, values);
+}
+
+void cjson_rt_write_object(t_json_writer *w, const void *child, t_json_encode_fn fn, bool pretty, int depth)
+{
+  t_json_child type = {NULL, NULL, NULL, fn, 0};
+  encode_object_value(w, child, &type, pretty, depth);
+}
+
+void cjson_rt_write_object_array(t_json_writer *w, const Array *items, t_json_encode_fn fn, bool pretty, int depth)
+{
+  t_json_child type = {NULL, NULL, NULL, fn, 0};
+  encode_object_array_value(w, items, &type, pretty, depth, false);
+}
+
+void cjson_rt_write_struct(t_json_writer *w, const void *child, t_json_encode_fn fn, bool pretty, int depth)
+{
+  t_json_child type = {NULL, NULL, NULL, fn, 0};
+  encode_object_value(w, child, &type, pretty, depth);
+}
+
+void cjson_rt_write_struct_array(t_json_writer *w, const Array *items, t_json_encode_fn fn, bool pretty, int depth)
+{
+  t_json_child type = {NULL, NULL, NULL, fn, 0};
+  encode_object_array_value(w, items, &type, pretty, depth, true);
+}
+
+void cjson_rt_write_number(t_json_writer *w, const void *value, int kind)
+{
+  encode_number_value(w, value, kind);
+}
+
+void cjson_rt_write_chars(t_json_writer *w, const char *value, t_size capacity)
+{
+  encode_chars_value(w, value, capacity);
+}
+
+void cjson_rt_write_fixed_array(t_json_writer *w, const void *values, int kind, t_size count)
+{
+  encode_fixed_array_value(w, values, kind, count);
+}
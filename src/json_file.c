@@ -0,0 +1,212 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+#include "../include/cjson.h"
+#include "../include/arena.h"
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define FILE_ARENA_BLOCK (16 * 1024)
+#define FILE_SINK_BUFFER (64 * 1024)
+
+// A decoded file owns the arena that holds every string and Array of the
+// decoded instance; the input itself is released before cjson_decode_file returns.
+struct s_json_file
+{
+  t_json_arena arena;
+};
+
+// The file contents, either mapped read-only or read into the heap.
+typedef struct
+{
+  const char *data;
+  t_size length;
+  t_size mapped_length; // 0 when data was read into the heap
+} t_file_input;
+
+typedef struct
+{
+  int fd;
+  t_size length;
+  char buffer[FILE_SINK_BUFFER];
+} t_file_sink;
+
+int _cjson_decode_range(const char *json, const char *end, t_json_model *model, void *instance, t_json_arena *arena, bool borrow_strings);
+
+#ifndef _WIN32
+// Read-only and never written to, so no page of the file is ever copied.
+static int map_file(t_file_input *input, int fd)
+{
+  void *base = mmap(NULL, input->length, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (base == MAP_FAILED)
+    return -1;
+#ifdef MADV_SEQUENTIAL
+  madvise(base, input->length, MADV_SEQUENTIAL);
+#endif
+
+  input->data = (const char *)base;
+  input->mapped_length = input->length;
+  return 0;
+}
+#endif
+
+static int read_file(t_file_input *input, int fd)
+{
+  char *data = (char *)allocator_alloc(NULL, input->length);
+  if (!data)
+    return -1;
+
+  t_size offset = 0;
+  while (offset < input->length)
+  {
+    ssize_t got = read(fd, data + offset, input->length - offset);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+    {
+      allocator_free(NULL, data);
+      return -1;
+    }
+    offset += (t_size)got;
+  }
+
+  input->data = data;
+  input->mapped_length = 0;
+  return 0;
+}
+
+static void release_input(t_file_input *input)
+{
+#ifndef _WIN32
+  if (input->mapped_length > 0)
+  {
+    munmap((void *)input->data, input->mapped_length);
+    return;
+  }
+#endif
+  allocator_free(NULL, (void *)input->data);
+}
+
+t_json_file *cjson_decode_file(const char *path, t_json_model *model, void *instance)
+{
+  if (!path || !model || !instance)
+    return NULL;
+
+  int fd = open(path, O_RDONLY | O_BINARY);
+  if (fd < 0)
+    return NULL;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0)
+  {
+    close(fd);
+    return NULL;
+  }
+
+  t_file_input input = {NULL, (t_size)info.st_size, 0};
+  int status = -1;
+#ifndef _WIN32
+  status = map_file(&input, fd);
+#endif
+  if (status != 0)
+    status = read_file(&input, fd);
+  close(fd);
+  if (status != 0)
+    return NULL;
+
+  t_json_file *file = (t_json_file *)allocator_alloc(NULL, sizeof(t_json_file));
+  if (!file)
+  {
+    release_input(&input);
+    return NULL;
+  }
+
+  // Strings are copied into the arena rather than borrowed from the input.
+  arena_init(&file->arena, NULL, 0, FILE_ARENA_BLOCK);
+  status = _cjson_decode_range(input.data, input.data + input.length, model, instance, &file->arena, false);
+  release_input(&input);
+  if (status != 0)
+  {
+    cjson_file_close(file);
+    return NULL;
+  }
+  return file;
+}
+
+void cjson_file_close(t_json_file *file)
+{
+  if (!file)
+    return;
+
+  arena_destroy(&file->arena);
+  allocator_free(NULL, file);
+}
+
+static int write_all(int fd, const char *data, t_size length)
+{
+  while (length > 0)
+  {
+    ssize_t written = write(fd, data, length);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return -1;
+    data += written;
+    length -= (t_size)written;
+  }
+  return 0;
+}
+
+static int file_sink_write(void *ctx, const char *data, t_size length)
+{
+  t_file_sink *sink = (t_file_sink *)ctx;
+
+  if (sink->length + length > FILE_SINK_BUFFER)
+  {
+    if (write_all(sink->fd, sink->buffer, sink->length) != 0)
+      return -1;
+    sink->length = 0;
+
+    if (length > FILE_SINK_BUFFER)
+      return write_all(sink->fd, data, length);
+  }
+
+  memcpy(sink->buffer + sink->length, data, length);
+  sink->length += length;
+  return 0;
+}
+
+int cjson_encode_file(const char *path, void *data, t_json_model *model, bool pretty)
+{
+  if (!path || !data || !model)
+    return -1;
+
+  t_file_sink *sink = (t_file_sink *)allocator_alloc(NULL, sizeof(t_file_sink));
+  if (!sink)
+    return -1;
+
+  sink->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+  if (sink->fd < 0)
+  {
+    allocator_free(NULL, sink);
+    return -1;
+  }
+  sink->length = 0;
+
+  int status = cjson_encode_to_sink(file_sink_write, sink, data, model, pretty);
+  if (status == 0)
+    status = write_all(sink->fd, sink->buffer, sink->length);
+  if (close(sink->fd) != 0)
+    status = -1;
+
+  allocator_free(NULL, sink);
+  return status;
+}
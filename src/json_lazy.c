@@ -0,0 +1,78 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../include/cjson.h"
+
+// Lazy decoding keeps one value span per model field, found by a single pass
+// that skips every value without decoding it. A field is decoded the first
+// time it is asked for, straight from its span.
+
+enum
+{
+  LAZY_PENDING,
+  LAZY_DECODED,
+  LAZY_FAILED
+};
+
+struct s_json_lazy
+{
+  t_json_model *model;
+  void *instance;
+  t_json_slice *values;  // per field, ptr NULL when the key is absent
+  unsigned char *states; // per field, LAZY_*
+};
+
+int _cjson_locate_fields(const char *json, const char *end, t_json_model *model, t_json_slice *values);
+int _cjson_decode_field(const t_json_slice *value, t_reflect_field *field, void *instance);
+
+t_json_lazy *cjson_decode_lazy(const char *json, t_size len, t_json_model *model, void *instance)
+{
+  if (!json || !model || !instance)
+    return NULL;
+
+  // One block: the handle, then the spans, then the states.
+  t_size field_count = model->reflect->field_count;
+  t_json_lazy *lazy = (t_json_lazy *)allocator_calloc(NULL, sizeof(t_json_lazy) + field_count * (sizeof(t_json_slice) + 1));
+  if (!lazy)
+    return NULL;
+
+  lazy->model = model;
+  lazy->instance = instance;
+  lazy->values = (t_json_slice *)(lazy + 1);
+  lazy->states = (unsigned char *)(lazy->values + field_count);
+
+  if (_cjson_locate_fields(json, json + len, model, lazy->values) != 0)
+  {
+    allocator_free(NULL, lazy);
+    return NULL;
+  }
+  return lazy;
+}
+
+void *cjson_get_field(t_json_lazy *lazy, const char *json_key)
+{
+  if (!lazy || !json_key)
+    return NULL;
+
+  t_reflect_field *field = cjson_model_find_field(lazy->model, json_key, strlen(json_key));
+  if (!field)
+    return NULL;
+
+  t_size i = (t_size)(field - lazy->model->reflect->fields);
+  if (lazy->values[i].ptr == NULL)
+    return NULL;
+
+  if (lazy->states[i] == LAZY_PENDING)
+  {
+    int status = _cjson_decode_field(&lazy->values[i], field, lazy->instance);
+    lazy->states[i] = status == 0 ? LAZY_DECODED : LAZY_FAILED;
+  }
+
+  if (lazy->states[i] != LAZY_DECODED)
+    return NULL;
+  return (char *)lazy->instance + field->offset;
+}
+
+void cjson_lazy_free(t_json_lazy *lazy)
+{
+  allocator_free(NULL, lazy);
+}
@@ -0,0 +1,169 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/cjson.h"
+#include "../include/arena.h"
+
+// Newline-delimited JSON: every record is decoded into the same instance with
+// an arena that is reset in between, so after the first few records strings
+// and Arrays reuse memory the arena already owns instead of hitting malloc.
+
+#define NDJSON_ARENA_BLOCK (64 * 1024)
+#define NDJSON_READ_CHUNK (64 * 1024)
+
+int _cjson_decode_range(const char *json, const char *end, t_json_model *model, void *instance, t_json_arena *arena, bool borrow_strings);
+
+typedef struct
+{
+  t_json_model *model;
+  void *instance;
+  t_json_arena arena;
+  t_json_record_fn callback;
+  void *callback_ctx;
+  t_size records;
+} t_ndjson_state;
+
+static bool is_blank_line(const char *line, t_size length)
+{
+  for (t_size i = 0; i < length; i++)
+  {
+    if (line[i] != ' ' && line[i] != '\t' && line[i] != '\r')
+      return false;
+  }
+  return true;
+}
+
+static int ndjson_state_init(t_ndjson_state *state, t_json_model *model, t_json_record_fn callback, void *ctx)
+{
+  memset(state, 0, sizeof(*state));
+  state->instance = allocator_alloc(NULL, model->reflect->size);
+  if (!state->instance)
+    return -1;
+
+  state->model = model;
+  state->callback = callback;
+  state->callback_ctx = ctx;
+  arena_init(&state->arena, NULL, 0, NDJSON_ARENA_BLOCK);
+  return 0;
+}
+
+static void ndjson_state_destroy(t_ndjson_state *state)
+{
+  arena_destroy(&state->arena);
+  allocator_free(NULL, state->instance);
+}
+
+// Decodes the record in [line, line + length) in place. borrow_strings lets
+// escape-free strings point into line, which must then be writable and stay
+// untouched until the callback returns.
+static int decode_record(t_ndjson_state *state, const char *line, t_size length, bool borrow_strings)
+{
+  if (is_blank_line(line, length))
+    return 0;
+
+  arena_reset(&state->arena);
+  memset(state->instance, 0, state->model->reflect->size);
+
+  if (_cjson_decode_range(line, line + length, state->model, state->instance, &state->arena, borrow_strings) != 0)
+    return -1;
+  if (state->callback(state->callback_ctx, state->instance, state->records) != 0)
+    return -1;
+
+  state->records++;
+  return 0;
+}
+
+int cjson_decode_ndjson(const char *buffer, t_size length, t_json_model *model, t_json_record_fn callback, void *ctx)
+{
+  if (!buffer || !model || !callback)
+    return -1;
+
+  t_ndjson_state state;
+  if (ndjson_state_init(&state, model, callback, ctx) != 0)
+    return -1;
+
+  const char *cursor = buffer;
+  const char *end = buffer + length;
+  int status = 0;
+
+  while (cursor < end && status == 0)
+  {
+    const char *newline = (const char *)memchr(cursor, '\n', end - cursor);
+    const char *line_end = newline ? newline : end;
+
+    status = decode_record(&state, cursor, line_end - cursor, false);
+    cursor = newline ? newline + 1 : end;
+  }
+
+  ndjson_state_destroy(&state);
+  return status;
+}
+
+int cjson_decode_ndjson_fd(int fd, t_json_model *model, t_json_record_fn callback, void *ctx)
+{
+  if (fd < 0 || !model || !callback)
+    return -1;
+
+  t_ndjson_state state;
+  if (ndjson_state_init(&state, model, callback, ctx) != 0)
+    return -1;
+
+  // Records are decoded in place, and since the read buffer is ours their
+  // strings may borrow from it until the callback returns.
+  t_size capacity = NDJSON_READ_CHUNK;
+  char *buffer = (char *)allocator_alloc(NULL, capacity);
+  t_size length = 0;
+  t_size scanned = 0; // bytes already known to hold no newline
+  int status = buffer ? 0 : -1;
+
+  while (status == 0)
+  {
+    if (capacity - length < NDJSON_READ_CHUNK / 2)
+    {
+      char *grown = (char *)allocator_realloc(NULL, buffer, capacity * 2);
+      if (!grown)
+      {
+        status = -1;
+        break;
+      }
+      buffer = grown;
+      capacity *= 2;
+    }
+
+    ssize_t got = read(fd, buffer + length, capacity - length);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got < 0)
+    {
+      status = -1;
+      break;
+    }
+
+    if (got == 0)
+    {
+      if (length > 0)
+        status = decode_record(&state, buffer, length, true);
+      break;
+    }
+    length += (t_size)got;
+
+    char *start = buffer;
+    char *end = buffer + length;
+    char *newline;
+    while (status == 0 && (newline = (char *)memchr(start + scanned, '\n', end - start - scanned)) != NULL)
+    {
+      status = decode_record(&state, start, newline - start, true);
+      start = newline + 1;
+      scanned = 0;
+    }
+
+    length = end - start;
+    scanned = length;
+    memmove(buffer, start, length);
+  }
+
+  allocator_free(NULL, buffer);
+  ndjson_state_destroy(&state);
+  return status;
+}
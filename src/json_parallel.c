@@ -0,0 +1,302 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../include/cjson.h"
+#include "../include/dynamic_array.h"
+#include "../include/arena.h"
+#include "../include/simd_scan.h"
+
+// Parallel decoding of many independent records (elements of a top-level array
+// or NDJSON lines). A sequential pre-scan records where each object starts and
+// ends, then workers claim batches of records from a shared counter and decode
+// them into their own arena. Instances land in a slot indexed by record, so the
+// output keeps document order without a merge pass, and the worker arenas are
+// adopted by the caller's arena once every thread has joined.
+
+#define PARALLEL_BATCH 64
+#define PARALLEL_ARENA_BLOCK (256 * 1024)
+
+typedef struct
+{
+  const t_json_slice *records;
+  t_size count;
+  t_json_model *model;
+  void **instances; // one slot per record, filled by whichever worker decodes it
+  t_size next_batch;
+  int failed;
+} t_parallel_job;
+
+typedef struct
+{
+  t_parallel_job *job;
+  t_json_arena arena;
+  pthread_t thread;
+} t_parallel_worker;
+
+int _cjson_decode_range(const char *json, const char *end, t_json_model *model, void *instance, t_json_arena *arena, bool borrow_strings);
+
+typedef struct
+{
+  t_json_slice *items;
+  t_size count;
+  t_size capacity;
+} t_record_list;
+
+static int record_list_add(t_record_list *list, const char *start, const char *end)
+{
+  if (list->count == list->capacity)
+  {
+    t_size capacity = list->capacity ? list->capacity * 2 : 1024;
+    t_json_slice *grown = (t_json_slice *)allocator_realloc(NULL, list->items, capacity * sizeof(t_json_slice));
+    if (!grown)
+      return -1;
+    list->items = grown;
+    list->capacity = capacity;
+  }
+
+  list->items[list->count].ptr = start;
+  list->items[list->count].length = (t_size)(end - start);
+  list->count++;
+  return 0;
+}
+
+static const char *skip_ws(const char *p, const char *end)
+{
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+    p++;
+  return p;
+}
+
+// p points at '{'. Returns one past the matching '}', or NULL when the object
+// is unterminated. Strings are skipped whole so braces inside them do not count.
+static const char *scan_object_end(const char *p, const char *end)
+{
+  t_size depth = 0;
+
+  while (p < end)
+  {
+    char c = *p++;
+    if (c == '"')
+    {
+      for (;;)
+      {
+        p = scan_string_special_n(p, end);
+        if (p >= end)
+          return NULL;
+        if (*p == '"')
+        {
+          p++;
+          break;
+        }
+        p += (*p == '\\') ? 2 : 1;
+      }
+    }
+    else if (c == '{' || c == '[')
+    {
+      depth++;
+    }
+    else if (c == '}' || c == ']')
+    {
+      if (depth == 0)
+        return NULL;
+      if (--depth == 0)
+        return c == '}' ? p : NULL;
+    }
+  }
+  return NULL;
+}
+
+static int prescan_array(const char *json, t_size len, t_record_list *list)
+{
+  const char *end = json + len;
+  const char *p = skip_ws(json, end);
+
+  if (p == end || *p != '[')
+    return -1;
+  p = skip_ws(p + 1, end);
+
+  if (p < end && *p == ']')
+    return skip_ws(p + 1, end) == end ? 0 : -1;
+
+  while (p < end)
+  {
+    if (*p != '{')
+      return -1;
+
+    const char *record_end = scan_object_end(p, end);
+    if (!record_end || record_list_add(list, p, record_end) != 0)
+      return -1;
+
+    p = skip_ws(record_end, end);
+    if (p < end && *p == ',')
+    {
+      p = skip_ws(p + 1, end);
+      continue;
+    }
+    if (p < end && *p == ']')
+      return skip_ws(p + 1, end) == end ? 0 : -1;
+    return -1;
+  }
+  return -1;
+}
+
+static int prescan_ndjson(const char *buffer, t_size len, t_record_list *list)
+{
+  const char *end = buffer + len;
+  const char *p = skip_ws(buffer, end);
+
+  while (p < end)
+  {
+    if (*p != '{')
+      return -1;
+
+    const char *record_end = scan_object_end(p, end);
+    if (!record_end || record_list_add(list, p, record_end) != 0)
+      return -1;
+
+    // Only blanks may follow a record on its line.
+    p = record_end;
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+      p++;
+    if (p < end && *p != '\n')
+      return -1;
+    p = skip_ws(p, end);
+  }
+  return 0;
+}
+
+static void *parallel_worker_run(void *arg)
+{
+  t_parallel_worker *worker = (t_parallel_worker *)arg;
+  t_parallel_job *job = worker->job;
+  t_size size = job->model->reflect->size;
+
+  for (;;)
+  {
+    t_size first = __atomic_fetch_add(&job->next_batch, PARALLEL_BATCH, __ATOMIC_RELAXED);
+    if (first >= job->count || __atomic_load_n(&job->failed, __ATOMIC_RELAXED))
+      break;
+
+    t_size last = first + PARALLEL_BATCH < job->count ? first + PARALLEL_BATCH : job->count;
+    for (t_size i = first; i < last; i++)
+    {
+      const t_json_slice *record = &job->records[i];
+      void *instance = arena_calloc(&worker->arena, size);
+
+      if (!instance || _cjson_decode_range(record->ptr, record->ptr + record->length, job->model, instance, &worker->arena, false) != 0)
+      {
+        __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+        return NULL;
+      }
+      job->instances[i] = instance;
+    }
+  }
+  return NULL;
+}
+
+static int resolve_thread_count(int nthreads, t_size records)
+{
+  if (nthreads <= 0)
+  {
+#ifdef _SC_NPROCESSORS_ONLN
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    nthreads = online > 0 ? (int)online : 1;
+#else
+    nthreads = 1;
+#endif
+  }
+
+  t_size batches = (records + PARALLEL_BATCH - 1) / PARALLEL_BATCH;
+  if ((t_size)nthreads > batches)
+    nthreads = batches > 0 ? (int)batches : 1;
+  return nthreads;
+}
+
+static int decode_records_parallel(const t_record_list *list, t_json_model *model, int nthreads, Array **out_array, t_json_arena *arena)
+{
+  Array *result = array_create_in(arena, sizeof(void *));
+  if (!result)
+    return -1;
+
+  // Reserve every slot up front so workers can store into them by index.
+  if (list->count > 0)
+  {
+    if (array_reserve(result, list->count) != 0)
+      return -1;
+    memset(result->data, 0, list->count * sizeof(void *));
+    result->count = list->count;
+  }
+
+  t_parallel_job job = {list->items, list->count, model, (void **)result->data, 0, 0};
+  nthreads = resolve_thread_count(nthreads, list->count);
+
+  t_parallel_worker *workers = (t_parallel_worker *)allocator_calloc(NULL, nthreads * sizeof(t_parallel_worker));
+  if (!workers)
+    return -1;
+
+  int started = 0;
+  for (int i = 0; i < nthreads; i++)
+  {
+    workers[i].job = &job;
+    arena_init(&workers[i].arena, NULL, 0, PARALLEL_ARENA_BLOCK);
+  }
+
+  // The calling thread works too; worker 0 is its share.
+  for (int i = 1; i < nthreads; i++)
+  {
+    if (pthread_create(&workers[i].thread, NULL, parallel_worker_run, &workers[i]) != 0)
+      break;
+    started++;
+  }
+  parallel_worker_run(&workers[0]);
+
+  for (int i = 1; i <= started; i++)
+    pthread_join(workers[i].thread, NULL);
+
+  // An arena that cannot be adopted takes its instances with it, so the result
+  // would point into freed blocks: the decode fails instead.
+  for (int i = 0; i < nthreads; i++)
+  {
+    if (!arena_adopt(arena, &workers[i].arena))
+    {
+      arena_destroy(&workers[i].arena);
+      job.failed = 1;
+    }
+  }
+  allocator_free(NULL, workers);
+
+  if (job.failed)
+    return -1;
+
+  *out_array = result;
+  return 0;
+}
+
+int cjson_decode_array_parallel(const char *json, t_size len, t_json_model *model, int nthreads, Array **out_array, t_json_arena *arena)
+{
+  if (!json || !model || !out_array || !arena)
+    return -1;
+
+  t_record_list list = {NULL, 0, 0};
+  int status = prescan_array(json, len, &list);
+  if (status == 0)
+    status = decode_records_parallel(&list, model, nthreads, out_array, arena);
+
+  allocator_free(NULL, list.items);
+  return status;
+}
+
+int cjson_decode_ndjson_parallel(const char *buffer, t_size len, t_json_model *model, int nthreads, Array **out_array, t_json_arena *arena)
+{
+  if (!buffer || !model || !out_array || !arena)
+    return -1;
+
+  t_record_list list = {NULL, 0, 0};
+  int status = prescan_ndjson(buffer, len, &list);
+  if (status == 0)
+    status = decode_records_parallel(&list, model, nthreads, out_array, arena);
+
+  allocator_free(NULL, list.items);
+  return status;
+}
@@ -0,0 +1,249 @@
+#include <string.h>
+#include "../include/cjson.h"
+#include "../include/string_utils.h"
+#include "../include/number_utils.h"
+
+// JSON Pointer (RFC 6901) lookups over raw text. Only the members and elements
+// on the path are looked at; everything else is stepped over with the
+// decoder's skipper, so nothing is allocated.
+
+const char *_cjson_skip_value(const char *cursor, const char *end);
+
+// Next byte of a pointer token with ~0 and ~1 decoded, or -1 at its end / on a bad escape.
+static int token_next_byte(const char **token, const char *end)
+{
+  if (*token >= end)
+    return -1;
+
+  char c = *(*token)++;
+  if (c != '~')
+    return (unsigned char)c;
+
+  if (*token >= end)
+    return -1;
+  c = *(*token)++;
+  if (c == '0')
+    return '~';
+  if (c == '1')
+    return '/';
+  return -1;
+}
+
+// Raw bytes taken by the escape sequence at p (p[0] == '\\'); a surrogate pair counts as one.
+static t_size escape_length(const char *p, const char *end)
+{
+  if (end - p < 6 || p[1] != 'u')
+    return end - p < 2 ? (t_size)(end - p) : 2;
+
+  bool high_surrogate = (p[2] == 'd' || p[2] == 'D') &&
+                        ((p[3] >= '8' && p[3] <= '9') || (p[3] >= 'a' && p[3] <= 'b') || (p[3] >= 'A' && p[3] <= 'B'));
+  if (high_surrogate && end - p >= 12 && p[6] == '\\' && p[7] == 'u')
+    return 12;
+  return 6;
+}
+
+// Compares a raw JSON key (escapes included) with a pointer token, decoding both as it goes.
+static bool key_matches_token(const t_json_slice *key, const char *token, const char *token_end)
+{
+  const char *p = key->ptr;
+  const char *end = key->ptr + key->length;
+
+  while (p < end)
+  {
+    if (*p != '\\')
+    {
+      if (token_next_byte(&token, token_end) != (unsigned char)*p)
+        return false;
+      p++;
+      continue;
+    }
+
+    char decoded[12];
+    t_size length = escape_length(p, end);
+    int decoded_length = unescape_json_string(p, p + length, decoded);
+    if (decoded_length < 0)
+      return false;
+
+    for (int i = 0; i < decoded_length; i++)
+    {
+      if (token_next_byte(&token, token_end) != (unsigned char)decoded[i])
+        return false;
+    }
+    p += length;
+  }
+  return token == token_end;
+}
+
+// Array index token: digits without a leading zero. "-" (past the end) never matches.
+static int token_to_index(const char *token, const char *end, t_size *out)
+{
+  if (token == end || (*token == '0' && end - token > 1))
+    return -1;
+
+  t_size index = 0;
+  for (; token < end; token++)
+  {
+    if (*token < '0' || *token > '9')
+      return -1;
+    t_size next = index * 10 + (t_size)(*token - '0');
+    if (next < index)
+      return -1;
+    index = next;
+  }
+  *out = index;
+  return 0;
+}
+
+// *cursor is at '{'; leaves it on the value of the member named by the token.
+static int find_member(const char **cursor, const char *end, const char *token, const char *token_end)
+{
+  (*cursor)++;
+  skip_whitespace(cursor, end);
+  if (peek_current(*cursor, end) == '}')
+    return -1;
+
+  for (;;)
+  {
+    t_json_slice key;
+    if (parse_key_slice(cursor, end, &key) != 0)
+      return -1;
+
+    skip_whitespace(cursor, end);
+    if (!match_and_consume(cursor, end, ':'))
+      return -1;
+    skip_whitespace(cursor, end);
+
+    if (key_matches_token(&key, token, token_end))
+      return 0;
+
+    const char *value = *cursor;
+    *cursor = _cjson_skip_value(value, end);
+    if (*cursor == NULL || *cursor == value)
+      return -1;
+
+    skip_whitespace(cursor, end);
+    if (!match_and_consume(cursor, end, ','))
+      return -1;
+  }
+}
+
+// *cursor is at '['; leaves it on element number index.
+static int find_element(const char **cursor, const char *end, t_size index)
+{
+  (*cursor)++;
+  skip_whitespace(cursor, end);
+  if (peek_current(*cursor, end) == ']')
+    return -1;
+
+  for (t_size i = 0; i < index; i++)
+  {
+    const char *value = *cursor;
+    *cursor = _cjson_skip_value(value, end);
+    if (*cursor == NULL || *cursor == value)
+      return -1;
+
+    skip_whitespace(cursor, end);
+    if (!match_and_consume(cursor, end, ','))
+      return -1;
+    skip_whitespace(cursor, end);
+  }
+  return 0;
+}
+
+int cjson_extract(const char *json, t_size len, const char *pointer, t_json_slice *out)
+{
+  if (!json || !pointer || !out)
+    return -1;
+
+  const char *end = json + len;
+  const char *cursor = json;
+  skip_whitespace(&cursor, end);
+
+  while (*pointer != '\0')
+  {
+    if (*pointer != '/')
+      return -1;
+
+    const char *token = pointer + 1;
+    const char *token_end = strchr(token, '/');
+    if (!token_end)
+      token_end = token + strlen(token);
+    pointer = token_end;
+
+    char c = peek_current(cursor, end);
+    if (c == '{')
+    {
+      if (find_member(&cursor, end, token, token_end) != 0)
+        return -1;
+    }
+    else if (c == '[')
+    {
+      t_size index;
+      if (token_to_index(token, token_end, &index) != 0 || find_element(&cursor, end, index) != 0)
+        return -1;
+    }
+    else
+    {
+      return -1; // a scalar has no children
+    }
+  }
+
+  const char *value_end = _cjson_skip_value(cursor, end);
+  if (value_end == NULL || value_end == cursor)
+    return -1;
+
+  out->ptr = cursor;
+  out->length = (t_size)(value_end - cursor);
+  return 0;
+}
+
+int cjson_slice_to_int(const t_json_slice *slice, int *out)
+{
+  const char *cursor = slice->ptr;
+  const char *end = slice->ptr + slice->length;
+  t_json_number number;
+
+  if (scan_json_number(&cursor, end, &number) != 0 || cursor != end)
+    return -1;
+  return json_number_to_int(&number, out);
+}
+
+int cjson_slice_to_double(const t_json_slice *slice, double *out)
+{
+  const char *cursor = slice->ptr;
+  const char *end = slice->ptr + slice->length;
+  t_json_number number;
+
+  if (scan_json_number(&cursor, end, &number) != 0 || cursor != end)
+    return -1;
+  *out = json_number_to_double(&number);
+  return 0;
+}
+
+int cjson_slice_to_bool(const t_json_slice *slice, bool *out)
+{
+  if (slice->length == 4 && memcmp(slice->ptr, "true", 4) == 0)
+    *out = true;
+  else if (slice->length == 5 && memcmp(slice->ptr, "false", 5) == 0)
+    *out = false;
+  else
+    return -1;
+  return 0;
+}
+
+int cjson_slice_to_string(const t_json_slice *slice, char *buffer, t_size capacity)
+{
+  if (slice->length < 2 || slice->ptr[0] != '"' || slice->ptr[slice->length - 1] != '"')
+    return -1;
+
+  // The decoded text is never longer than the raw body.
+  t_size raw_length = slice->length - 2;
+  if (capacity < raw_length + 1)
+    return -1;
+
+  int length = unescape_json_string(slice->ptr + 1, slice->ptr + 1 + raw_length, buffer);
+  if (length < 0)
+    return -1;
+  buffer[length] = '\0';
+  return length;
+}
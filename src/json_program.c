@@ -0,0 +1,258 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../include/cjson.h"
+#include "../include/json_program.h"
+
+static uint8_t opcode_for(t_reflect_field *field);
+
+typedef struct
+{
+  t_json_model **items;
+  t_size count;
+  t_size capacity;
+} t_model_list;
+
+static t_size model_list_find(const t_model_list *list, const t_json_model *model)
+{
+  for (t_size i = 0; i < list->count; i++)
+  {
+    if (list->items[i] == model)
+      return i;
+  }
+  return list->count;
+}
+
+// Every model reachable from root, root first; recursive models appear once.
+static int collect_models(t_model_list *list, t_json_model *model)
+{
+  if (model_list_find(list, model) < list->count)
+    return 0;
+
+  if (list->count == list->capacity)
+  {
+    t_size capacity = list->capacity ? list->capacity * 2 : 8;
+    t_json_model **grown = (t_json_model **)allocator_realloc(NULL, list->items, capacity * sizeof(t_json_model *));
+    if (!grown)
+      return -1;
+    list->items = grown;
+    list->capacity = capacity;
+  }
+  list->items[list->count++] = model;
+
+  for (t_size i = 0; i < model->reflect->field_count; i++)
+  {
+    t_reflect_field *field = &model->reflect->fields[i];
+    uint8_t opcode = opcode_for(field);
+    bool has_child = opcode == OP_OBJECT || opcode == OP_ARRAY_OBJECT || opcode == OP_STRUCT || opcode == OP_ARRAY_STRUCT;
+    if (has_child && field->child_meta && !model->fields_config[i].ignore &&
+        collect_models(list, (t_json_model *)field->child_meta) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+static uint8_t opcode_for(t_reflect_field *field)
+{
+  switch (cjson_field_kind(field->type))
+  {
+  case REFLECT_TYPE_INTEGER:
+    return OP_INT;
+  case REFLECT_TYPE_DOUBLE:
+    return OP_DOUBLE;
+  case REFLECT_TYPE_STRING:
+    return OP_STRING;
+  case REFLECT_TYPE_BOOL:
+    return OP_BOOL;
+  case REFLECT_TYPE_OBJECT:
+    return OP_OBJECT;
+  case REFLECT_TYPE_ARRAY_INT:
+    return OP_ARRAY_INT;
+  case REFLECT_TYPE_ARRAY_DOUBLE:
+    return OP_ARRAY_DOUBLE;
+  case REFLECT_TYPE_ARRAY_STRING:
+    return OP_ARRAY_STRING;
+  case REFLECT_TYPE_ARRAY_OBJECT:
+    return OP_ARRAY_OBJECT;
+  case CJSON_TYPE_STRUCT:
+    return OP_STRUCT;
+  case CJSON_TYPE_ARRAY_STRUCT:
+    return OP_ARRAY_STRUCT;
+  case CJSON_TYPE_INT8:
+  case CJSON_TYPE_INT16:
+  case CJSON_TYPE_INT32:
+  case CJSON_TYPE_INT64:
+  case CJSON_TYPE_UINT8:
+  case CJSON_TYPE_UINT16:
+  case CJSON_TYPE_UINT32:
+  case CJSON_TYPE_UINT64:
+  case CJSON_TYPE_FLOAT:
+    return OP_NUMBER;
+  case CJSON_TYPE_CHARS:
+    return OP_CHARS;
+  case CJSON_TYPE_FIXED_ARRAY:
+    return OP_FIXED_ARRAY;
+  default:
+    return OP_UNSUPPORTED;
+  }
+}
+
+static t_size table_capacity(t_size count)
+{
+  t_size capacity = 1;
+  while (capacity < count * 2)
+    capacity <<= 1;
+  return capacity;
+}
+
+static const char *decode_name(t_json_field_config *config)
+{
+  return config->json_field_name != NULL ? config->json_field_name : config->field_name;
+}
+
+// Sizes of the single block: programs, then instructions, then key tables,
+// then key and fragment text.
+typedef struct
+{
+  t_size ops;
+  t_size table_slots;
+  t_size text;
+} t_program_layout;
+
+static int measure_models(const t_model_list *list, t_program_layout *layout)
+{
+  for (t_size m = 0; m < list->count; m++)
+  {
+    t_json_model *model = list->items[m];
+    if (!model->key_fragments)
+      return -1;
+
+    t_size visible = 0;
+    for (t_size i = 0; i < model->reflect->field_count; i++)
+    {
+      if (model->fields_config[i].ignore)
+        continue;
+      if (strlen(decode_name(&model->fields_config[i])) > UINT16_MAX || model->reflect->fields[i].offset > UINT32_MAX ||
+          cjson_field_count(model->reflect->fields[i].type) > UINT32_MAX)
+        return -1;
+      layout->text += strlen(decode_name(&model->fields_config[i])) + 1 + model->key_fragments[i].length + 1;
+      visible++;
+    }
+    if (visible >= UINT16_MAX)
+      return -1;
+
+    layout->ops += visible;
+    layout->table_slots += table_capacity(visible);
+  }
+  return 0;
+}
+
+static void emit_program(t_json_program *programs, const t_model_list *list, t_size m, t_json_instruction **ops, uint16_t **tables, char **text)
+{
+  t_json_model *model = list->items[m];
+  t_json_program *program = &programs[m];
+  t_json_instruction *first = *ops;
+  uint16_t *table = *tables;
+  uint32_t count = 0;
+
+  for (t_size i = 0; i < model->reflect->field_count; i++)
+  {
+    t_json_field_config *config = &model->fields_config[i];
+    if (config->ignore)
+      continue;
+
+    t_reflect_field *field = &model->reflect->fields[i];
+    t_json_instruction *op = &first[count];
+    const char *name = decode_name(config);
+    t_size name_length = strlen(name);
+
+    op->opcode = opcode_for(field);
+    op->flags = 0;
+    op->key_length = (uint16_t)name_length;
+    op->offset = (uint32_t)field->offset;
+    op->count = (uint32_t)cjson_field_count(field->type);
+    op->kind = (uint16_t)cjson_field_element_kind(field->type);
+    op->key_hash = hash_json_key(name, name_length);
+
+    memcpy(*text, name, name_length + 1);
+    op->key = *text;
+    *text += name_length + 1;
+
+    op->fragment_length = (uint32_t)model->key_fragments[i].length;
+    memcpy(*text, model->key_fragments[i].text, op->fragment_length);
+    (*text)[op->fragment_length] = '\0';
+    op->fragment = *text;
+    *text += op->fragment_length + 1;
+
+    op->child = NULL;
+    bool has_child = op->opcode == OP_OBJECT || op->opcode == OP_ARRAY_OBJECT || op->opcode == OP_STRUCT ||
+                     op->opcode == OP_ARRAY_STRUCT;
+    if (has_child && field->child_meta)
+      op->child = &programs[model_list_find(list, (t_json_model *)field->child_meta)];
+    count++;
+  }
+
+  t_size capacity = table_capacity(count);
+  memset(table, 0, capacity * sizeof(uint16_t));
+  for (uint32_t i = 0; i < count; i++)
+  {
+    t_json_instruction *op = &first[i];
+    t_size pos = op->key_hash & (capacity - 1);
+
+    // Same rule as the key index: a repeated name keeps the first field.
+    while (table[pos] != 0 && !(first[table[pos] - 1].key_length == op->key_length &&
+                                memcmp(first[table[pos] - 1].key, op->key, op->key_length) == 0))
+      pos = (pos + 1) & (capacity - 1);
+
+    if (table[pos] != 0)
+      op->flags |= OP_FLAG_SHADOWED;
+    else
+      table[pos] = (uint16_t)(i + 1);
+  }
+
+  program->size = model->reflect->size;
+  program->count = count;
+  program->table_mask = (uint32_t)(capacity - 1);
+  program->ops = first;
+  program->table = table;
+
+  *ops += count;
+  *tables += capacity;
+}
+
+int cjson_compile_model(t_json_model *model)
+{
+  if (!model)
+    return -1;
+
+  t_model_list list = {NULL, 0, 0};
+  t_program_layout layout = {0, 0, 0};
+  if (collect_models(&list, model) != 0 || measure_models(&list, &layout) != 0)
+  {
+    allocator_free(NULL, list.items);
+    return -1;
+  }
+
+  t_size programs_size = list.count * sizeof(t_json_program);
+  t_size ops_size = layout.ops * sizeof(t_json_instruction);
+  t_size tables_size = layout.table_slots * sizeof(uint16_t);
+  char *block = (char *)allocator_alloc(&model->allocator, programs_size + ops_size + tables_size + layout.text);
+  if (!block)
+  {
+    allocator_free(NULL, list.items);
+    return -1;
+  }
+
+  t_json_program *programs = (t_json_program *)block;
+  t_json_instruction *ops = (t_json_instruction *)(block + programs_size);
+  uint16_t *tables = (uint16_t *)(block + programs_size + ops_size);
+  char *text = block + programs_size + ops_size + tables_size;
+
+  for (t_size m = 0; m < list.count; m++)
+    emit_program(programs, &list, m, &ops, &tables, &text);
+  allocator_free(NULL, list.items);
+
+  // programs[0] is the root and the start of the block.
+  allocator_free(&model->allocator, (void *)model->program);
+  model->program = programs;
+  return 0;
+}
@@ -0,0 +1,721 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/cjson.h"
+#include "../include/dynamic_array.h"
+#include "../include/string_utils.h"
+#include "../include/number_utils.h"
+#include "../include/simd_scan.h"
+
+// Resumable decoder: a byte-level lexer that survives any chunk split feeds
+// complete tokens to a parser whose only state is a stack of frames, one per
+// open object or array. Memory stays bounded by the nesting depth plus the
+// largest single token; strings nobody maps are never buffered.
+
+int _cjson_store_number(const t_json_number *number, int kind, void *target);
+
+#define STREAM_INITIAL_FRAMES 8
+#define STREAM_INITIAL_TOKEN 64
+
+typedef enum
+{
+  LEX_IDLE,
+  LEX_STRING,
+  LEX_NUMBER,
+  LEX_LITERAL
+} t_lex_state;
+
+typedef enum
+{
+  TOKEN_OBJECT_START,
+  TOKEN_OBJECT_END,
+  TOKEN_ARRAY_START,
+  TOKEN_ARRAY_END,
+  TOKEN_COLON,
+  TOKEN_COMMA,
+  TOKEN_STRING,
+  TOKEN_NUMBER,
+  TOKEN_TRUE,
+  TOKEN_FALSE,
+  TOKEN_NULL
+} t_token_type;
+
+typedef enum
+{
+  FRAME_OBJECT,
+  FRAME_ARRAY,
+  FRAME_SKIP // an unmapped or mismatched container, only its depth is tracked
+} t_frame_kind;
+
+typedef enum
+{
+  OBJECT_KEY_OR_END,
+  OBJECT_KEY,
+  OBJECT_COLON,
+  OBJECT_VALUE,
+  OBJECT_COMMA_OR_END,
+  ARRAY_VALUE_OR_END,
+  ARRAY_VALUE,
+  ARRAY_COMMA_OR_END
+} t_frame_state;
+
+typedef struct
+{
+  t_frame_kind kind;
+  t_frame_state state;
+  t_json_model *model;    // object frame: model of instance
+  void *instance;         // object frame: struct being filled
+  t_reflect_field *field; // object frame: field of the pending key, NULL = skip its value
+  t_reflect_field *array_field; // array frame: field that owns list
+  Array *list;       // NULL for a fixed array, filled in place instead
+  void *elements;    // fixed array frame: first element
+  t_size index;      // fixed array frame: next element
+  t_size skip_depth; // skip frame: open containers not closed yet
+} t_stream_frame;
+
+struct s_json_stream_decoder
+{
+  t_json_model *model;
+  void *instance;
+
+  t_stream_frame *frames;
+  t_size depth;
+  t_size frame_capacity;
+  bool started;
+  bool done;
+  bool failed;
+
+  t_lex_state lex_state;
+  bool in_escape;      // string: the previous byte was a backslash
+  bool discard_token;  // string: nobody maps this value, do not buffer it
+  char *token;
+  t_size token_length;
+  t_size token_capacity;
+};
+
+static bool is_number_byte(char c)
+{
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static bool is_literal_byte(char c)
+{
+  return c >= 'a' && c <= 'z';
+}
+
+static int token_append(t_json_stream_decoder *dec, const char *data, t_size len)
+{
+  if (dec->token_length + len > dec->token_capacity)
+  {
+    t_size capacity = dec->token_capacity ? dec->token_capacity : STREAM_INITIAL_TOKEN;
+    while (dec->token_length + len > capacity)
+      capacity *= 2;
+
+    char *grown = (char *)allocator_realloc(NULL, dec->token, capacity);
+    if (!grown)
+      return -1;
+    dec->token = grown;
+    dec->token_capacity = capacity;
+  }
+
+  memcpy(dec->token + dec->token_length, data, len);
+  dec->token_length += len;
+  return 0;
+}
+
+static t_stream_frame *push_frame(t_json_stream_decoder *dec, t_frame_kind kind)
+{
+  if (dec->depth == dec->frame_capacity)
+  {
+    t_size capacity = dec->frame_capacity * 2;
+    t_stream_frame *grown = (t_stream_frame *)allocator_realloc(NULL, dec->frames, capacity * sizeof(t_stream_frame));
+    if (!grown)
+      return NULL;
+    dec->frames = grown;
+    dec->frame_capacity = capacity;
+  }
+
+  t_stream_frame *frame = &dec->frames[dec->depth++];
+  memset(frame, 0, sizeof(*frame));
+  frame->kind = kind;
+  frame->state = kind == FRAME_OBJECT ? OBJECT_KEY_OR_END : ARRAY_VALUE_OR_END;
+  frame->skip_depth = 1;
+  return frame;
+}
+
+static void pop_frame(t_json_stream_decoder *dec)
+{
+  dec->depth--;
+  if (dec->depth == 0)
+    dec->done = true;
+}
+
+static char *decode_string_token(const char *text, t_size len)
+{
+  char *str = get_string_buffer((int)len);
+  if (!str)
+    return NULL;
+
+  int decoded = unescape_json_string(text, text + len, str);
+  if (decoded < 0)
+  {
+    allocator_free(NULL, str);
+    return NULL;
+  }
+  str[decoded] = '\0';
+  return str;
+}
+
+static int scan_number_token(const char *text, t_size len, t_json_number *number)
+{
+  const char *cursor = text;
+  if (scan_json_number(&cursor, text + len, number) != 0 || cursor != text + len)
+    return -1;
+  return 0;
+}
+
+// Stores a scalar token into a field of the given kind. Mismatched kinds are
+// ignored like the in-memory decoder does; malformed numbers, numbers out of
+// the field's range and strings longer than a char[N] are errors.
+static int store_scalar(t_reflect_type type, void *target, Array *list, t_token_type token, const char *text, t_size len)
+{
+  t_json_number number;
+
+  switch (cjson_field_kind(type))
+  {
+  case REFLECT_TYPE_INTEGER:
+  case REFLECT_TYPE_ARRAY_INT:
+  {
+    if (token != TOKEN_NUMBER)
+      return 0;
+    int value;
+    if (scan_number_token(text, len, &number) != 0 || json_number_to_int(&number, &value) != 0)
+      return -1;
+    if (list)
+      return array_add_int(list, value);
+    *(int *)target = value;
+    return 0;
+  }
+  case REFLECT_TYPE_DOUBLE:
+  case REFLECT_TYPE_ARRAY_DOUBLE:
+  {
+    if (token != TOKEN_NUMBER)
+      return 0;
+    if (scan_number_token(text, len, &number) != 0)
+      return -1;
+    double value = json_number_to_double(&number);
+    if (list)
+      return array_add_double(list, value);
+    *(double *)target = value;
+    return 0;
+  }
+  case REFLECT_TYPE_STRING:
+  case REFLECT_TYPE_ARRAY_STRING:
+  {
+    if (token != TOKEN_STRING)
+      return 0;
+    char *value = decode_string_token(text, len);
+    if (!value)
+      return -1;
+    if (list && array_add_ptr(list, value) != 0)
+    {
+      allocator_free(NULL, value);
+      return -1;
+    }
+    if (!list)
+      *(char **)target = value;
+    return 0;
+  }
+  case REFLECT_TYPE_BOOL:
+    if (token == TOKEN_TRUE || token == TOKEN_FALSE)
+      *(bool *)target = (token == TOKEN_TRUE);
+    return 0;
+  case CJSON_TYPE_INT8:
+  case CJSON_TYPE_INT16:
+  case CJSON_TYPE_INT32:
+  case CJSON_TYPE_INT64:
+  case CJSON_TYPE_UINT8:
+  case CJSON_TYPE_UINT16:
+  case CJSON_TYPE_UINT32:
+  case CJSON_TYPE_UINT64:
+  case CJSON_TYPE_FLOAT:
+    if (token != TOKEN_NUMBER)
+      return 0;
+    if (scan_number_token(text, len, &number) != 0)
+      return -1;
+    return _cjson_store_number(&number, cjson_field_kind(type), target);
+  case CJSON_TYPE_CHARS:
+  {
+    t_size capacity = cjson_field_count(type);
+    if (token != TOKEN_STRING || capacity == 0)
+      return 0;
+    int decoded = unescape_json_string_n(text, text + len, (char *)target, capacity - 1);
+    ((char *)target)[decoded < 0 ? 0 : decoded] = '\0';
+    return decoded < 0 ? -1 : 0;
+  }
+  default:
+    return 0;
+  }
+}
+
+// 0 when the field is not an array, or holds objects of an unregistered model.
+static t_size array_element_size(t_reflect_field *field)
+{
+  switch (cjson_field_kind(field->type))
+  {
+  case REFLECT_TYPE_ARRAY_INT:
+    return sizeof(int);
+  case REFLECT_TYPE_ARRAY_DOUBLE:
+    return sizeof(double);
+  case REFLECT_TYPE_ARRAY_STRING:
+    return sizeof(char *);
+  case REFLECT_TYPE_ARRAY_OBJECT:
+    return field->child_meta ? sizeof(void *) : 0;
+  case CJSON_TYPE_ARRAY_STRUCT:
+    return field->child_meta ? ((t_json_model *)field->child_meta)->reflect->size : 0;
+  default:
+    return 0;
+  }
+}
+
+// A value token arrived where the frame on top of the stack expects one.
+static int on_value(t_json_stream_decoder *dec, t_token_type token, const char *text, t_size len)
+{
+  t_stream_frame *frame = &dec->frames[dec->depth - 1];
+  t_reflect_field *field;
+  void *target = NULL;
+  Array *list = NULL;
+
+  if (frame->kind == FRAME_OBJECT)
+  {
+    frame->state = OBJECT_COMMA_OR_END;
+    field = frame->field;
+    if (field)
+      target = (char *)frame->instance + field->offset;
+  }
+  else
+  {
+    frame->state = ARRAY_COMMA_OR_END;
+    field = frame->array_field;
+    list = frame->list;
+
+    if (!list)
+    {
+      // Fixed array: each value lands in the next slot; one too many is an error.
+      int element_kind = cjson_field_element_kind(field->type);
+      if (frame->index >= cjson_field_count(field->type))
+        return -1;
+      target = (char *)frame->elements + frame->index++ * cjson_scalar_size(element_kind);
+      if (token == TOKEN_OBJECT_START || token == TOKEN_ARRAY_START)
+        return push_frame(dec, FRAME_SKIP) ? 0 : -1;
+      return store_scalar(CJSON_FIELD_TYPE(element_kind), target, NULL, token, text, len);
+    }
+  }
+
+  if (token == TOKEN_OBJECT_START)
+  {
+    t_json_model *child_model = field ? (t_json_model *)field->child_meta : NULL;
+    int kind = field ? cjson_field_kind(field->type) : -1;
+    bool by_pointer = list ? kind == REFLECT_TYPE_ARRAY_OBJECT : kind == REFLECT_TYPE_OBJECT;
+    bool in_place = list ? kind == CJSON_TYPE_ARRAY_STRUCT : kind == CJSON_TYPE_STRUCT;
+
+    if (!child_model || !(by_pointer || in_place))
+      return push_frame(dec, FRAME_SKIP) ? 0 : -1;
+
+    void *child;
+    if (in_place)
+    {
+      // The element stays put: the list only grows once this object is closed.
+      child = list ? array_add_zeroed(list) : target;
+      if (!child)
+        return -1;
+    }
+    else
+    {
+      child = allocator_calloc(NULL, child_model->reflect->size);
+      if (!child)
+        return -1;
+
+      if (list && array_add_ptr(list, child) != 0)
+      {
+        allocator_free(NULL, child);
+        return -1;
+      }
+      if (!list)
+        *(void **)target = child;
+    }
+
+    t_stream_frame *child_frame = push_frame(dec, FRAME_OBJECT);
+    if (!child_frame)
+      return -1;
+    child_frame->model = child_model;
+    child_frame->instance = child;
+    return 0;
+  }
+
+  if (token == TOKEN_ARRAY_START && field && !list && cjson_field_kind(field->type) == CJSON_TYPE_FIXED_ARRAY &&
+      cjson_scalar_size(cjson_field_element_kind(field->type)) > 0)
+  {
+    memset(target, 0, cjson_scalar_size(cjson_field_element_kind(field->type)) * cjson_field_count(field->type));
+
+    t_stream_frame *child_frame = push_frame(dec, FRAME_ARRAY);
+    if (!child_frame)
+      return -1;
+    child_frame->array_field = field;
+    child_frame->elements = target;
+    return 0;
+  }
+
+  if (token == TOKEN_ARRAY_START)
+  {
+    t_size element_size = (field && !list) ? array_element_size(field) : 0;
+    if (element_size == 0)
+      return push_frame(dec, FRAME_SKIP) ? 0 : -1;
+
+    Array *created = array_create(element_size);
+    if (!created)
+      return -1;
+    *(Array **)target = created;
+
+    t_stream_frame *child_frame = push_frame(dec, FRAME_ARRAY);
+    if (!child_frame)
+      return -1;
+    child_frame->array_field = field;
+    child_frame->list = created;
+    return 0;
+  }
+
+  if (!field)
+    return 0;
+
+  return store_scalar(field->type, target, list, token, text, len);
+}
+
+static int on_token(t_json_stream_decoder *dec, t_token_type token, const char *text, t_size len)
+{
+  if (dec->done)
+    return -1; // trailing content after the root object
+
+  if (dec->depth == 0)
+  {
+    if (token != TOKEN_OBJECT_START || dec->started)
+      return -1;
+
+    t_stream_frame *root = push_frame(dec, FRAME_OBJECT);
+    if (!root)
+      return -1;
+    root->model = dec->model;
+    root->instance = dec->instance;
+    dec->started = true;
+    return 0;
+  }
+
+  t_stream_frame *frame = &dec->frames[dec->depth - 1];
+
+  if (frame->kind == FRAME_SKIP)
+  {
+    if (token == TOKEN_OBJECT_START || token == TOKEN_ARRAY_START)
+      frame->skip_depth++;
+    else if ((token == TOKEN_OBJECT_END || token == TOKEN_ARRAY_END) && --frame->skip_depth == 0)
+      pop_frame(dec);
+    return 0;
+  }
+
+  switch (frame->state)
+  {
+  case OBJECT_KEY_OR_END:
+  case OBJECT_KEY:
+    if (token == TOKEN_OBJECT_END && frame->state == OBJECT_KEY_OR_END)
+    {
+      pop_frame(dec);
+      return 0;
+    }
+    if (token != TOKEN_STRING)
+      return -1;
+    frame->field = cjson_model_find_field(frame->model, text, len);
+    frame->state = OBJECT_COLON;
+    return 0;
+
+  case OBJECT_COLON:
+    if (token != TOKEN_COLON)
+      return -1;
+    frame->state = OBJECT_VALUE;
+    return 0;
+
+  case OBJECT_COMMA_OR_END:
+    if (token == TOKEN_COMMA)
+      frame->state = OBJECT_KEY;
+    else if (token == TOKEN_OBJECT_END)
+      pop_frame(dec);
+    else
+      return -1;
+    return 0;
+
+  case ARRAY_VALUE_OR_END:
+    if (token == TOKEN_ARRAY_END)
+    {
+      pop_frame(dec);
+      return 0;
+    }
+    break;
+
+  case ARRAY_COMMA_OR_END:
+    if (token == TOKEN_COMMA)
+      frame->state = ARRAY_VALUE;
+    else if (token == TOKEN_ARRAY_END)
+      pop_frame(dec);
+    else
+      return -1;
+    return 0;
+
+  default:
+    break;
+  }
+
+  // OBJECT_VALUE, ARRAY_VALUE or ARRAY_VALUE_OR_END with a value token.
+  if (token == TOKEN_OBJECT_END || token == TOKEN_ARRAY_END || token == TOKEN_COLON || token == TOKEN_COMMA)
+    return -1;
+  return on_value(dec, token, text, len);
+}
+
+// Whether the string starting now will be looked at by the parser.
+static bool string_is_needed(t_json_stream_decoder *dec)
+{
+  if (dec->depth == 0)
+    return false;
+
+  t_stream_frame *frame = &dec->frames[dec->depth - 1];
+  switch (frame->kind)
+  {
+  case FRAME_SKIP:
+    return false;
+  case FRAME_OBJECT:
+    if (frame->state == OBJECT_VALUE)
+      return frame->field && (cjson_field_kind(frame->field->type) == REFLECT_TYPE_STRING ||
+                              cjson_field_kind(frame->field->type) == CJSON_TYPE_CHARS);
+    return true; // a key
+  case FRAME_ARRAY:
+    return frame->array_field->type == REFLECT_TYPE_ARRAY_STRING;
+  }
+  return true;
+}
+
+static int finish_literal(t_json_stream_decoder *dec)
+{
+  t_token_type token;
+  if (dec->token_length == 4 && memcmp(dec->token, "true", 4) == 0)
+    token = TOKEN_TRUE;
+  else if (dec->token_length == 5 && memcmp(dec->token, "false", 5) == 0)
+    token = TOKEN_FALSE;
+  else if (dec->token_length == 4 && memcmp(dec->token, "null", 4) == 0)
+    token = TOKEN_NULL;
+  else
+    return -1;
+
+  dec->lex_state = LEX_IDLE;
+  return on_token(dec, token, NULL, 0);
+}
+
+static int finish_number(t_json_stream_decoder *dec)
+{
+  dec->lex_state = LEX_IDLE;
+  return on_token(dec, TOKEN_NUMBER, dec->token, dec->token_length);
+}
+
+t_json_stream_decoder *cjson_decoder_new(t_json_model *model, void *instance)
+{
+  if (!model || !instance)
+    return NULL;
+
+  t_json_stream_decoder *dec = (t_json_stream_decoder *)allocator_calloc(NULL, sizeof(t_json_stream_decoder));
+  if (!dec)
+    return NULL;
+
+  dec->frames = (t_stream_frame *)allocator_alloc(NULL, STREAM_INITIAL_FRAMES * sizeof(t_stream_frame));
+  if (!dec->frames)
+  {
+    allocator_free(NULL, dec);
+    return NULL;
+  }
+
+  dec->frame_capacity = STREAM_INITIAL_FRAMES;
+  dec->model = model;
+  dec->instance = instance;
+  dec->lex_state = LEX_IDLE;
+  return dec;
+}
+
+int cjson_decoder_feed(t_json_stream_decoder *dec, const char *chunk, t_size len)
+{
+  if (!dec || (!chunk && len > 0))
+    return -1;
+  if (dec->failed)
+    return -1;
+
+  const char *p = chunk;
+  const char *end = chunk + len;
+
+  while (p < end)
+  {
+    int status = 0;
+
+    switch (dec->lex_state)
+    {
+    case LEX_STRING:
+    {
+      if (dec->in_escape)
+      {
+        // The escaped byte itself; \uXXXX digits are ordinary bytes after it.
+        if (!dec->discard_token)
+          status = token_append(dec, p, 1);
+        dec->in_escape = false;
+        p++;
+        break;
+      }
+
+      const char *special = scan_string_special_n(p, end);
+      while (special < end && *special != '"' && *special != '\\')
+        special = scan_string_special_n(special + 1, end); // raw control byte, kept as content
+
+      if (!dec->discard_token && special > p)
+        status = token_append(dec, p, special - p);
+      p = special;
+      if (status != 0 || p == end)
+        break;
+
+      if (*p == '\\')
+      {
+        if (!dec->discard_token)
+          status = token_append(dec, p, 1);
+        dec->in_escape = true;
+        p++;
+        break;
+      }
+
+      p++; // closing quote
+      dec->lex_state = LEX_IDLE;
+      if (dec->discard_token)
+        status = on_token(dec, TOKEN_STRING, NULL, 0);
+      else
+        status = on_token(dec, TOKEN_STRING, dec->token, dec->token_length);
+      break;
+    }
+
+    case LEX_NUMBER:
+    {
+      const char *start = p;
+      while (p < end && is_number_byte(*p))
+        p++;
+      status = token_append(dec, start, p - start);
+      if (status == 0 && p < end)
+        status = finish_number(dec);
+      break;
+    }
+
+    case LEX_LITERAL:
+    {
+      const char *start = p;
+      while (p < end && is_literal_byte(*p) && dec->token_length + (p - start) < 5)
+        p++;
+      status = token_append(dec, start, p - start);
+      if (status == 0 && p < end)
+        status = finish_literal(dec);
+      break;
+    }
+
+    case LEX_IDLE:
+    {
+      char c = *p;
+      switch (c)
+      {
+      case ' ':
+      case '\t':
+      case '\n':
+      case '\r':
+        p++;
+        break;
+      case '{':
+        status = on_token(dec, TOKEN_OBJECT_START, NULL, 0);
+        p++;
+        break;
+      case '}':
+        status = on_token(dec, TOKEN_OBJECT_END, NULL, 0);
+        p++;
+        break;
+      case '[':
+        status = on_token(dec, TOKEN_ARRAY_START, NULL, 0);
+        p++;
+        break;
+      case ']':
+        status = on_token(dec, TOKEN_ARRAY_END, NULL, 0);
+        p++;
+        break;
+      case ':':
+        status = on_token(dec, TOKEN_COLON, NULL, 0);
+        p++;
+        break;
+      case ',':
+        status = on_token(dec, TOKEN_COMMA, NULL, 0);
+        p++;
+        break;
+      case '"':
+        dec->lex_state = LEX_STRING;
+        dec->in_escape = false;
+        dec->discard_token = !string_is_needed(dec);
+        dec->token_length = 0;
+        p++;
+        break;
+      default:
+        dec->token_length = 0;
+        if (c == '-' || (c >= '0' && c <= '9'))
+          dec->lex_state = LEX_NUMBER;
+        else if (c == 't' || c == 'f' || c == 'n')
+          dec->lex_state = LEX_LITERAL;
+        else
+          status = -1;
+        break;
+      }
+      break;
+    }
+    }
+
+    if (status != 0)
+    {
+      dec->failed = true;
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int cjson_decoder_finish(t_json_stream_decoder *dec)
+{
+  if (!dec || dec->failed)
+    return -1;
+
+  int status = 0;
+  if (dec->lex_state == LEX_NUMBER)
+    status = finish_number(dec);
+  else if (dec->lex_state == LEX_LITERAL)
+    status = finish_literal(dec);
+  else if (dec->lex_state == LEX_STRING)
+    status = -1;
+
+  if (status != 0 || !dec->done)
+  {
+    dec->failed = true;
+    return -1;
+  }
+  return 0;
+}
+
+void cjson_decoder_free(t_json_stream_decoder *dec)
+{
+  if (!dec)
+    return;
+
+  allocator_free(NULL, dec->frames);
+  allocator_free(NULL, dec->token);
+  allocator_free(NULL, dec);
+}
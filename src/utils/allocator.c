@@ -0,0 +1,36 @@
+#include <stdlib.h>
+#include "../../include/cjson.h"
+#include "../../include/dynamic_array.h"
+
+static void *default_alloc(void *ctx, t_size size)
+{
+  (void)ctx;
+  return malloc(size);
+}
+
+static void *default_realloc(void *ctx, void *ptr, t_size size)
+{
+  (void)ctx;
+  return realloc(ptr, size);
+}
+
+static void default_free(void *ctx, void *ptr)
+{
+  (void)ctx;
+  free(ptr);
+}
+
+t_json_allocator json_global_allocator = {default_alloc, default_realloc, default_free, NULL};
+
+void cjson_set_allocator(t_json_alloc_fn alloc_fn, t_json_realloc_fn realloc_fn, t_json_free_fn free_fn, void *ctx)
+{
+  // Pooled Array headers came from the allocator being replaced.
+  array_pool_release();
+
+  if (!alloc_fn || !realloc_fn || !free_fn)
+  {
+    json_global_allocator = (t_json_allocator){default_alloc, default_realloc, default_free, NULL};
+    return;
+  }
+  json_global_allocator = (t_json_allocator){alloc_fn, realloc_fn, free_fn, ctx};
+}
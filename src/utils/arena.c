@@ -0,0 +1,179 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/arena.h"
+#include "../../include/allocator.h"
+
+#define ARENA_BLOCK_DATA(block) ((char *)(block) + align_up(sizeof(t_arena_block)))
+
+static t_size align_up(t_size value)
+{
+  return (value + (ARENA_ALIGNMENT - 1)) & ~((t_size)ARENA_ALIGNMENT - 1);
+}
+
+void arena_init(t_json_arena *arena, void *buffer, t_size capacity, t_size block_size)
+{
+  if (arena == NULL)
+    return;
+
+  // Keep every allocation aligned even when the caller buffer is not.
+  char *start = (char *)buffer;
+  if (start != NULL)
+  {
+    t_size skew = align_up((t_size)(uintptr_t)start) - (t_size)(uintptr_t)start;
+    if (skew > capacity)
+      skew = capacity;
+    start += skew;
+    capacity -= skew;
+  }
+  else
+  {
+    capacity = 0;
+  }
+
+  arena->first_buffer = start;
+  arena->first_capacity = capacity;
+  arena->buffer = start;
+  arena->capacity = capacity;
+  arena->offset = 0;
+  arena->blocks = NULL;
+  arena->current = NULL;
+  arena->block_size = block_size;
+}
+
+static bool arena_next_block(t_json_arena *arena, t_size size)
+{
+  // Reuse blocks kept from before the last reset when they are big enough.
+  t_arena_block *candidate = arena->current ? arena->current->next : arena->blocks;
+  t_arena_block *last = arena->current;
+
+  while (candidate != NULL)
+  {
+    if (candidate->capacity >= size)
+    {
+      arena->current = candidate;
+      arena->buffer = ARENA_BLOCK_DATA(candidate);
+      arena->capacity = candidate->capacity;
+      arena->offset = 0;
+      return true;
+    }
+    last = candidate;
+    candidate = candidate->next;
+  }
+
+  if (arena->block_size == 0)
+    return false;
+
+  t_size capacity = arena->block_size > size ? arena->block_size : size;
+  t_arena_block *block = (t_arena_block *)allocator_alloc(NULL, align_up(sizeof(t_arena_block)) + capacity);
+  if (!block)
+    return false;
+
+  block->next = NULL;
+  block->capacity = capacity;
+
+  if (last)
+    last->next = block;
+  else
+    arena->blocks = block;
+
+  arena->current = block;
+  arena->buffer = ARENA_BLOCK_DATA(block);
+  arena->capacity = capacity;
+  arena->offset = 0;
+  return true;
+}
+
+void *arena_alloc(t_json_arena *arena, t_size size)
+{
+  if (arena == NULL)
+    return NULL;
+
+  size = align_up(size == 0 ? 1 : size);
+
+  if (arena->offset + size > arena->capacity && !arena_next_block(arena, size))
+    return NULL;
+
+  void *ptr = arena->buffer + arena->offset;
+  arena->offset += size;
+  return ptr;
+}
+
+void *arena_calloc(t_json_arena *arena, t_size size)
+{
+  void *ptr = arena_alloc(arena, size);
+  if (ptr)
+    memset(ptr, 0, size);
+  return ptr;
+}
+
+void arena_reset(t_json_arena *arena)
+{
+  if (arena == NULL)
+    return;
+
+  arena->current = NULL;
+  arena->buffer = arena->first_buffer;
+  arena->capacity = arena->first_capacity;
+  arena->offset = 0;
+}
+
+void arena_destroy(t_json_arena *arena)
+{
+  if (arena == NULL)
+    return;
+
+  t_arena_block *block = arena->blocks;
+  while (block)
+  {
+    t_arena_block *next = block->next;
+    allocator_free(NULL, block);
+    block = next;
+  }
+
+  arena->blocks = NULL;
+  arena_reset(arena);
+}
+
+bool arena_adopt(t_json_arena *arena, t_json_arena *src)
+{
+  if (arena == NULL || src == NULL || src->first_capacity > 0)
+    return false;
+
+  if (src->current == NULL)
+  {
+    // Nothing was carved from src; its spare blocks are simply released.
+    arena_destroy(src);
+    return true;
+  }
+
+  t_arena_block *spare = src->current->next;
+  while (spare)
+  {
+    t_arena_block *next = spare->next;
+    allocator_free(NULL, spare);
+    spare = next;
+  }
+
+  // Blocks up to current are in use, the ones after it are spare. Link the
+  // adopted chain right after current and continue carving from its tail; the
+  // rest of the old current block is given up until the next reset.
+  t_arena_block *tail = src->current;
+  tail->next = arena->current ? arena->current->next : arena->blocks;
+  if (arena->current)
+    arena->current->next = src->blocks;
+  else
+    arena->blocks = src->blocks;
+
+  arena->current = tail;
+  arena->buffer = ARENA_BLOCK_DATA(tail);
+  arena->capacity = tail->capacity;
+  arena->offset = src->offset;
+
+  src->blocks = NULL;
+  src->current = NULL;
+  src->buffer = NULL;
+  src->capacity = 0;
+  src->offset = 0;
+  return true;
+}
@@ -1,66 +1,280 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "../../include/dynamic_array.h"
 
+// Headers of freed heap Arrays (process-wide allocator only) are kept per
+// thread, linked through data, and handed out again by array_create.
+#define ARRAY_POOL_MAX 64
+
+typedef struct
+{
+  Array *head;
+  t_size count;
+  bool registered; // drained by the key destructor when the thread exits
+} t_array_pool;
+
+static __thread t_array_pool array_pool;
+static pthread_key_t array_pool_key;
+static pthread_once_t array_pool_once = PTHREAD_ONCE_INIT;
+static bool array_pool_key_ok = false;
+
+// A pooled header keeps a copy of the process-wide allocator it came from in
+// its unused inline buffer: cjson_set_allocator cannot reach other threads'
+// pools, so each header is freed through its own allocator whenever it leaves.
+_Static_assert(sizeof(t_json_allocator) <= ARRAY_INLINE_BYTES, "pooled header owner does not fit inline_data");
+
+static t_json_allocator *array_pool_owner(Array *arr)
+{
+  return (t_json_allocator *)arr->inline_data.bytes;
+}
+
+static bool is_current_allocator(const t_json_allocator *allocator)
+{
+  return allocator->alloc == json_global_allocator.alloc && allocator->realloc == json_global_allocator.realloc &&
+         allocator->free == json_global_allocator.free && allocator->ctx == json_global_allocator.ctx;
+}
+
+static void array_pool_drain(void *pool_ptr)
+{
+  t_array_pool *pool = (t_array_pool *)pool_ptr;
+  while (pool->head)
+  {
+    Array *next = (Array *)pool->head->data;
+    t_json_allocator owner = *array_pool_owner(pool->head);
+    allocator_free(&owner, pool->head);
+    pool->head = next;
+  }
+  pool->count = 0;
+}
+
+void array_pool_release(void)
+{
+  array_pool_drain(&array_pool);
+}
+
+static void array_pool_key_init(void)
+{
+  array_pool_key_ok = pthread_key_create(&array_pool_key, array_pool_drain) == 0;
+}
+
+static Array *array_pool_take(void)
+{
+  Array *arr = array_pool.head;
+  if (arr && !is_current_allocator(array_pool_owner(arr)))
+  {
+    // The allocator was replaced since these headers were pooled.
+    array_pool_drain(&array_pool);
+    return NULL;
+  }
+
+  if (arr)
+  {
+    array_pool.head = (Array *)arr->data;
+    array_pool.count--;
+  }
+  return arr;
+}
+
+static bool array_pool_put(Array *arr)
+{
+  if (array_pool.head && !is_current_allocator(array_pool_owner(array_pool.head)))
+    array_pool_drain(&array_pool);
+
+  if (array_pool.count >= ARRAY_POOL_MAX)
+    return false;
+
+  if (!array_pool.registered)
+  {
+    pthread_once(&array_pool_once, array_pool_key_init);
+    if (!array_pool_key_ok || pthread_setspecific(array_pool_key, &array_pool) != 0)
+      return false;
+    array_pool.registered = true;
+  }
+
+  *array_pool_owner(arr) = json_global_allocator;
+  arr->data = array_pool.head;
+  array_pool.head = arr;
+  array_pool.count++;
+  return true;
+}
+
+// The allocator is copied, so the caller's may be a temporary.
+static void array_init(Array *arr, t_size element_size, t_json_arena *arena, const t_json_allocator *allocator)
+{
+  arr->element_size = element_size;
+  arr->count = 0;
+  arr->capacity = ARRAY_INLINE_BYTES / element_size;
+  arr->data = arr->inline_data.bytes;
+  arr->arena = arena;
+  if (allocator)
+    arr->allocator = *allocator;
+  else
+    memset(&arr->allocator, 0, sizeof(arr->allocator));
+}
+
+// NULL for the process-wide allocator, as the allocator_* helpers expect.
+static const t_json_allocator *array_allocator(const Array *arr)
+{
+  return arr->allocator.alloc ? &arr->allocator : NULL;
+}
+
 Array *array_create(t_size element_size)
+{
+  return array_create_using(NULL, element_size);
+}
+
+Array *array_create_using(const t_json_allocator *allocator, t_size element_size)
 {
   if (element_size <= 0)
     return NULL;
 
-  Array *arr = (Array *)malloc(sizeof(Array));
+  Array *arr = allocator ? NULL : array_pool_take();
+  if (!arr)
+    arr = (Array *)allocator_alloc(allocator, sizeof(Array));
   if (!arr)
     return NULL;
 
-  arr->capacity = 8;
-  arr->count = 0;
-  arr->element_size = element_size;
+  array_init(arr, element_size, NULL, allocator);
+  return arr;
+}
 
-  arr->data = malloc(arr->capacity * element_size);
+Array *array_create_in(t_json_arena *arena, t_size element_size)
+{
+  if (arena == NULL)
+    return array_create(element_size);
 
-  if (!arr->data)
-  {
-    free(arr);
+  if (element_size <= 0)
+    return NULL;
+
+  Array *arr = (Array *)arena_alloc(arena, sizeof(Array));
+  if (!arr)
     return NULL;
-  }
 
+  array_init(arr, element_size, arena, NULL);
   return arr;
 }
 
-void array_add(Array *array, void *item_ptr)
+// Moves the elements to a buffer of exactly new_capacity elements.
+static int array_resize(Array *array, t_size new_capacity)
 {
-  if (array == NULL || item_ptr == NULL)
-    return;
+  t_size bytes = new_capacity * array->element_size;
+  if (bytes / array->element_size != new_capacity)
+    return -1;
 
-  if (array->count >= array->capacity)
+  bool is_inline = array->data == (void *)array->inline_data.bytes;
+  void *temp;
+
+  if (array->arena)
+  {
+    // The old buffer stays in the arena until it is reset.
+    temp = arena_alloc(array->arena, bytes);
+    if (temp)
+      memcpy(temp, array->data, array->count * array->element_size);
+  }
+  else if (is_inline)
+  {
+    temp = allocator_alloc(array_allocator(array), bytes);
+    if (temp)
+      memcpy(temp, array->data, array->count * array->element_size);
+  }
+  else
   {
-    t_size new_capacity = array->capacity * 2;
+    temp = allocator_realloc(array_allocator(array), array->data, bytes);
+  }
+
+  if (!temp)
+    return -1;
 
-    void *temp = realloc(array->data, new_capacity * array->element_size);
+  array->data = temp;
+  array->capacity = new_capacity;
+  return 0;
+}
 
-    if (!temp)
-    {
-      return;
-    }
+int array_grow(Array *array)
+{
+  t_size new_capacity = array->capacity < 4 ? 8 : array->capacity * 2;
+  return array_resize(array, new_capacity);
+}
 
-    array->data = temp;
-    array->capacity = new_capacity;
+int array_reserve(Array *array, t_size capacity)
+{
+  if (array == NULL)
+    return -1;
+  if (capacity <= array->capacity)
+    return 0;
+  return array_resize(array, capacity);
+}
+
+int array_append(Array *array, const void *items, t_size count)
+{
+  if (array == NULL || (items == NULL && count > 0))
+    return -1;
+
+  t_size needed = array->count + count;
+  if (needed < array->count)
+    return -1;
+
+  if (needed > array->capacity)
+  {
+    t_size doubled = array->capacity * 2;
+    if (array_resize(array, needed > doubled ? needed : doubled) != 0)
+      return -1;
   }
 
+  memcpy((char *)array->data + array->count * array->element_size, items, count * array->element_size);
+  array->count = needed;
+  return 0;
+}
+
+void array_add(Array *array, void *item_ptr)
+{
+  if (array == NULL || item_ptr == NULL)
+    return;
+
+  if (array->count >= array->capacity && array_grow(array) != 0)
+    return;
+
   void *destination = (char *)array->data + (array->count * array->element_size);
 
-  memcpy(destination, item_ptr, array->element_size);
+  // Fixed-size copies compile to a single load and store.
+  switch (array->element_size)
+  {
+  case 4:
+    memcpy(destination, item_ptr, 4);
+    break;
+  case 8:
+    memcpy(destination, item_ptr, 8);
+    break;
+  default:
+    memcpy(destination, item_ptr, array->element_size);
+    break;
+  }
+
+  array->count++;
+}
+
+void *array_add_zeroed(Array *array)
+{
+  if (array == NULL || (array->count >= array->capacity && array_grow(array) != 0))
+    return NULL;
 
+  void *element = (char *)array->data + array->count * array->element_size;
+  memset(element, 0, array->element_size);
   array->count++;
+  return element;
 }
 
 void array_free(Array *array)
 {
-  if (array == NULL)
+  if (array == NULL || array->arena)
     return;
 
-  if (array->data)
-    free(array->data);
+  if (array->data != (void *)array->inline_data.bytes)
+    allocator_free(array_allocator(array), array->data);
 
-  free(array);
+  const t_json_allocator *allocator = array_allocator(array);
+  if (allocator || !array_pool_put(array))
+    allocator_free(allocator, array);
 }
@@ -0,0 +1,453 @@
+#include <stdint.h>
+#include <string.h>
+#include "../../include/number_format.h"
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+int format_uint64(char *buffer, unsigned long long value)
+{
+  char digits[NUMBER_FORMAT_INT_MAX];
+  char *p = digits + sizeof(digits);
+
+  while (value >= 100)
+  {
+    unsigned int pair = (unsigned int)(value % 100) * 2;
+    value /= 100;
+    *--p = digit_pairs[pair + 1];
+    *--p = digit_pairs[pair];
+  }
+
+  if (value >= 10)
+  {
+    unsigned int pair = (unsigned int)value * 2;
+    *--p = digit_pairs[pair + 1];
+    *--p = digit_pairs[pair];
+  }
+  else
+  {
+    *--p = (char)('0' + value);
+  }
+
+  int length = (int)(digits + sizeof(digits) - p);
+  memcpy(buffer, p, length);
+  return length;
+}
+
+int format_int64(char *buffer, long long value)
+{
+  if (value < 0)
+  {
+    *buffer = '-';
+    return 1 + format_uint64(buffer + 1, 0ULL - (unsigned long long)value);
+  }
+  return format_uint64(buffer, (unsigned long long)value);
+}
+
+// Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately
+// with Integers"), in the formulation used by several JSON libraries: the
+// digits always read back to the same double and are the shortest such
+// digits for all but a tiny fraction of inputs.
+
+typedef struct
+{
+  uint64_t f;
+  int e;
+} t_diyfp;
+
+typedef struct
+{
+  uint64_t f;
+  int e;
+  int k;
+} t_cached_power;
+
+#define GRISU_ALPHA -60
+#define GRISU_GAMMA -32
+#define CACHED_POWERS_MIN_DEC_EXP -300
+#define CACHED_POWERS_DEC_STEP 8
+
+// 10^k normalized to 64 bits for k = -300, -292, ..., 324.
+static const t_cached_power cached_powers[] = {
+    {0xAB70FE17C79AC6CAULL, -1060, -300},
+    {0xFF77B1FCBEBCDC4FULL, -1034, -292},
+    {0xBE5691EF416BD60CULL, -1007, -284},
+    {0x8DD01FAD907FFC3CULL, -980, -276},
+    {0xD3515C2831559A83ULL, -954, -268},
+    {0x9D71AC8FADA6C9B5ULL, -927, -260},
+    {0xEA9C227723EE8BCBULL, -901, -252},
+    {0xAECC49914078536DULL, -874, -244},
+    {0x823C12795DB6CE57ULL, -847, -236},
+    {0xC21094364DFB5637ULL, -821, -228},
+    {0x9096EA6F3848984FULL, -794, -220},
+    {0xD77485CB25823AC7ULL, -768, -212},
+    {0xA086CFCD97BF97F4ULL, -741, -204},
+    {0xEF340A98172AACE5ULL, -715, -196},
+    {0xB23867FB2A35B28EULL, -688, -188},
+    {0x84C8D4DFD2C63F3BULL, -661, -180},
+    {0xC5DD44271AD3CDBAULL, -635, -172},
+    {0x936B9FCEBB25C996ULL, -608, -164},
+    {0xDBAC6C247D62A584ULL, -582, -156},
+    {0xA3AB66580D5FDAF6ULL, -555, -148},
+    {0xF3E2F893DEC3F126ULL, -529, -140},
+    {0xB5B5ADA8AAFF80B8ULL, -502, -132},
+    {0x87625F056C7C4A8BULL, -475, -124},
+    {0xC9BCFF6034C13053ULL, -449, -116},
+    {0x964E858C91BA2655ULL, -422, -108},
+    {0xDFF9772470297EBDULL, -396, -100},
+    {0xA6DFBD9FB8E5B88FULL, -369, -92},
+    {0xF8A95FCF88747D94ULL, -343, -84},
+    {0xB94470938FA89BCFULL, -316, -76},
+    {0x8A08F0F8BF0F156BULL, -289, -68},
+    {0xCDB02555653131B6ULL, -263, -60},
+    {0x993FE2C6D07B7FACULL, -236, -52},
+    {0xE45C10C42A2B3B06ULL, -210, -44},
+    {0xAA242499697392D3ULL, -183, -36},
+    {0xFD87B5F28300CA0EULL, -157, -28},
+    {0xBCE5086492111AEBULL, -130, -20},
+    {0x8CBCCC096F5088CCULL, -103, -12},
+    {0xD1B71758E219652CULL, -77, -4},
+    {0x9C40000000000000ULL, -50, 4},
+    {0xE8D4A51000000000ULL, -24, 12},
+    {0xAD78EBC5AC620000ULL, 3, 20},
+    {0x813F3978F8940984ULL, 30, 28},
+    {0xC097CE7BC90715B3ULL, 56, 36},
+    {0x8F7E32CE7BEA5C70ULL, 83, 44},
+    {0xD5D238A4ABE98068ULL, 109, 52},
+    {0x9F4F2726179A2245ULL, 136, 60},
+    {0xED63A231D4C4FB27ULL, 162, 68},
+    {0xB0DE65388CC8ADA8ULL, 189, 76},
+    {0x83C7088E1AAB65DBULL, 216, 84},
+    {0xC45D1DF942711D9AULL, 242, 92},
+    {0x924D692CA61BE758ULL, 269, 100},
+    {0xDA01EE641A708DEAULL, 295, 108},
+    {0xA26DA3999AEF774AULL, 322, 116},
+    {0xF209787BB47D6B85ULL, 348, 124},
+    {0xB454E4A179DD1877ULL, 375, 132},
+    {0x865B86925B9BC5C2ULL, 402, 140},
+    {0xC83553C5C8965D3DULL, 428, 148},
+    {0x952AB45CFA97A0B3ULL, 455, 156},
+    {0xDE469FBD99A05FE3ULL, 481, 164},
+    {0xA59BC234DB398C25ULL, 508, 172},
+    {0xF6C69A72A3989F5CULL, 534, 180},
+    {0xB7DCBF5354E9BECEULL, 561, 188},
+    {0x88FCF317F22241E2ULL, 588, 196},
+    {0xCC20CE9BD35C78A5ULL, 614, 204},
+    {0x98165AF37B2153DFULL, 641, 212},
+    {0xE2A0B5DC971F303AULL, 667, 220},
+    {0xA8D9D1535CE3B396ULL, 694, 228},
+    {0xFB9B7CD9A4A7443CULL, 720, 236},
+    {0xBB764C4CA7A44410ULL, 747, 244},
+    {0x8BAB8EEFB6409C1AULL, 774, 252},
+    {0xD01FEF10A657842CULL, 800, 260},
+    {0x9B10A4E5E9913129ULL, 827, 268},
+    {0xE7109BFBA19C0C9DULL, 853, 276},
+    {0xAC2820D9623BF429ULL, 880, 284},
+    {0x80444B5E7AA7CF85ULL, 907, 292},
+    {0xBF21E44003ACDD2DULL, 933, 300},
+    {0x8E679C2F5E44FF8FULL, 960, 308},
+    {0xD433179D9C8CB841ULL, 986, 316},
+    {0x9E19DB92B4E31BA9ULL, 1013, 324},
+};
+
+static t_diyfp diyfp_sub(t_diyfp x, t_diyfp y)
+{
+  t_diyfp r = {x.f - y.f, x.e};
+  return r;
+}
+
+static t_diyfp diyfp_mul(t_diyfp x, t_diyfp y)
+{
+  t_diyfp r;
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 p = (unsigned __int128)x.f * y.f;
+  uint64_t h = (uint64_t)(p >> 64);
+  uint64_t l = (uint64_t)p;
+  r.f = h + (l >> 63); // round the dropped low half
+#else
+  uint64_t u_lo = x.f & 0xFFFFFFFFu, u_hi = x.f >> 32;
+  uint64_t v_lo = y.f & 0xFFFFFFFFu, v_hi = y.f >> 32;
+  uint64_t p0 = u_lo * v_lo, p1 = u_lo * v_hi, p2 = u_hi * v_lo, p3 = u_hi * v_hi;
+  uint64_t q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu);
+  q += 1ULL << 31; // round
+  r.f = p3 + (p1 >> 32) + (p2 >> 32) + (q >> 32);
+#endif
+  r.e = x.e + y.e + 64;
+  return r;
+}
+
+static t_diyfp diyfp_normalize(t_diyfp x)
+{
+  int shift = __builtin_clzll(x.f);
+  x.f <<= shift;
+  x.e -= shift;
+  return x;
+}
+
+static t_diyfp diyfp_normalize_to(t_diyfp x, int target_exponent)
+{
+  x.f <<= (x.e - target_exponent);
+  x.e = target_exponent;
+  return x;
+}
+
+// Splits a binary floating-point value (its raw exponent and fraction fields)
+// into its normalized value and the normalized boundaries of its rounding
+// interval (m_minus, m_plus share m_plus' exponent).
+static void compute_boundaries(uint64_t biased_e, uint64_t fraction, int bias, uint64_t hidden_bit, t_diyfp *w,
+                               t_diyfp *m_minus, t_diyfp *m_plus)
+{
+  t_diyfp v;
+  if (biased_e == 0)
+  {
+    v.f = fraction;
+    v.e = 1 - bias;
+  }
+  else
+  {
+    v.f = fraction + hidden_bit;
+    v.e = (int)biased_e - bias;
+  }
+
+  int lower_boundary_is_closer = (fraction == 0 && biased_e > 1);
+  t_diyfp plus = {(v.f << 1) + 1, v.e - 1};
+  t_diyfp minus;
+  if (lower_boundary_is_closer)
+  {
+    minus.f = (v.f << 2) - 1;
+    minus.e = v.e - 2;
+  }
+  else
+  {
+    minus.f = (v.f << 1) - 1;
+    minus.e = v.e - 1;
+  }
+
+  *m_plus = diyfp_normalize(plus);
+  *m_minus = diyfp_normalize_to(minus, m_plus->e);
+  *w = diyfp_normalize(v);
+}
+
+static t_cached_power cached_power_for_binary_exponent(int e)
+{
+  // k = ceil((alpha - e - 1) * log10(2)), in fixed point.
+  int f = GRISU_ALPHA - e - 1;
+  int k = (f * 78913) / (1 << 18) + (f > 0);
+  int index = (-CACHED_POWERS_MIN_DEC_EXP + k + (CACHED_POWERS_DEC_STEP - 1)) / CACHED_POWERS_DEC_STEP;
+  return cached_powers[index];
+}
+
+static int find_largest_pow10(uint32_t n, uint32_t *pow10)
+{
+  static const uint32_t powers[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+  int k = 10;
+  while (k > 1 && n < powers[k - 1])
+    k--;
+  *pow10 = powers[k - 1];
+  return k;
+}
+
+static void grisu2_round(char *buffer, int length, uint64_t dist, uint64_t delta, uint64_t rest, uint64_t ten_k)
+{
+  while (rest < dist && delta - rest >= ten_k &&
+         (rest + ten_k < dist || dist - rest > rest + ten_k - dist))
+  {
+    buffer[length - 1]--;
+    rest += ten_k;
+  }
+}
+
+static void grisu2_digit_gen(char *buffer, int *length, int *decimal_exponent,
+                             t_diyfp m_minus, t_diyfp w, t_diyfp m_plus)
+{
+  uint64_t delta = diyfp_sub(m_plus, m_minus).f;
+  uint64_t dist = diyfp_sub(m_plus, w).f;
+
+  const int one_e = m_plus.e;
+  const uint64_t one_f = 1ULL << -one_e;
+
+  uint32_t p1 = (uint32_t)(m_plus.f >> -one_e);
+  uint64_t p2 = m_plus.f & (one_f - 1);
+
+  uint32_t pow10;
+  int n = find_largest_pow10(p1, &pow10);
+
+  while (n > 0)
+  {
+    uint32_t d = p1 / pow10;
+    p1 %= pow10;
+    buffer[(*length)++] = (char)('0' + d);
+    n--;
+
+    uint64_t rest = ((uint64_t)p1 << -one_e) + p2;
+    if (rest <= delta)
+    {
+      *decimal_exponent += n;
+      grisu2_round(buffer, *length, dist, delta, rest, (uint64_t)pow10 << -one_e);
+      return;
+    }
+    pow10 /= 10;
+  }
+
+  int m = 0;
+  for (;;)
+  {
+    p2 *= 10;
+    uint64_t d = p2 >> -one_e;
+    p2 &= one_f - 1;
+    buffer[(*length)++] = (char)('0' + d);
+    m++;
+    delta *= 10;
+    dist *= 10;
+    if (p2 <= delta)
+      break;
+  }
+
+  *decimal_exponent -= m;
+  grisu2_round(buffer, *length, dist, delta, p2, one_f);
+}
+
+// Produces the digits of a positive finite value; value = digits * 10^exponent.
+// The boundaries decide the precision: the digits are the shortest that fall
+// inside the rounding interval of the source type.
+static int grisu2(char *buffer, int *decimal_exponent, t_diyfp w, t_diyfp m_minus, t_diyfp m_plus)
+{
+  t_cached_power cached = cached_power_for_binary_exponent(m_plus.e);
+  t_diyfp c_minus_k = {cached.f, cached.e};
+
+  t_diyfp w_scaled = diyfp_mul(w, c_minus_k);
+  t_diyfp w_minus = diyfp_mul(m_minus, c_minus_k);
+  t_diyfp w_plus = diyfp_mul(m_plus, c_minus_k);
+
+  // Shrink the interval by one ulp on each side to absorb the rounding of
+  // the multiplications above.
+  t_diyfp lower = {w_minus.f + 1, w_minus.e};
+  t_diyfp upper = {w_plus.f - 1, w_plus.e};
+
+  int length = 0;
+  *decimal_exponent = -cached.k;
+  grisu2_digit_gen(buffer, &length, decimal_exponent, lower, w_scaled, upper);
+  return length;
+}
+
+// Lays out digits * 10^exponent like JavaScript does: plain notation for
+// decimal exponents in [-6, 21), scientific notation otherwise.
+static int format_decimal(char *buffer, int length, int decimal_exponent)
+{
+  const int k = length;
+  const int n = length + decimal_exponent; // position of the decimal point
+
+  if (k <= n && n <= 21)
+  {
+    memset(buffer + k, '0', n - k); // digits000
+    return n;
+  }
+
+  if (0 < n && n <= 21)
+  {
+    memmove(buffer + n + 1, buffer + n, k - n); // dig.its
+    buffer[n] = '.';
+    return k + 1;
+  }
+
+  if (-6 < n && n <= 0)
+  {
+    memmove(buffer + 2 - n, buffer, k); // 0.000digits
+    buffer[0] = '0';
+    buffer[1] = '.';
+    memset(buffer + 2, '0', -n);
+    return 2 - n + k;
+  }
+
+  int pos;
+  if (k == 1)
+  {
+    pos = 1; // de123
+  }
+  else
+  {
+    memmove(buffer + 2, buffer + 1, k - 1); // d.igitse123
+    buffer[1] = '.';
+    pos = k + 1;
+  }
+
+  buffer[pos++] = 'e';
+  int exponent = n - 1;
+  if (exponent < 0)
+  {
+    buffer[pos++] = '-';
+    exponent = -exponent;
+  }
+  return pos + format_uint64(buffer + pos, (unsigned long long)exponent);
+}
+
+int format_double(char *buffer, double value)
+{
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  if (((bits >> 52) & 0x7FF) == 0x7FF)
+  {
+    memcpy(buffer, "null", 4);
+    return 4;
+  }
+
+  int pos = 0;
+  if (bits >> 63)
+  {
+    buffer[pos++] = '-';
+    value = -value;
+  }
+
+  if (value == 0.0)
+  {
+    buffer[pos++] = '0';
+    return pos;
+  }
+
+  t_diyfp w, m_minus, m_plus;
+  compute_boundaries((bits >> 52) & 0x7FF, bits & ((1ULL << 52) - 1), 1075, 1ULL << 52, &w, &m_minus, &m_plus);
+
+  int decimal_exponent;
+  int length = grisu2(buffer + pos, &decimal_exponent, w, m_minus, m_plus);
+  return pos + format_decimal(buffer + pos, length, decimal_exponent);
+}
+
+int format_float(char *buffer, float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  if (((bits >> 23) & 0xFF) == 0xFF)
+  {
+    memcpy(buffer, "null", 4);
+    return 4;
+  }
+
+  int pos = 0;
+  if (bits >> 31)
+    buffer[pos++] = '-';
+
+  if ((bits & 0x7FFFFFFF) == 0)
+  {
+    buffer[pos++] = '0';
+    return pos;
+  }
+
+  // 150 = 127 + 23: the same Grisu2 run, with float rounding boundaries.
+  t_diyfp w, m_minus, m_plus;
+  compute_boundaries((bits >> 23) & 0xFF, bits & ((1U << 23) - 1), 150, 1ULL << 23, &w, &m_minus, &m_plus);
+
+  int decimal_exponent;
+  int length = grisu2(buffer + pos, &decimal_exponent, w, m_minus, m_plus);
+  return pos + format_decimal(buffer + pos, length, decimal_exponent);
+}
@@ -0,0 +1,585 @@
+#include <float.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/number_utils.h"
+
+#define MAX_MANTISSA_DIGITS 19
+#define EXPONENT_CAP 0x10000
+#define SMALLEST_POWER_OF_TEN -342
+#define LARGEST_POWER_OF_TEN 308
+#define MAX_EXACT_DIGITS 768 // later digits cannot change a binary64 result, only break a tie
+#define BIGNUM_LIMBS 256     // 8192 bits, more than the widest slow-path comparison
+
+extern const uint64_t power_of_five_128[];
+
+static const double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static inline bool is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define CJSON_SWAR_DIGITS 1
+
+// SWAR helpers: eight ASCII digits are validated and converted with a few
+// 64-bit multiplies instead of eight multiply-adds.
+static inline uint64_t load_eight(const char *p)
+{
+  uint64_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline bool is_eight_digits(uint64_t value)
+{
+  return ((value & 0xF0F0F0F0F0F0F0F0ULL) |
+          (((value + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL;
+}
+
+static inline uint64_t parse_eight_digits(uint64_t value)
+{
+  const uint64_t mask = 0x000000FF000000FFULL;
+  const uint64_t mul1 = 0x000F424000000064ULL; // 100 + (1000000 << 32)
+  const uint64_t mul2 = 0x0000271000000001ULL; // 1 + (10000 << 32)
+
+  value -= 0x3030303030303030ULL;
+  value = (value * 10) + (value >> 8);
+  return (((value & mask) * mul1) + (((value >> 16) & mask) * mul2)) >> 32;
+}
+#endif
+
+// Accumulates a run of digits into *value (wrapping is fine, see the
+// truncation rescan in scan_json_number) and returns the end of the run.
+static const char *consume_digits(const char *p, const char *end, uint64_t *value)
+{
+  uint64_t acc = *value;
+
+#ifdef CJSON_SWAR_DIGITS
+  while (end - p >= 8)
+  {
+    uint64_t chunk = load_eight(p);
+    if (!is_eight_digits(chunk))
+      break;
+    acc = acc * 100000000ULL + parse_eight_digits(chunk);
+    p += 8;
+  }
+#endif
+
+  while (p < end && is_digit(*p))
+  {
+    acc = acc * 10 + (uint64_t)(*p - '0');
+    p++;
+  }
+
+  *value = acc;
+  return p;
+}
+
+int scan_json_number(const char **cursor, const char *end, t_json_number *out)
+{
+  const char *p = *cursor;
+  uint64_t mantissa = 0;
+
+  out->start = p;
+  out->negative = false;
+  out->truncated = false;
+
+  if (p < end && *p == '-')
+  {
+    out->negative = true;
+    p++;
+  }
+
+  const char *int_start = p;
+  if (p >= end || !is_digit(*p))
+    return -1;
+
+  p = consume_digits(p, end, &mantissa);
+  const char *int_end = p;
+  long long exponent = 0;
+
+  const char *frac_start = p;
+  const char *frac_end = p;
+  if (p < end && *p == '.')
+  {
+    p++;
+    frac_start = p;
+    p = consume_digits(p, end, &mantissa);
+    frac_end = p;
+    if (frac_end == frac_start)
+      return -1;
+    exponent = -(long long)(frac_end - frac_start);
+  }
+
+  out->is_integer = (frac_end == int_end);
+
+  if (p < end && (*p == 'e' || *p == 'E'))
+  {
+    p++;
+    bool negative_exp = false;
+    if (p < end && (*p == '+' || *p == '-'))
+    {
+      negative_exp = (*p == '-');
+      p++;
+    }
+    if (p >= end || !is_digit(*p))
+      return -1;
+
+    long long exp_value = 0;
+    while (p < end && is_digit(*p))
+    {
+      if (exp_value < EXPONENT_CAP)
+        exp_value = exp_value * 10 + (*p - '0');
+      p++;
+    }
+    exponent += negative_exp ? -exp_value : exp_value;
+    out->is_integer = false;
+  }
+
+  t_size digit_count = (t_size)(int_end - int_start) + (t_size)(frac_end - frac_start);
+  if (digit_count > MAX_MANTISSA_DIGITS)
+  {
+    // Too many digits for a 64-bit mantissa: keep the first 19 significant
+    // ones (leading zeros do not count) and move the rest into the exponent.
+    const char *q = int_start;
+    int consumed = 0;
+    mantissa = 0;
+
+    while (q < int_end && consumed < MAX_MANTISSA_DIGITS)
+    {
+      if (consumed > 0 || *q != '0')
+      {
+        mantissa = mantissa * 10 + (uint64_t)(*q - '0');
+        consumed++;
+      }
+      q++;
+    }
+
+    long long explicit_exp = exponent + (long long)(frac_end - frac_start);
+    if (q < int_end)
+    {
+      exponent = explicit_exp + (long long)(int_end - q);
+      out->truncated = true;
+    }
+    else
+    {
+      q = frac_start;
+      while (q < frac_end && consumed < MAX_MANTISSA_DIGITS)
+      {
+        if (consumed > 0 || *q != '0')
+        {
+          mantissa = mantissa * 10 + (uint64_t)(*q - '0');
+          consumed++;
+        }
+        q++;
+      }
+      exponent = explicit_exp - (long long)(q - frac_start);
+      out->truncated = (q < frac_end);
+    }
+  }
+
+  out->mantissa = mantissa;
+  out->exponent = exponent;
+  out->end = p;
+  *cursor = p;
+  return 0;
+}
+
+int json_number_to_int64(const t_json_number *number, long long *out)
+{
+  if (!number->is_integer || number->truncated)
+    return -1;
+
+  if (number->negative)
+  {
+    if (number->mantissa > (uint64_t)LLONG_MAX + 1)
+      return -1;
+    *out = (number->mantissa == (uint64_t)LLONG_MAX + 1) ? LLONG_MIN : -(long long)number->mantissa;
+    return 0;
+  }
+
+  if (number->mantissa > (uint64_t)LLONG_MAX)
+    return -1;
+  *out = (long long)number->mantissa;
+  return 0;
+}
+
+typedef struct
+{
+  uint64_t high;
+  uint64_t low;
+} t_u128;
+
+static inline t_u128 multiply_u64(uint64_t a, uint64_t b)
+{
+  t_u128 result;
+#ifdef __SIZEOF_INT128__
+  unsigned __int128 product = (unsigned __int128)a * b;
+  result.high = (uint64_t)(product >> 64);
+  result.low = (uint64_t)product;
+#else
+  uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+  uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+  uint64_t lo_lo = a_lo * b_lo;
+  uint64_t hi_lo = a_hi * b_lo;
+  uint64_t lo_hi = a_lo * b_hi;
+  uint64_t hi_hi = a_hi * b_hi;
+  uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+  result.high = hi_hi + (hi_lo >> 32) + (cross >> 32);
+  result.low = (cross << 32) | (uint32_t)lo_lo;
+#endif
+  return result;
+}
+
+static inline int leading_zeroes(uint64_t value)
+{
+  return __builtin_clzll(value);
+}
+
+// Eisel-Lemire: builds the binary64 bit pattern of w * 10^q (w != 0) from a
+// 128-bit approximation of 5^q. Returns the exponent/mantissa bits without sign.
+static uint64_t eisel_lemire(long long q, uint64_t w)
+{
+  const int mantissa_bits = 52;
+  const int infinite_power = 0x7FF;
+
+  if (q < SMALLEST_POWER_OF_TEN)
+    return 0;
+  if (q > LARGEST_POWER_OF_TEN)
+    return (uint64_t)infinite_power << mantissa_bits;
+
+  int lz = leading_zeroes(w);
+  w <<= lz;
+
+  t_size index = 2 * (t_size)(q - SMALLEST_POWER_OF_TEN);
+  t_u128 product = multiply_u64(w, power_of_five_128[index]);
+
+  // Only the upper 55 bits matter; when they might be off by the truncated
+  // low half of 5^q, refine with the second table word.
+  const uint64_t precision_mask = 0xFFFFFFFFFFFFFFFFULL >> (mantissa_bits + 3);
+  if ((product.high & precision_mask) == precision_mask)
+  {
+    t_u128 second = multiply_u64(w, power_of_five_128[index + 1]);
+    product.low += second.high;
+    if (second.high > product.low)
+      product.high++;
+  }
+
+  int upperbit = (int)(product.high >> 63);
+  int shift = upperbit + 64 - mantissa_bits - 3;
+  uint64_t mantissa = product.high >> shift;
+  int power2 = (int)((((152170 + 65536) * q) >> 16) + 63) + upperbit - lz + 1023;
+
+  if (power2 <= 0)
+  {
+    // Subnormal result.
+    if (-power2 + 1 >= 64)
+      return 0;
+    mantissa >>= -power2 + 1;
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    power2 = (mantissa < (1ULL << mantissa_bits)) ? 0 : 1;
+    return ((uint64_t)power2 << mantissa_bits) | (mantissa & ((1ULL << mantissa_bits) - 1));
+  }
+
+  // Exactly halfway between two doubles: round to even instead of up.
+  if (product.low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1)
+  {
+    if ((mantissa << shift) == product.high)
+      mantissa &= ~1ULL;
+  }
+
+  mantissa += (mantissa & 1);
+  mantissa >>= 1;
+  if (mantissa >= (2ULL << mantissa_bits))
+  {
+    mantissa = 1ULL << mantissa_bits;
+    power2++;
+  }
+  mantissa &= ~(1ULL << mantissa_bits);
+
+  if (power2 >= infinite_power)
+    return (uint64_t)infinite_power << mantissa_bits;
+
+  return ((uint64_t)power2 << mantissa_bits) | mantissa;
+}
+
+// Unsigned big integer for the slow path, little-endian 32-bit limbs.
+typedef struct
+{
+  uint32_t limbs[BIGNUM_LIMBS];
+  int count;
+} t_bignum;
+
+static void bignum_mul_add(t_bignum *n, uint32_t factor, uint32_t addend)
+{
+  uint64_t carry = addend;
+  for (int i = 0; i < n->count; i++)
+  {
+    uint64_t product = (uint64_t)n->limbs[i] * factor + carry;
+    n->limbs[i] = (uint32_t)product;
+    carry = product >> 32;
+  }
+  if (carry && n->count < BIGNUM_LIMBS)
+    n->limbs[n->count++] = (uint32_t)carry;
+}
+
+static void bignum_mul_pow5(t_bignum *n, long long exponent)
+{
+  for (; exponent >= 13; exponent -= 13)
+    bignum_mul_add(n, 1220703125u, 0); // 5^13
+  uint32_t rest = 1;
+  for (; exponent > 0; exponent--)
+    rest *= 5;
+  bignum_mul_add(n, rest, 0);
+}
+
+static void bignum_shift_left(t_bignum *n, long long bits)
+{
+  int limbs = (int)(bits / 32);
+  int shift = (int)(bits % 32);
+  if (n->count == 0)
+    return;
+  if (n->count + limbs + 1 > BIGNUM_LIMBS)
+    limbs = BIGNUM_LIMBS - n->count - 1; // unreachable with the digit cap
+
+  n->limbs[n->count] = 0;
+  for (int i = n->count; i >= 0; i--)
+  {
+    uint32_t high = n->limbs[i] << shift;
+    uint32_t low = (shift && i > 0) ? n->limbs[i - 1] >> (32 - shift) : 0;
+    n->limbs[i + limbs] = high | low;
+  }
+  for (int i = 0; i < limbs; i++)
+    n->limbs[i] = 0;
+  n->count += limbs + 1;
+  while (n->count > 0 && n->limbs[n->count - 1] == 0)
+    n->count--;
+}
+
+static int bignum_compare(const t_bignum *a, const t_bignum *b)
+{
+  if (a->count != b->count)
+    return a->count < b->count ? -1 : 1;
+  for (int i = a->count - 1; i >= 0; i--)
+  {
+    if (a->limbs[i] != b->limbs[i])
+      return a->limbs[i] < b->limbs[i] ? -1 : 1;
+  }
+  return 0;
+}
+
+static void bignum_set(t_bignum *n, uint64_t value)
+{
+  n->count = 0;
+  for (; value; value >>= 32)
+    n->limbs[n->count++] = (uint32_t)value;
+}
+
+// Slow path for mantissas with more than 19 digits that Eisel-Lemire cannot
+// settle: the result is lower or the double right above it, so the decimal
+// digits are compared exactly against the halfway point between the two.
+// Locale independent, allocation free and thread safe.
+static uint64_t decimal_slow_path(const t_json_number *number, uint64_t lower)
+{
+  static const uint32_t powers_of_ten[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+  // digits * 10^exponent, keeping the first MAX_EXACT_DIGITS significant digits.
+  t_bignum digits;
+  digits.count = 0;
+  long long exponent = 0;
+  int kept = 0;
+  bool in_fraction = false;
+  bool dropped_nonzero = false;
+  uint32_t chunk = 0;
+  int chunk_length = 0;
+
+  const char *p = number->start;
+  if (p < number->end && *p == '-')
+    p++;
+  for (; p < number->end && *p != 'e' && *p != 'E'; p++)
+  {
+    if (*p == '.')
+    {
+      in_fraction = true;
+      continue;
+    }
+    uint32_t digit = (uint32_t)(*p - '0');
+    if (in_fraction)
+      exponent--;
+    if (kept == 0 && digit == 0)
+      continue;
+
+    if (kept == MAX_EXACT_DIGITS)
+    {
+      exponent++;
+      dropped_nonzero |= digit != 0;
+      continue;
+    }
+    chunk = chunk * 10 + digit;
+    kept++;
+    if (++chunk_length == 9)
+    {
+      bignum_mul_add(&digits, powers_of_ten[9], chunk);
+      chunk = 0;
+      chunk_length = 0;
+    }
+  }
+  bignum_mul_add(&digits, powers_of_ten[chunk_length], chunk);
+
+  if (p < number->end)
+  {
+    p++;
+    bool negative_exp = (*p == '-');
+    if (*p == '+' || *p == '-')
+      p++;
+    long long exp_value = 0;
+    for (; p < number->end; p++)
+    {
+      if (exp_value < EXPONENT_CAP)
+        exp_value = exp_value * 10 + (*p - '0');
+    }
+    exponent += negative_exp ? -exp_value : exp_value;
+  }
+
+  // Halfway point (2m + 1) * 2^(e - 1), where lower = m * 2^e.
+  const uint64_t fraction_mask = (1ULL << 52) - 1;
+  int biased = (int)(lower >> 52);
+  uint64_t m = lower & fraction_mask;
+  long long e = -1074;
+  if (biased > 0)
+  {
+    m |= 1ULL << 52;
+    e = biased - 1075;
+  }
+  t_bignum halfway;
+  bignum_set(&halfway, 2 * m + 1);
+
+  // digits * 5^E * 2^E against halfway * 2^(e - 1): each power of five goes
+  // to the side where it is non-negative, and the net power of two likewise.
+  long long twos = e - 1 - exponent;
+  if (exponent >= 0)
+    bignum_mul_pow5(&digits, exponent);
+  else
+    bignum_mul_pow5(&halfway, -exponent);
+  if (twos >= 0)
+    bignum_shift_left(&halfway, twos);
+  else
+    bignum_shift_left(&digits, -twos);
+
+  int order = bignum_compare(&digits, &halfway);
+  if (order > 0 || (order == 0 && (dropped_nonzero || (lower & 1))))
+    return lower + 1;
+  return lower;
+}
+
+double json_number_to_double(const t_json_number *number)
+{
+  uint64_t w = number->mantissa;
+  long long q = number->exponent;
+
+  if (w == 0)
+    return number->negative ? -0.0 : 0.0;
+
+#if FLT_EVAL_METHOD == 0
+  // Clinger's fast path: both operands are exact doubles, so one IEEE
+  // multiply or divide rounds correctly.
+  if (!number->truncated && q >= -22 && q <= 22 && w <= (1ULL << 53))
+  {
+    double value = (double)w;
+    value = q < 0 ? value / exact_powers_of_ten[-q] : value * exact_powers_of_ten[q];
+    return number->negative ? -value : value;
+  }
+#endif
+
+  uint64_t bits = eisel_lemire(q, w);
+
+  // With dropped digits the true value lies in (w, w + 1) * 10^q; if both
+  // ends round the same way so does the value.
+  if (number->truncated && bits != eisel_lemire(q, w + 1))
+    bits = decimal_slow_path(number, bits);
+
+  if (number->negative)
+    bits |= 1ULL << 63;
+
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+int json_number_to_int(const t_json_number *number, int *out)
+{
+  long long value;
+  if (json_number_to_int_range(number, INT_MIN, INT_MAX, &value) != 0)
+    return -1;
+
+  *out = (int)value;
+  return 0;
+}
+
+int json_number_to_int_range(const t_json_number *number, long long min, long long max, long long *out)
+{
+  long long value;
+  if (json_number_to_int64(number, &value) != 0)
+  {
+    double real = json_number_to_double(number);
+    if (number->is_integer || !(real > (double)min - 1.0 && real < (double)max + 1.0))
+      return -1;
+    value = (long long)real;
+  }
+
+  if (value < min || value > max)
+    return -1;
+
+  *out = value;
+  return 0;
+}
+
+// Integers past 19 digits: reads every digit again, exactly.
+static int integer_text_to_uint64(const t_json_number *number, unsigned long long *out)
+{
+  unsigned long long value = 0;
+  for (const char *p = number->start; p < number->end; p++)
+  {
+    if (*p < '0' || *p > '9')
+      continue;
+    unsigned int digit = (unsigned int)(*p - '0');
+    if (value > (ULLONG_MAX - digit) / 10)
+      return -1;
+    value = value * 10 + digit;
+  }
+  *out = value;
+  return 0;
+}
+
+int json_number_to_uint_range(const t_json_number *number, unsigned long long max, unsigned long long *out)
+{
+  unsigned long long value;
+  if (number->is_integer)
+  {
+    if (number->negative && number->mantissa != 0)
+      return -1;
+    if (!number->truncated)
+      value = number->mantissa;
+    else if (integer_text_to_uint64(number, &value) != 0)
+      return -1;
+  }
+  else
+  {
+    double real = json_number_to_double(number);
+    if (!(real > -1.0 && real < (double)max + 1.0))
+      return -1;
+    value = (unsigned long long)real;
+  }
+
+  if (value > max)
+    return -1;
+
+  *out = value;
+  return 0;
+}
@@ -0,0 +1,175 @@
+#include <stddef.h>
+#include "../../include/simd_scan.h"
+
+#if !defined(CJSON_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CJSON_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+typedef const char *(*t_scan_n_fn)(const char *p, const char *end);
+
+static inline int is_string_special(unsigned char c)
+{
+  return c == '"' || c == '\\' || c < 0x20;
+}
+
+static inline int is_container_special(unsigned char c)
+{
+  return c == '"' || c == '{' || c == '}' || c == '[' || c == ']';
+}
+
+static const char *scan_scalar_n(const char *p, const char *end)
+{
+  while (p < end && !is_string_special((unsigned char)*p))
+    p++;
+  return p;
+}
+
+static const char *scan_container_scalar_n(const char *p, const char *end)
+{
+  while (p < end && !is_container_special((unsigned char)*p))
+    p++;
+  return p;
+}
+
+#ifdef CJSON_SIMD_X86
+
+__attribute__((target("sse2"))) static const char *scan_sse2_n(const char *p, const char *end)
+{
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control_max = _mm_set1_epi8(0x1F);
+
+  while (end - p >= 16)
+  {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+    __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+    special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(chunk, control_max), chunk));
+
+    int mask = _mm_movemask_epi8(special);
+    if (mask != 0)
+      return p + __builtin_ctz((unsigned int)mask);
+    p += 16;
+  }
+  return scan_scalar_n(p, end);
+}
+
+__attribute__((target("avx2"))) static const char *scan_avx2_n(const char *p, const char *end)
+{
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i control_max = _mm256_set1_epi8(0x1F);
+
+  while (end - p >= 32)
+  {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *)p);
+    __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash));
+    special = _mm256_or_si256(special, _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control_max), chunk));
+
+    unsigned int mask = (unsigned int)_mm256_movemask_epi8(special);
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return scan_sse2_n(p, end);
+}
+
+// '[' and '{' (also ']' and '}') are equal once OR'ed with 0x20, and no other
+// byte folds onto either, so two compares cover all four brackets.
+
+__attribute__((target("sse2"))) static const char *scan_container_sse2_n(const char *p, const char *end)
+{
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i case_bit = _mm_set1_epi8(0x20);
+  const __m128i open = _mm_set1_epi8('{');
+  const __m128i close = _mm_set1_epi8('}');
+
+  while (end - p >= 16)
+  {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+    __m128i folded = _mm_or_si128(chunk, case_bit);
+    __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                   _mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)));
+
+    int mask = _mm_movemask_epi8(special);
+    if (mask != 0)
+      return p + __builtin_ctz((unsigned int)mask);
+    p += 16;
+  }
+  return scan_container_scalar_n(p, end);
+}
+
+__attribute__((target("avx2"))) static const char *scan_container_avx2_n(const char *p, const char *end)
+{
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i case_bit = _mm256_set1_epi8(0x20);
+  const __m256i open = _mm256_set1_epi8('{');
+  const __m256i close = _mm256_set1_epi8('}');
+
+  while (end - p >= 32)
+  {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *)p);
+    __m256i folded = _mm256_or_si256(chunk, case_bit);
+    __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+                                      _mm256_or_si256(_mm256_cmpeq_epi8(folded, open), _mm256_cmpeq_epi8(folded, close)));
+
+    unsigned int mask = (unsigned int)_mm256_movemask_epi8(special);
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return scan_container_sse2_n(p, end);
+}
+
+#endif
+
+static t_scan_n_fn select_scan_n_fn(void)
+{
+#ifdef CJSON_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return scan_avx2_n;
+  if (__builtin_cpu_supports("sse2"))
+    return scan_sse2_n;
+#endif
+  return scan_scalar_n;
+}
+
+static t_scan_n_fn select_scan_container_fn(void)
+{
+#ifdef CJSON_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return scan_container_avx2_n;
+  if (__builtin_cpu_supports("sse2"))
+    return scan_container_sse2_n;
+#endif
+  return scan_container_scalar_n;
+}
+
+static t_scan_n_fn scan_n_impl = NULL;
+static t_scan_n_fn scan_container_impl = NULL;
+
+// Parallel decode workers may get here first at the same time. Every thread
+// selects the same function, so a relaxed atomic store and load are enough.
+const char *scan_string_special_n(const char *p, const char *end)
+{
+  t_scan_n_fn impl = __atomic_load_n(&scan_n_impl, __ATOMIC_RELAXED);
+  if (impl == NULL)
+  {
+    impl = select_scan_n_fn();
+    __atomic_store_n(&scan_n_impl, impl, __ATOMIC_RELAXED);
+  }
+  return impl(p, end);
+}
+
+const char *scan_container_special_n(const char *p, const char *end)
+{
+  t_scan_n_fn impl = __atomic_load_n(&scan_container_impl, __ATOMIC_RELAXED);
+  if (impl == NULL)
+  {
+    impl = select_scan_container_fn();
+    __atomic_store_n(&scan_container_impl, impl, __ATOMIC_RELAXED);
+  }
+  return impl(p, end);
+}
@@ -1,25 +1,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "../../include/simd_scan.h"
+#include "../../include/allocator.h"
+#include "../../include/string_utils.h"
 
-char peek_current(const char *text)
+// Cursor helpers never read at or past end; '\0' is what they report there.
+char peek_current(const char *text, const char *end)
 {
-  if (text == NULL)
+  if (text == NULL || text >= end)
     return '\0';
 
   return *text;
 }
 
-char peek_next(const char *text)
+char peek_next(const char *text, const char *end)
 {
-  if (text == NULL)
+  if (text == NULL || text + 1 >= end)
     return '\0';
   return *(text + 1);
 }
 
-int match_and_consume(const char **cursor, char expected)
+int match_and_consume(const char **cursor, const char *end, char expected)
 {
-  if (**cursor == expected)
+  if (*cursor < end && **cursor == expected)
   {
     (*cursor)++;
     return 1;
@@ -27,9 +31,9 @@ int match_and_consume(const char **cursor, char expected)
   return 0;
 }
 
-void consume_and_append(const char **source, char **out)
+void consume_and_append(const char **source, const char *end, char **out)
 {
-  if (*source == NULL || **source == '\0')
+  if (*source == NULL || *source >= end)
     return;
 
   **out = **source;
@@ -40,7 +44,7 @@ void consume_and_append(const char **source, char **out)
 
 char *get_string_buffer(int length)
 {
-  char *buffer = (char *)malloc(sizeof(char) * (length + 1));
+  char *buffer = (char *)allocator_alloc(NULL, sizeof(char) * (length + 1));
   if (buffer == NULL)
     return NULL;
 
@@ -48,18 +52,18 @@ char *get_string_buffer(int length)
   return buffer;
 }
 
-void skip_whitespace(const char **text)
+void skip_whitespace(const char **text, const char *end)
 {
-  while (*text != NULL && (**text == ' ' || **text == '\t' || **text == '\n' || **text == '\r'))
+  while (*text != NULL && *text < end && (**text == ' ' || **text == '\t' || **text == '\n' || **text == '\r'))
     (*text)++;
 }
 
-void consume_until_delimiter(const char **cursor, char **out, char delimiter)
+void consume_until_delimiter(const char **cursor, const char *end, char **out, char delimiter)
 {
-  if (*cursor == NULL || **cursor == '\0')
+  if (*cursor == NULL || *cursor >= end)
     return;
 
-  while (**cursor != '\0' && !match_and_consume(cursor, delimiter))
+  while (*cursor < end && !match_and_consume(cursor, end, delimiter))
   {
     **out = **cursor;
     (*out)++;
@@ -67,3 +71,161 @@ void consume_until_delimiter(const char **cursor, char **out, char delimiter)
   }
   **out = '\0';
 }
+
+static int parse_hex4(const char *p, unsigned int *out)
+{
+  unsigned int value = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    char c = p[i];
+    value <<= 4;
+    if (c >= '0' && c <= '9')
+      value |= (unsigned int)(c - '0');
+    else if (c >= 'a' && c <= 'f')
+      value |= (unsigned int)(c - 'a' + 10);
+    else if (c >= 'A' && c <= 'F')
+      value |= (unsigned int)(c - 'A' + 10);
+    else
+      return -1;
+  }
+  *out = value;
+  return 0;
+}
+
+static char *write_utf8(char *out, unsigned int codepoint)
+{
+  if (codepoint < 0x80)
+  {
+    *out++ = (char)codepoint;
+  }
+  else if (codepoint < 0x800)
+  {
+    *out++ = (char)(0xC0 | (codepoint >> 6));
+    *out++ = (char)(0x80 | (codepoint & 0x3F));
+  }
+  else if (codepoint < 0x10000)
+  {
+    *out++ = (char)(0xE0 | (codepoint >> 12));
+    *out++ = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    *out++ = (char)(0x80 | (codepoint & 0x3F));
+  }
+  else
+  {
+    *out++ = (char)(0xF0 | (codepoint >> 18));
+    *out++ = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+    *out++ = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    *out++ = (char)(0x80 | (codepoint & 0x3F));
+  }
+  return out;
+}
+
+// Decodes the raw string body [src, end) into out, copying escape-free runs
+// with one memcpy each. out needs room for end - src bytes: no escape sequence
+// decodes to more bytes than it occupies. Returns the decoded length or -1.
+int unescape_json_string(const char *src, const char *end, char *out)
+{
+  return unescape_json_string_n(src, end, out, (size_t)(end - src));
+}
+
+static size_t utf8_length(unsigned int codepoint)
+{
+  return codepoint < 0x80 ? 1 : codepoint < 0x800 ? 2 : codepoint < 0x10000 ? 3 : 4;
+}
+
+int unescape_json_string_n(const char *src, const char *end, char *out, size_t capacity)
+{
+  char *start = out;
+  char *limit = out + capacity;
+
+  while (src < end)
+  {
+    const char *run = scan_string_special_n(src, end);
+
+    if (run - src > limit - out)
+      return -2;
+    memcpy(out, src, run - src);
+    out += run - src;
+    src = run;
+
+    if (src >= end)
+      break;
+
+    if (out >= limit)
+      return -2;
+
+    if (*src != '\\')
+    {
+      *out++ = *src++; // raw control byte
+      continue;
+    }
+
+    if (src + 1 >= end)
+      return -1;
+
+    char escape = src[1];
+    src += 2;
+
+    switch (escape)
+    {
+    case '"':
+      *out++ = '"';
+      break;
+    case '\\':
+      *out++ = '\\';
+      break;
+    case '/':
+      *out++ = '/';
+      break;
+    case 'b':
+      *out++ = '\b';
+      break;
+    case 'f':
+      *out++ = '\f';
+      break;
+    case 'n':
+      *out++ = '\n';
+      break;
+    case 'r':
+      *out++ = '\r';
+      break;
+    case 't':
+      *out++ = '\t';
+      break;
+    case 'u':
+    {
+      unsigned int codepoint;
+      if (end - src < 4 || parse_hex4(src, &codepoint) != 0)
+        return -1;
+      src += 4;
+
+      if (codepoint >= 0xD800 && codepoint <= 0xDBFF)
+      {
+        unsigned int low;
+        if (end - src >= 6 && src[0] == '\\' && src[1] == 'u' &&
+            parse_hex4(src + 2, &low) == 0 && low >= 0xDC00 && low <= 0xDFFF)
+        {
+          codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+          src += 6;
+        }
+        else
+        {
+          codepoint = 0xFFFD; // lone high surrogate
+        }
+      }
+      else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF)
+      {
+        codepoint = 0xFFFD; // lone low surrogate
+      }
+
+      if (utf8_length(codepoint) > (size_t)(limit - out))
+        return -2;
+      out = write_utf8(out, codepoint);
+      break;
+    }
+    default:
+      return -1;
+    }
+  }
+
+  return (int)(out - start);
+}
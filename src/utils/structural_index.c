@@ -0,0 +1,342 @@
+#include <stddef.h>
+#include <string.h>
+#include "../../include/structural_index.h"
+
+#if !defined(CJSON_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CJSON_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// Per-block bitmasks, bit i describing byte i of a 64-byte block.
+typedef struct
+{
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t op; // { } [ ] : ,
+  uint64_t whitespace;
+} t_block_masks;
+
+typedef void (*t_classify_fn)(const char *block, t_block_masks *out);
+typedef void (*t_refill_fn)(t_structural_index *index);
+
+static inline void classify_scalar(const char *block, t_block_masks *out)
+{
+  uint64_t quote = 0, backslash = 0, op = 0, whitespace = 0;
+
+  for (int i = 0; i < 64; i++)
+  {
+    uint64_t bit = (uint64_t)1 << i;
+    switch (block[i])
+    {
+    case '"':
+      quote |= bit;
+      break;
+    case '\\':
+      backslash |= bit;
+      break;
+    case '{':
+    case '}':
+    case '[':
+    case ']':
+    case ':':
+    case ',':
+      op |= bit;
+      break;
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+      whitespace |= bit;
+      break;
+    default:
+      break;
+    }
+  }
+
+  out->quote = quote;
+  out->backslash = backslash;
+  out->op = op;
+  out->whitespace = whitespace;
+}
+
+#ifdef CJSON_SIMD_X86
+
+// '{' and '}' (also '[' and ']') differ only in bit 0x20 once OR'ed with it:
+// 0x7B|0x20 == 0x7B, 0x5B|0x20 == 0x7B, 0x7D|0x20 == 0x7D, 0x5D|0x20 == 0x7D.
+
+__attribute__((target("sse4.2"))) static inline uint64_t sse_mask(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+  return (uint64_t)(uint16_t)_mm_movemask_epi8(a) | (uint64_t)(uint16_t)_mm_movemask_epi8(b) << 16 |
+         (uint64_t)(uint16_t)_mm_movemask_epi8(c) << 32 | (uint64_t)(uint16_t)_mm_movemask_epi8(d) << 48;
+}
+
+__attribute__((target("sse4.2"))) static inline void classify_sse42(const char *block, t_block_masks *out)
+{
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i case_bit = _mm_set1_epi8(0x20);
+  const __m128i open = _mm_set1_epi8('{');
+  const __m128i close = _mm_set1_epi8('}');
+  const __m128i colon = _mm_set1_epi8(':');
+  const __m128i comma = _mm_set1_epi8(',');
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i carriage = _mm_set1_epi8('\r');
+  __m128i q[4], b[4], o[4], w[4];
+
+  for (int i = 0; i < 4; i++)
+  {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)(block + 16 * i));
+    __m128i folded = _mm_or_si128(chunk, case_bit);
+    q[i] = _mm_cmpeq_epi8(chunk, quote);
+    b[i] = _mm_cmpeq_epi8(chunk, backslash);
+    o[i] = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+                        _mm_or_si128(_mm_cmpeq_epi8(chunk, colon), _mm_cmpeq_epi8(chunk, comma)));
+    w[i] = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+                        _mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, carriage)));
+  }
+
+  out->quote = sse_mask(q[0], q[1], q[2], q[3]);
+  out->backslash = sse_mask(b[0], b[1], b[2], b[3]);
+  out->op = sse_mask(o[0], o[1], o[2], o[3]);
+  out->whitespace = sse_mask(w[0], w[1], w[2], w[3]);
+}
+
+__attribute__((target("avx2"))) static inline uint64_t avx_mask(__m256i low, __m256i high)
+{
+  return (uint64_t)(uint32_t)_mm256_movemask_epi8(low) | (uint64_t)(uint32_t)_mm256_movemask_epi8(high) << 32;
+}
+
+__attribute__((target("avx2"))) static inline void classify_avx2(const char *block, t_block_masks *out)
+{
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i case_bit = _mm256_set1_epi8(0x20);
+  const __m256i open = _mm256_set1_epi8('{');
+  const __m256i close = _mm256_set1_epi8('}');
+  const __m256i colon = _mm256_set1_epi8(':');
+  const __m256i comma = _mm256_set1_epi8(',');
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i carriage = _mm256_set1_epi8('\r');
+  __m256i q[2], b[2], o[2], w[2];
+
+  for (int i = 0; i < 2; i++)
+  {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *)(block + 32 * i));
+    __m256i folded = _mm256_or_si256(chunk, case_bit);
+    q[i] = _mm256_cmpeq_epi8(chunk, quote);
+    b[i] = _mm256_cmpeq_epi8(chunk, backslash);
+    o[i] = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(folded, open), _mm256_cmpeq_epi8(folded, close)),
+                           _mm256_or_si256(_mm256_cmpeq_epi8(chunk, colon), _mm256_cmpeq_epi8(chunk, comma)));
+    w[i] = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, tab)),
+                           _mm256_or_si256(_mm256_cmpeq_epi8(chunk, newline), _mm256_cmpeq_epi8(chunk, carriage)));
+  }
+
+  out->quote = avx_mask(q[0], q[1]);
+  out->backslash = avx_mask(b[0], b[1]);
+  out->op = avx_mask(o[0], o[1]);
+  out->whitespace = avx_mask(w[0], w[1]);
+}
+
+#endif
+
+
+// Bits of backslash-escaped bytes: the odd members of every backslash run
+// and the byte right after a run of odd length.
+static uint64_t find_escaped(uint64_t backslash, uint64_t *prev_escaped)
+{
+  const uint64_t even_bits = 0x5555555555555555ULL;
+
+  backslash &= ~*prev_escaped;
+  uint64_t follows_escape = backslash << 1 | *prev_escaped;
+  uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+
+  uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+  *prev_escaped = sequences_starting_on_even_bits < odd_sequence_starts; // carry out
+
+  uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+  return (even_bits ^ invert_mask) & follows_escape;
+}
+
+static uint64_t prefix_xor(uint64_t bits)
+{
+  bits ^= bits << 1;
+  bits ^= bits << 2;
+  bits ^= bits << 4;
+  bits ^= bits << 8;
+  bits ^= bits << 16;
+  bits ^= bits << 32;
+  return bits;
+}
+
+static inline uint64_t index_block(t_structural_index *index, const t_block_masks *block)
+{
+  t_block_masks masks = *block;
+  uint64_t escaped = find_escaped(masks.backslash, &index->prev_escaped);
+  uint64_t quote = masks.quote & ~escaped;
+
+  // Set from an opening quote up to, not including, its closing quote.
+  uint64_t in_string = prefix_xor(quote) ^ index->prev_in_string;
+  index->prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+
+  uint64_t scalar = ~(masks.op | masks.whitespace | quote);
+  uint64_t scalar_start = scalar & ~(scalar << 1 | index->prev_scalar);
+  index->prev_scalar = scalar >> 63;
+
+  return ((masks.op | scalar_start) & ~in_string) | quote;
+}
+
+// Classifies one window. Inlined into a copy per instruction set so the
+// classifier is not an indirect call per block.
+static inline __attribute__((always_inline)) void refill_window(t_structural_index *index, t_classify_fn classify)
+{
+  const char *window = index->classified;
+  const char *limit = window + STRUCTURAL_INDEX_WINDOW;
+  if (limit > index->end || limit < window)
+    limit = index->end;
+
+  uint32_t count = 0;
+  const char *block = window;
+  t_block_masks masks;
+
+  while (block < limit)
+  {
+    if ((t_size)(index->end - block) >= 64)
+    {
+      classify(block, &masks);
+    }
+    else
+    {
+      // Pad the tail with spaces: they add no positions and end any atom.
+      char tail[64];
+      t_size remaining = (t_size)(index->end - block);
+      memcpy(tail, block, remaining);
+      memset(tail + remaining, ' ', 64 - remaining);
+      classify(tail, &masks);
+    }
+
+    uint64_t bits = index_block(index, &masks);
+    uint32_t base = (uint32_t)(block - window);
+    while (bits)
+    {
+      index->positions[count++] = base + (uint32_t)__builtin_ctzll(bits);
+      bits &= bits - 1;
+    }
+    block += 64;
+  }
+
+  index->window = window;
+  index->classified = block < index->end ? block : index->end;
+  index->count = count;
+  index->next = 0;
+}
+
+static void refill_scalar(t_structural_index *index)
+{
+  refill_window(index, classify_scalar);
+}
+
+#ifdef CJSON_SIMD_X86
+__attribute__((target("sse4.2"))) static void refill_sse42(t_structural_index *index)
+{
+  refill_window(index, classify_sse42);
+}
+
+__attribute__((target("avx2"))) static void refill_avx2(t_structural_index *index)
+{
+  refill_window(index, classify_avx2);
+}
+#endif
+
+static t_refill_fn select_refill_fn(void)
+{
+#ifdef CJSON_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return refill_avx2;
+  if (__builtin_cpu_supports("sse4.2"))
+    return refill_sse42;
+#endif
+  return refill_scalar;
+}
+
+static t_refill_fn refill_impl = NULL;
+
+void structural_index_init(t_structural_index *index, const char *input, const char *end)
+{
+  // Every thread selects the same function; the atomics only keep it race-free.
+  if (__atomic_load_n(&refill_impl, __ATOMIC_RELAXED) == NULL)
+    __atomic_store_n(&refill_impl, select_refill_fn(), __ATOMIC_RELAXED);
+
+  index->input = input;
+  index->end = end;
+  index->classified = input;
+  index->prev_in_string = 0;
+  index->prev_escaped = 0;
+  index->prev_scalar = 0;
+  index->window = input;
+  index->count = 0;
+  index->next = 0;
+}
+
+const char *structural_index_refill_next(t_structural_index *index, const char *from)
+{
+  for (;;)
+  {
+    if (index->classified >= index->end)
+      return index->end;
+    __atomic_load_n(&refill_impl, __ATOMIC_RELAXED)(index);
+
+    while (index->next < index->count)
+    {
+      const char *position = index->window + index->positions[index->next];
+      if (position >= from)
+        return position;
+      index->next++;
+    }
+  }
+}
+
+long structural_index_count_elements(const t_structural_index *index, const char *open, uint32_t max_entries)
+{
+  uint32_t i = index->next;
+  while (i < index->count && index->window + index->positions[i] < open)
+    i++;
+  if (i >= index->count || index->window + index->positions[i] != open || *open != '[')
+    return -1;
+
+  uint32_t limit = index->count - i > max_entries ? i + max_entries : index->count;
+  long elements = 0;
+  int depth = 0;
+  for (; i < limit; i++)
+  {
+    // Nothing inside a string is indexed, so every entry here is structural.
+    switch (index->window[index->positions[i]])
+    {
+    case '[':
+    case '{':
+      if (depth == 1 && elements == 0)
+        elements = 1;
+      depth++;
+      break;
+    case ']':
+    case '}':
+      if (--depth == 0)
+        return elements;
+      break;
+    case ',':
+      if (depth == 1)
+        elements++;
+      break;
+    default:
+      // A quote or the first byte of a number or literal.
+      if (depth == 1 && elements == 0)
+        elements = 1;
+      break;
+    }
+  }
+  return -1;
+}
@@ -0,0 +1,26 @@
+#ifndef TEST_H
+#define TEST_H
+#include <stdio.h>
+
+// Minimal checks for the programs in tests/: each one counts its failures and
+// exits non-zero when any check failed, so `make test` stops on it.
+
+static int test_failures = 0;
+
+#define CHECK(cond)                                                   \
+  do                                                                  \
+  {                                                                   \
+    if (!(cond))                                                      \
+    {                                                                 \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      test_failures++;                                                \
+    }                                                                 \
+  } while (0)
+
+static int test_report(const char *name)
+{
+  printf("%s: %s\n", name, test_failures ? "FAILED" : "ok");
+  return test_failures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "../include/cjson.h"
+#include "../include/arena.h"
+#include "test.h"
+#include "test_models.h"
+
+// Arena decoding must produce the same document as a heap decode, fail cleanly
+// when a fixed buffer runs out, and hand out the same memory again after a reset.
+
+static char *heap_encoding(t_json_model *model)
+{
+  Sample s = {0};
+  CHECK(cjson_decode(sample_json, model, &s) == 0);
+  char *json = cjson_encode(&s, model, false);
+  cjson_free_instance(&s, model);
+  return json;
+}
+
+static void test_growing_arena(t_json_model *model, const char *expected)
+{
+  t_json_arena arena;
+  arena_init(&arena, NULL, 0, 256); // small blocks, so the decode spans several
+  const char *first = NULL;
+
+  for (int round = 0; round < 3; round++)
+  {
+    Sample s = {0};
+    CHECK(cjson_decode_arena(sample_json, model, &s, &arena) == 0);
+    CHECK(s.name && s.tags && s.pets && s.home);
+
+    char *json = cjson_encode(&s, model, false);
+    CHECK(json && strcmp(json, expected) == 0);
+    cjson_free(json);
+
+    // The blocks are kept across resets: every round reuses the same memory.
+    if (round == 0)
+      first = s.name;
+    else
+      CHECK(s.name == first);
+    arena_reset(&arena);
+  }
+  arena_destroy(&arena);
+}
+
+static void test_fixed_buffer(t_json_model *model, const char *expected)
+{
+  static char storage[16 * 1024];
+  t_json_arena arena;
+
+  // Too small: the decode fails instead of falling back to malloc.
+  arena_init(&arena, storage, 64, 0);
+  Sample s = {0};
+  CHECK(cjson_decode_arena(sample_json, model, &s, &arena) == -1);
+
+  arena_init(&arena, storage, sizeof(storage), 0);
+  memset(&s, 0, sizeof(s));
+  CHECK(cjson_decode_arena(sample_json, model, &s, &arena) == 0);
+  CHECK(s.name >= storage && s.name < storage + sizeof(storage));
+
+  char *json = cjson_encode(&s, model, false);
+  CHECK(json && strcmp(json, expected) == 0);
+  cjson_free(json);
+  arena_destroy(&arena);
+}
+
+static void test_alignment_and_adopt(void)
+{
+  t_json_arena arena, worker;
+  arena_init(&arena, NULL, 0, 128);
+  arena_init(&worker, NULL, 0, 128);
+
+  for (t_size size = 1; size < 300; size += 37)
+  {
+    char *p = arena_alloc(&arena, size);
+    CHECK(p && ((uintptr_t)p % ARENA_ALIGNMENT) == 0);
+    memset(p, 0xAB, size);
+  }
+
+  char *kept = arena_alloc(&worker, 200);
+  CHECK(kept != NULL);
+  strcpy(kept, "carved from the worker");
+
+  // Adopted data stays valid; the source is left empty and reusable.
+  CHECK(arena_adopt(&arena, &worker));
+  CHECK(strcmp(kept, "carved from the worker") == 0);
+  CHECK(worker.blocks == NULL && worker.current == NULL);
+  CHECK(arena_calloc(&arena, 64) != NULL);
+
+  // A caller buffer cannot change owner.
+  char storage[64];
+  t_json_arena fixed;
+  arena_init(&fixed, storage, sizeof(storage), 0);
+  CHECK(!arena_adopt(&arena, &fixed));
+
+  arena_destroy(&worker);
+  arena_destroy(&arena);
+}
+
+int main(void)
+{
+  t_json_model *interpreted = sample_model(false);
+  t_json_model *compiled = sample_model(true);
+  CHECK(interpreted && compiled);
+  if (!interpreted || !compiled)
+    return test_report("test_arena");
+
+  char *expected = heap_encoding(interpreted);
+  CHECK(expected != NULL);
+
+  test_growing_arena(interpreted, expected);
+  test_growing_arena(compiled, expected);
+  test_fixed_buffer(interpreted, expected);
+  test_fixed_buffer(compiled, expected);
+  test_alignment_and_adopt();
+
+  cjson_free(expected);
+  return test_report("test_arena");
+}
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/cjson.h"
+#include "test.h"
+#include "test_models.h"
+
+// A compiled model must decode and encode exactly like the interpreted one, and
+// a model is freed through the allocator it was created with.
+
+static void check_values(const Sample *s)
+{
+  CHECK(s->id == 42);
+  CHECK(s->score == -1.25e-3);
+  CHECK(s->name && strcmp(s->name, "Ana \"A\" Souza\n\xc3\xa9\xf0\x9f\x98\x80") == 0);
+  CHECK(s->active);
+  CHECK(s->home && s->home->zip == 20000 && strcmp(s->home->city, "Rio") == 0);
+  CHECK(s->work.zip == 30000 && strcmp(s->work.city, "S\xc3\xa3o Paulo") == 0);
+  CHECK(s->ints && s->ints->count == 4 && ((int *)s->ints->data)[3] == -2147483647 - 1);
+  CHECK(s->doubles && s->doubles->count == 4 && ((double *)s->doubles->data)[1] == 1e300);
+  CHECK(s->tags && s->tags->count == 3 && strcmp(((char **)s->tags->data)[2], "tab\there") == 0);
+  CHECK(s->pets && s->pets->count == 2 && ((Pet **)s->pets->data)[1]->age == 1);
+  CHECK(s->visits && s->visits->count == 3 && strcmp(((Place *)s->visits->data)[2].city, "Bogota") == 0);
+  CHECK(s->timestamp == -1700000000000LL);
+  CHECK(s->flags == 4294967295u);
+  CHECK(s->ratio == 0.3f);
+  CHECK(strcmp(s->code, "AB/CD") == 0);
+  CHECK(s->grid[0] == -32768 && s->grid[2] == 32767);
+  CHECK(s->secret == NULL);
+}
+
+static int replaced_frees;
+
+static void *replaced_alloc(void *ctx, t_size size)
+{
+  (void)ctx;
+  return malloc(size);
+}
+
+static void *replaced_realloc(void *ctx, void *ptr, t_size size)
+{
+  (void)ctx;
+  return realloc(ptr, size);
+}
+
+static void replaced_free(void *ctx, void *ptr)
+{
+  (void)ctx;
+  replaced_frees++;
+  free(ptr);
+}
+
+// cjson_set_allocator between creating and freeing a model must not matter.
+static void check_model_free(void)
+{
+  t_json_model *place = cjson_create_model("Place", sizeof(Place), place_fields, place_json_fields);
+  CHECK(place != NULL && cjson_compile_model(place) == 0);
+
+  cjson_set_allocator(replaced_alloc, replaced_realloc, replaced_free, NULL);
+  cjson_model_free(place);
+  cjson_set_allocator(NULL, NULL, NULL, NULL);
+  CHECK(replaced_frees == 0);
+
+  cjson_model_free(NULL);
+}
+
+int main(void)
+{
+  t_json_model *interpreted = sample_model(false);
+  t_json_model *compiled = sample_model(true);
+  CHECK(interpreted && compiled);
+  if (!interpreted || !compiled)
+    return test_report("test_compile");
+
+  Sample a = {0}, b = {0};
+  CHECK(cjson_decode(sample_json, interpreted, &a) == 0);
+  CHECK(cjson_decode(sample_json, compiled, &b) == 0);
+  check_values(&a);
+  check_values(&b);
+
+  for (int pretty = 0; pretty <= 1; pretty++)
+  {
+    char *from_interpreted = cjson_encode(&a, interpreted, pretty);
+    char *from_compiled = cjson_encode(&b, compiled, pretty);
+    CHECK(from_interpreted && from_compiled && strcmp(from_interpreted, from_compiled) == 0);
+
+    // The output decodes back to the same document.
+    Sample again = {0};
+    CHECK(cjson_decode(from_compiled, compiled, &again) == 0);
+    char *reencoded = cjson_encode(&again, interpreted, pretty);
+    CHECK(reencoded && from_interpreted && strcmp(reencoded, from_interpreted) == 0);
+    cjson_free(reencoded);
+    cjson_free_instance(&again, compiled);
+
+    cjson_free(from_interpreted);
+    cjson_free(from_compiled);
+  }
+
+  cjson_free_instance(&a, interpreted);
+  cjson_free_instance(&b, compiled);
+  check_model_free();
+  return test_report("test_compile");
+}
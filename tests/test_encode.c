@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/cjson.h"
+#include "test.h"
+#include "test_models.h"
+
+// Every encoder entry point must write the same bytes as cjson_encode, with
+// interpreted and compiled models alike, and strings are escaped byte-exactly.
+
+typedef struct
+{
+  char *data;
+  t_size length;
+} t_sink_buffer;
+
+static int sink_append(void *ctx, const char *data, t_size length)
+{
+  t_sink_buffer *sink = (t_sink_buffer *)ctx;
+  char *grown = realloc(sink->data, sink->length + length + 1);
+  if (!grown)
+    return -1;
+  memcpy(grown + sink->length, data, length);
+  sink->data = grown;
+  sink->length += length;
+  sink->data[sink->length] = '\0';
+  return 0;
+}
+
+static void check_writers(const Sample *s, t_json_model *model, bool pretty, const char *expected)
+{
+  t_size length = 0;
+  char small[8];
+  CHECK(cjson_encode_to(small, sizeof(small), (void *)s, model, pretty, &length) == -1);
+  CHECK(length == strlen(expected));
+
+  char *buffer = malloc(length + 1);
+  CHECK(cjson_encode_to(buffer, length + 1, (void *)s, model, pretty, &length) == 0);
+  CHECK(strcmp(buffer, expected) == 0);
+  free(buffer);
+
+  t_sink_buffer sink = {NULL, 0};
+  CHECK(cjson_encode_to_sink(sink_append, &sink, (void *)s, model, pretty) == 0);
+  CHECK(sink.data && strcmp(sink.data, expected) == 0);
+  free(sink.data);
+}
+
+// Byte-at-a-time reference for the run-based escaper.
+static void reference_escape(const char *str, char *out)
+{
+  static const char specials[] = "\"\\\b\f\n\r\t";
+  static const char letters[] = "\"\\bfnrt";
+
+  for (const unsigned char *p = (const unsigned char *)str; *p; p++)
+  {
+    const char *special = *p ? strchr(specials, *p) : NULL;
+    if (special)
+      out += sprintf(out, "\\%c", letters[special - specials]);
+    else if (*p < 0x20)
+      out += sprintf(out, "\\u%04x", *p);
+    else
+      *out++ = (char)*p;
+  }
+  *out = '\0';
+}
+
+// Random strings mixing long plain runs with specials at every offset, each in
+// an exactly sized heap block so a scan past the terminator would be caught by
+// a sanitizer build.
+static void check_escapes(void)
+{
+  static const char alphabet[] = "abcdefgh\"\\\n\t\r\b\f\x01\x1f\x7f\xc3\xa9 /";
+  t_json_model *place = cjson_create_model("Place", sizeof(Place), place_fields, place_json_fields);
+  CHECK(place != NULL);
+  if (!place)
+    return;
+
+  srand(7);
+  for (int round = 0; round < 2000; round++)
+  {
+    t_size length = (t_size)(rand() % 200);
+    char *city = malloc(length + 1);
+    for (t_size i = 0; i < length; i++)
+      city[i] = rand() % 4 ? 'a' + rand() % 26 : alphabet[rand() % (sizeof(alphabet) - 1)];
+    city[length] = '\0';
+
+    char *escaped = malloc(length * 6 + 1);
+    reference_escape(city, escaped);
+    char *expected = malloc(length * 6 + 32);
+    sprintf(expected, "{\"city\":\"%s\",\"zip\":%d}", escaped, round);
+
+    Place value = {city, round};
+    char *json = cjson_encode(&value, place, false);
+    if (!json || strcmp(json, expected) != 0)
+    {
+      CHECK(json && strcmp(json, expected) == 0);
+      round = 2000;
+    }
+
+    cjson_free(json);
+    free(expected);
+    free(escaped);
+    free(city);
+  }
+  cjson_model_free(place);
+}
+
+// One very large document must not leave every later encode of the model
+// starting from a buffer that size.
+static void check_size_hint_capped(Sample *s, t_json_model *model)
+{
+  t_size length = 256 * 1024;
+  char *big = (char *)malloc(length + 1);
+  CHECK(big != NULL);
+  if (!big)
+    return;
+  memset(big, 'x', length);
+  big[length] = '\0';
+
+  char *name = s->name;
+  s->name = big;
+  char *json = cjson_encode(s, model, false);
+  CHECK(json && strlen(json) > length);
+  CHECK(model->encode_size_hint <= 64 * 1024);
+  s->name = name;
+
+  cjson_free(json);
+  free(big);
+}
+
+int main(void)
+{
+  t_json_model *interpreted = sample_model(false);
+  t_json_model *compiled = sample_model(true);
+  CHECK(interpreted && compiled);
+  if (!interpreted || !compiled)
+    return test_report("test_encode");
+
+  Sample a = {0}, b = {0};
+  CHECK(cjson_decode(sample_json, interpreted, &a) == 0);
+  CHECK(cjson_decode(sample_json, compiled, &b) == 0);
+
+  for (int pretty = 0; pretty <= 1; pretty++)
+  {
+    char *expected = cjson_encode(&a, interpreted, pretty);
+    CHECK(expected != NULL);
+    if (!expected)
+      continue;
+    check_writers(&a, interpreted, pretty, expected);
+    check_writers(&b, compiled, pretty, expected);
+    cjson_free(expected);
+  }
+
+  check_size_hint_capped(&a, interpreted);
+  check_size_hint_capped(&b, compiled);
+  check_escapes();
+
+  cjson_free_instance(&a, interpreted);
+  cjson_free_instance(&b, compiled);
+  return test_report("test_encode");
+}
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/cjson.h"
+#include "test.h"
+#include "test_models.h"
+
+// cjson_decode_file on a large pretty-printed document: the structural index
+// kicks in, every string outlives the mapping, and the file is left untouched.
+
+#define TAG_COUNT 5000
+
+// A name longer than one index window, so its closing quote lies in a window
+// not classified yet when the string is read.
+#define NAME_LENGTH 5000
+
+// One tag per indented line, as other pretty printers write arrays.
+static int write_pretty_document(const char *path, const char *name, const char *expected_tags[], int count)
+{
+  FILE *out = fopen(path, "w");
+  if (!out)
+    return -1;
+
+  fprintf(out, "{\n    \"id\": 7,\n    \"tags\": [\n");
+  for (int i = 0; i < count; i++)
+    fprintf(out, "        \"%s\"%s\n", expected_tags[i], i + 1 < count ? "," : "");
+  fprintf(out, "    ],\n    \"full_name\": \"%s\",\n    \"unknown\": {\n        \"nested\": [ 1, 2, { \"deep\": \"value\" } ]\n    },\n    \"work\": {\n        \"city\": \"Recife\",\n        \"zip\": 50000\n    }\n}\n", name);
+  return fclose(out) == 0 ? 0 : -1;
+}
+
+static char *read_whole_file(const char *path, long *length)
+{
+  FILE *in = fopen(path, "rb");
+  if (!in)
+    return NULL;
+  fseek(in, 0, SEEK_END);
+  *length = ftell(in);
+  rewind(in);
+  char *data = malloc((t_size)*length);
+  if (data && fread(data, 1, (t_size)*length, in) != (t_size)*length)
+  {
+    free(data);
+    data = NULL;
+  }
+  fclose(in);
+  return data;
+}
+
+static void test_large_pretty_file(t_json_model *model)
+{
+  char path[] = "/tmp/cjson_test_XXXXXX";
+  int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  if (fd < 0)
+    return;
+  close(fd);
+
+  // Some tags carry escapes, so they are copied instead of borrowed.
+  static char storage[TAG_COUNT][48];
+  static const char *tags[TAG_COUNT];
+  for (int i = 0; i < TAG_COUNT; i++)
+  {
+    snprintf(storage[i], sizeof(storage[i]), i % 7 ? "tag number %d of the list" : "tag \\\"%d\\\"", i);
+    tags[i] = storage[i];
+  }
+  static char name[NAME_LENGTH + 1];
+  memset(name, 'n', NAME_LENGTH);
+  CHECK(write_pretty_document(path, name, tags, TAG_COUNT) == 0);
+
+  long before_length = 0;
+  char *before = read_whole_file(path, &before_length);
+  CHECK(before != NULL);
+
+  Sample decoded = {0};
+  t_json_file *file = cjson_decode_file(path, model, &decoded);
+  CHECK(file != NULL);
+  if (file)
+  {
+    CHECK(decoded.id == 7 && decoded.work.zip == 50000 && strcmp(decoded.work.city, "Recife") == 0);
+    CHECK(decoded.name && strcmp(decoded.name, name) == 0);
+    CHECK(decoded.tags && decoded.tags->count == TAG_COUNT);
+    for (int i = 0; decoded.tags && i < (int)decoded.tags->count && i < TAG_COUNT; i++)
+    {
+      const char *tag = ((char **)decoded.tags->data)[i];
+      char expected[48];
+      snprintf(expected, sizeof(expected), i % 7 ? "tag number %d of the list" : "tag \"%d\"", i);
+      if (!tag || strcmp(tag, expected) != 0)
+      {
+        CHECK(tag && strcmp(tag, expected) == 0);
+        break;
+      }
+    }
+    cjson_file_close(file);
+  }
+
+  long after_length = 0;
+  char *after = read_whole_file(path, &after_length);
+  CHECK(before && after && before_length == after_length && memcmp(before, after, (t_size)before_length) == 0);
+  free(before);
+  free(after);
+  unlink(path);
+}
+
+int main(void)
+{
+  t_json_model *interpreted = sample_model(false);
+  t_json_model *compiled = sample_model(true);
+  CHECK(interpreted && compiled);
+  if (!interpreted || !compiled)
+    return test_report("test_file");
+
+  test_large_pretty_file(interpreted);
+  test_large_pretty_file(compiled);
+  return test_report("test_file");
+}
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/cjson.h"
+#include "test.h"
+#include "test_models.h"
+
+// Lazy decoding must leave every field alone until it is asked for, decode it
+// once, and end up with the same instance as cjson_decode once all were read.
+
+static void test_on_demand(t_json_model *model, const char *expected)
+{
+  Sample s = {0}, untouched = {0};
+  t_json_lazy *lazy = cjson_decode_lazy(sample_json, strlen(sample_json), model, &s);
+  CHECK(lazy != NULL);
+  if (!lazy)
+    return;
+  CHECK(memcmp(&s, &untouched, sizeof(s)) == 0);
+
+  // Only the field asked for is decoded.
+  char **name = cjson_get_field(lazy, "full_name");
+  CHECK(name == &s.name && s.name && strcmp(s.name, "Ana \"A\" Souza\n\xc3\xa9\xf0\x9f\x98\x80") == 0);
+  CHECK(s.id == 0 && s.tags == NULL && s.home == NULL);
+
+  // A second access returns the value already decoded.
+  char *first = s.name;
+  CHECK(cjson_get_field(lazy, "full_name") == &s.name && s.name == first);
+
+  CHECK(cjson_get_field(lazy, "unknown") == NULL);
+  CHECK(cjson_get_field(lazy, "missing") == NULL);
+  CHECK(cjson_get_field(lazy, "secret") == NULL && s.secret == NULL);
+
+  for (int i = 0; sample_json_fields[i].field_name; i++)
+  {
+    const char *key = sample_json_fields[i].json_field_name ? sample_json_fields[i].json_field_name : sample_json_fields[i].field_name;
+    if (!sample_json_fields[i].ignore)
+      CHECK(cjson_get_field(lazy, key) != NULL);
+  }
+  cjson_lazy_free(lazy);
+
+  char *json = cjson_encode(&s, model, false);
+  CHECK(json && strcmp(json, expected) == 0);
+  cjson_free(json);
+  cjson_free_instance(&s, model);
+}
+
+static void test_partial_documents(t_json_model *model)
+{
+  // Absent keys stay zeroed, a repeated key keeps its last value, and a bad
+  // value only fails the field it belongs to.
+  const char json[] = "{\"id\": 1, \"full_name\": \"bad \\q\", \"id\": 7, \"ints\": [1, 2]}";
+  Sample s = {0};
+  t_json_lazy *lazy = cjson_decode_lazy(json, sizeof(json) - 1, model, &s);
+  CHECK(lazy != NULL);
+  if (lazy)
+  {
+    int *id = cjson_get_field(lazy, "id");
+    CHECK(id && *id == 7);
+    CHECK(cjson_get_field(lazy, "full_name") == NULL && s.name == NULL);
+    CHECK(cjson_get_field(lazy, "full_name") == NULL);
+    CHECK(cjson_get_field(lazy, "tags") == NULL && s.tags == NULL);
+    Array **ints = cjson_get_field(lazy, "ints");
+    CHECK(ints && *ints && (*ints)->count == 2 && ((int *)(*ints)->data)[1] == 2);
+    cjson_lazy_free(lazy);
+  }
+  cjson_free_instance(&s, model);
+
+  // The walk itself still rejects a document that does not end.
+  const char unterminated[] = "{\"id\": 1, \"full_name\": \"x";
+  CHECK(cjson_decode_lazy(unterminated, sizeof(unterminated) - 1, model, &s) == NULL);
+  CHECK(cjson_decode_lazy(NULL, 0, model, &s) == NULL);
+}
+
+int main(void)
+{
+  t_json_model *interpreted = sample_model(false);
+  t_json_model *compiled = sample_model(true);
+  CHECK(interpreted && compiled);
+  if (!interpreted || !compiled)
+    return test_report("test_lazy");
+
+  Sample s = {0};
+  CHECK(cjson_decode(sample_json, interpreted, &s) == 0);
+  char *expected = cjson_encode(&s, interpreted, false);
+  cjson_free_instance(&s, interpreted);
+
+  test_on_demand(interpreted, expected);
+  test_on_demand(compiled, expected);
+  test_partial_documents(interpreted);
+  test_partial_documents(compiled);
+
+  cjson_free(expected);
+  return test_report("test_lazy");
+}
@@ -0,0 +1,143 @@
+#ifndef TEST_MODELS_H
+#define TEST_MODELS_H
+#include <stdint.h>
+#include "../include/cjson.h"
+#include "../include/dynamic_array.h"
+
+// One model touching every field kind, shared by the tests that compare two
+// decoding or encoding paths with each other.
+
+typedef struct
+{
+  char *name;
+  int age;
+} Pet;
+
+typedef struct
+{
+  char *city;
+  int zip;
+} Place;
+
+typedef struct
+{
+  int id;
+  double score;
+  char *name;
+  bool active;
+  Place *home;
+  Place work;
+  Array *ints;
+  Array *doubles;
+  Array *tags;
+  Array *pets;   // Pet *
+  Array *visits; // Place, contiguous
+  int64_t timestamp;
+  uint32_t flags;
+  float ratio;
+  char code[8];
+  int16_t grid[3];
+  char *secret;
+} Sample;
+
+static t_reflect_field pet_fields[] = {
+    {"name", REFLECT_TYPE_STRING, REFLECT_OFFSET(Pet, name), NULL},
+    {"age", REFLECT_TYPE_INTEGER, REFLECT_OFFSET(Pet, age), NULL},
+    NO_MORE_FIELDS};
+
+static t_json_field_config pet_json_fields[] = {
+    {"name", NULL, false},
+    {"age", "pet_age", false},
+    NO_MORE_FIELDS};
+
+static t_reflect_field place_fields[] = {
+    {"city", REFLECT_TYPE_STRING, REFLECT_OFFSET(Place, city), NULL},
+    {"zip", REFLECT_TYPE_INTEGER, REFLECT_OFFSET(Place, zip), NULL},
+    NO_MORE_FIELDS};
+
+static t_json_field_config place_json_fields[] = {
+    {"city", NULL, false},
+    {"zip", NULL, false},
+    NO_MORE_FIELDS};
+
+static t_reflect_field sample_fields[] = {
+    {"id", REFLECT_TYPE_INTEGER, REFLECT_OFFSET(Sample, id), NULL},
+    {"score", REFLECT_TYPE_DOUBLE, REFLECT_OFFSET(Sample, score), NULL},
+    {"name", REFLECT_TYPE_STRING, REFLECT_OFFSET(Sample, name), NULL},
+    {"active", REFLECT_TYPE_BOOL, REFLECT_OFFSET(Sample, active), NULL},
+    {"home", REFLECT_TYPE_OBJECT, REFLECT_OFFSET(Sample, home), NULL},
+    {"work", CJSON_FIELD_TYPE(CJSON_TYPE_STRUCT), REFLECT_OFFSET(Sample, work), NULL},
+    {"ints", REFLECT_TYPE_ARRAY_INT, REFLECT_OFFSET(Sample, ints), NULL},
+    {"doubles", REFLECT_TYPE_ARRAY_DOUBLE, REFLECT_OFFSET(Sample, doubles), NULL},
+    {"tags", REFLECT_TYPE_ARRAY_STRING, REFLECT_OFFSET(Sample, tags), NULL},
+    {"pets", REFLECT_TYPE_ARRAY_OBJECT, REFLECT_OFFSET(Sample, pets), NULL},
+    {"visits", CJSON_FIELD_TYPE(CJSON_TYPE_ARRAY_STRUCT), REFLECT_OFFSET(Sample, visits), NULL},
+    {"timestamp", CJSON_FIELD_TYPE(CJSON_TYPE_INT64), REFLECT_OFFSET(Sample, timestamp), NULL},
+    {"flags", CJSON_FIELD_TYPE(CJSON_TYPE_UINT32), REFLECT_OFFSET(Sample, flags), NULL},
+    {"ratio", CJSON_FIELD_TYPE(CJSON_TYPE_FLOAT), REFLECT_OFFSET(Sample, ratio), NULL},
+    {"code", CJSON_FIELD_CHARS(8), REFLECT_OFFSET(Sample, code), NULL},
+    {"grid", CJSON_FIELD_ARRAY_OF(CJSON_TYPE_INT16, 3), REFLECT_OFFSET(Sample, grid), NULL},
+    {"secret", REFLECT_TYPE_STRING, REFLECT_OFFSET(Sample, secret), NULL},
+    NO_MORE_FIELDS};
+
+static t_json_field_config sample_json_fields[] = {
+    {"id", NULL, false},
+    {"score", NULL, false},
+    {"name", "full_name", false},
+    {"active", NULL, false},
+    {"home", NULL, false},
+    {"work", NULL, false},
+    {"ints", NULL, false},
+    {"doubles", NULL, false},
+    {"tags", NULL, false},
+    {"pets", NULL, false},
+    {"visits", NULL, false},
+    {"timestamp", NULL, false},
+    {"flags", NULL, false},
+    {"ratio", NULL, false},
+    {"code", NULL, false},
+    {"grid", NULL, false},
+    {"secret", NULL, true},
+    NO_MORE_FIELDS};
+
+static const char sample_json[] =
+    "{\n"
+    "  \"id\": 42,\n"
+    "  \"score\": -1.25e-3,\n"
+    "  \"full_name\": \"Ana \\\"A\\\" Souza\\n\\u00e9\\ud83d\\ude00\",\n"
+    "  \"active\": true,\n"
+    "  \"unknown\": {\"deep\": [1, {\"x\": \"]}\"}, [2, 3]]},\n"
+    "  \"home\": {\"city\": \"Rio\", \"zip\": 20000},\n"
+    "  \"work\": {\"zip\": 30000, \"city\": \"S\\u00e3o Paulo\"},\n"
+    "  \"ints\": [1, -2, 2147483647, -2147483648],\n"
+    "  \"doubles\": [0.1, 1e300, -0.0, 5e-324],\n"
+    "  \"tags\": [\"a\", \"\", \"tab\\there\"],\n"
+    "  \"pets\": [{\"name\": \"Rex\", \"pet_age\": 3}, {\"name\": \"Mia\", \"pet_age\": 1}],\n"
+    "  \"visits\": [{\"city\": \"Lima\", \"zip\": 1}, {\"city\": \"Quito\", \"zip\": 2}, {\"city\": \"Bogota\", \"zip\": 3}],\n"
+    "  \"timestamp\": -1700000000000,\n"
+    "  \"flags\": 4294967295,\n"
+    "  \"ratio\": 0.3,\n"
+    "  \"code\": \"AB\\/CD\",\n"
+    "  \"grid\": [-32768, 0, 32767],\n"
+    "  \"secret\": \"never decoded\"\n"
+    "}";
+
+// Builds the Sample model and its children; compiled selects cjson_compile_model.
+static t_json_model *sample_model(bool compiled)
+{
+  t_json_model *pet = cjson_create_model("Pet", sizeof(Pet), pet_fields, pet_json_fields);
+  t_json_model *place = cjson_create_model("Place", sizeof(Place), place_fields, place_json_fields);
+  t_json_model *sample = cjson_create_model("Sample", sizeof(Sample), sample_fields, sample_json_fields);
+  if (!pet || !place || !sample)
+    return NULL;
+
+  cjson_register_child(sample, "home", place);
+  cjson_register_child(sample, "work", place);
+  cjson_register_child(sample, "pets", pet);
+  cjson_register_child(sample, "visits", place);
+  if (compiled && cjson_compile_model(sample) != 0)
+    return NULL;
+  return sample;
+}
+
+#endif
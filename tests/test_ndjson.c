@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../include/cjson.h"
+#include "test.h"
+#include "test_models.h"
+
+// NDJSON records must decode like the same object passed to cjson_decode, from
+// memory and from a pipe that delivers the input in uneven pieces.
+
+#define RECORDS 300
+
+typedef struct
+{
+  t_json_model *model;
+  const char *expected; // encoding of the sample with its id back at 42, or NULL
+  t_size seen;
+  t_size stop_at;
+  int mismatches;
+} t_record_check;
+
+static int check_record(void *ctx, void *instance, t_size index)
+{
+  t_record_check *check = (t_record_check *)ctx;
+  Sample *s = (Sample *)instance;
+
+  if (index != check->seen || s->id != (int)index)
+    check->mismatches++;
+  if (check->expected)
+  {
+    s->id = 42;
+    char *json = cjson_encode(s, check->model, false);
+    if (!json || strcmp(json, check->expected) != 0)
+      check->mismatches++;
+    cjson_free(json);
+  }
+
+  check->seen++;
+  return check->seen == check->stop_at;
+}
+
+// RECORDS copies of the sample on one line each, the last "id" key numbering
+// them, with blank and CRLF lines in between and no newline after the last one.
+static char *build_ndjson(t_size *out_length)
+{
+  t_size record_length = strlen(sample_json);
+  char *line = malloc(record_length + 1);
+  for (t_size i = 0; i < record_length; i++)
+    line[i] = sample_json[i] == '\n' ? ' ' : sample_json[i];
+  line[record_length - 1] = '\0'; // drop the closing brace
+
+  char *buffer = malloc(RECORDS * (record_length + 32));
+  char *p = buffer;
+  for (int i = 0; i < RECORDS; i++)
+  {
+    p += sprintf(p, "%s, \"id\": %d}", line, i);
+    if (i == RECORDS - 1)
+      break;
+    if (i % 7 == 0)
+      p += sprintf(p, "\n   \n");
+    else
+      p += sprintf(p, i % 5 == 0 ? "\r\n" : "\n");
+  }
+  free(line);
+  *out_length = (t_size)(p - buffer);
+  return buffer;
+}
+
+static void test_buffer(t_json_model *model, const char *expected, const char *ndjson, t_size length)
+{
+  t_record_check check = {model, expected, 0, 0, 0};
+  CHECK(cjson_decode_ndjson(ndjson, length, model, check_record, &check) == 0);
+  CHECK(check.seen == RECORDS && check.mismatches == 0);
+
+  // A non-zero return stops the walk right there.
+  t_record_check stopped = {model, expected, 0, 3, 0};
+  CHECK(cjson_decode_ndjson(ndjson, length, model, check_record, &stopped) == -1);
+  CHECK(stopped.seen == 3 && stopped.mismatches == 0);
+
+  // A malformed record fails after the good ones before it.
+  const char broken[] = "{\"id\": 0}\n{\"id\": 1}\n{\"full_name\": \"x}\n{\"id\": 3}\n";
+  t_record_check partial = {model, NULL, 0, 0, 0};
+  CHECK(cjson_decode_ndjson(broken, sizeof(broken) - 1, model, check_record, &partial) == -1);
+  CHECK(partial.seen == 2 && partial.mismatches == 0);
+}
+
+static void test_pipe(t_json_model *model, const char *expected, const char *ndjson, t_size length)
+{
+  int fds[2];
+  CHECK(pipe(fds) == 0);
+  pid_t writer = fork();
+  if (writer == 0)
+  {
+    close(fds[0]);
+    for (t_size offset = 0; offset < length;)
+    {
+      t_size piece = length - offset < 997 ? length - offset : 997;
+      ssize_t written = write(fds[1], ndjson + offset, piece);
+      if (written <= 0)
+        _exit(1);
+      offset += (t_size)written;
+    }
+    _exit(0);
+  }
+  close(fds[1]);
+
+  t_record_check check = {model, expected, 0, 0, 0};
+  CHECK(cjson_decode_ndjson_fd(fds[0], model, check_record, &check) == 0);
+  CHECK(check.seen == RECORDS && check.mismatches == 0);
+  close(fds[0]);
+
+  int status = 0;
+  waitpid(writer, &status, 0);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main(void)
+{
+  t_json_model *interpreted = sample_model(false);
+  t_json_model *compiled = sample_model(true);
+  CHECK(interpreted && compiled);
+  if (!interpreted || !compiled)
+    return test_report("test_ndjson");
+
+  Sample s = {0};
+  CHECK(cjson_decode(sample_json, interpreted, &s) == 0);
+  char *expected = cjson_encode(&s, interpreted, false);
+  cjson_free_instance(&s, interpreted);
+
+  t_size length = 0;
+  char *ndjson = build_ndjson(&length);
+
+  test_buffer(interpreted, expected, ndjson, length);
+  test_buffer(compiled, expected, ndjson, length);
+  test_pipe(interpreted, expected, ndjson, length);
+  test_pipe(compiled, expected, ndjson, length);
+
+  free(ndjson);
+  cjson_free(expected);
+  return test_report("test_ndjson");
+}
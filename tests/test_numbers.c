@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <float.h>
+#include "../include/number_utils.h"
+#include "../include/number_format.h"
+#include "test.h"
+
+// Number scanning and formatting against the C library: json_number_to_double
+// must match strtod bit for bit, and format_double / format_float must read
+// back to the value they were given.
+
+#define RANDOM_INPUTS 200000
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t next_random(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static int scan_text(const char *text, t_json_number *number)
+{
+  const char *cursor = text;
+  const char *end = text + strlen(text);
+  if (scan_json_number(&cursor, end, number) != 0 || cursor != end)
+    return -1;
+  return 0;
+}
+
+// A JSON number with 1-25 significant digits and an exponent in [-350, 350].
+static void random_number_text(char *out)
+{
+  char *p = out;
+  if (next_random() & 1)
+    *p++ = '-';
+
+  int digits = 1 + (int)(next_random() % 25);
+  int point = (int)(next_random() % (digits + 1));
+  *p++ = (char)('1' + next_random() % 9);
+  for (int i = 1; i < digits; i++)
+  {
+    if (i == point)
+      *p++ = '.';
+    *p++ = (char)('0' + next_random() % 10);
+  }
+  if (next_random() & 1)
+    p += sprintf(p, "e%d", (int)(next_random() % 701) - 350);
+  *p = '\0';
+}
+
+static void test_parse_against_strtod(void)
+{
+  char text[64];
+  int mismatches = 0;
+
+  for (int i = 0; i < RANDOM_INPUTS; i++)
+  {
+    random_number_text(text);
+    t_json_number number;
+    if (scan_text(text, &number) != 0)
+    {
+      fprintf(stderr, "not scanned: %s\n", text);
+      mismatches++;
+      continue;
+    }
+
+    double got = json_number_to_double(&number);
+    double expected = strtod(text, NULL);
+    if (memcmp(&got, &expected, sizeof(double)) != 0 && mismatches++ < 5)
+      fprintf(stderr, "%s: got %.17g, strtod %.17g\n", text, got, expected);
+  }
+  CHECK(mismatches == 0);
+
+  // Halfway cases and digits past the 19 kept in the mantissa.
+  static const char *hard[] = {"9007199254740993", "2.2250738585072011e-308", "4.9406564584124654e-324",
+                               "1.7976931348623157e308", "0.1000000000000000055511151231257827021181583404541015625",
+                               "123456789012345678901234567890", "7.0420557077594588669468784357561207962098443483187940792729600000e59",
+                               "1e-400", "-0", "0.0"};
+  for (size_t i = 0; i < sizeof(hard) / sizeof(hard[0]); i++)
+  {
+    t_json_number number;
+    CHECK(scan_text(hard[i], &number) == 0);
+    double got = json_number_to_double(&number);
+    double expected = strtod(hard[i], NULL);
+    CHECK(memcmp(&got, &expected, sizeof(double)) == 0);
+  }
+}
+
+// Exact midpoints between neighbouring doubles, written out in full, and the
+// same digits nudged just above or cut just below: these only resolve in the
+// big-decimal slow path.
+static void test_halfway_against_strtod(void)
+{
+#if LDBL_MANT_DIG >= 64
+  static char text[1200];
+  int mismatches = 0;
+
+  for (int i = 0; i < 2000; i++)
+  {
+    uint64_t bits = next_random() & 0x7FEFFFFFFFFFFFFFULL;
+    if (i % 4 == 0)
+      bits &= 0x000FFFFFFFFFFFFFULL; // subnormal
+    uint64_t next_bits = bits + 1;
+    double low, high;
+    memcpy(&low, &bits, sizeof(low));
+    memcpy(&high, &next_bits, sizeof(high));
+    long double middle = ((long double)low + (long double)high) / 2;
+
+    int length = snprintf(text, sizeof(text) - 1, "%.1100Le", middle);
+    char *exponent = strchr(text, 'e');
+    for (int variant = 0; variant < 3; variant++)
+    {
+      char input[1200];
+      if (variant == 0)
+        memcpy(input, text, (size_t)length + 1);
+      else if (variant == 1) // one past the midpoint
+        sprintf(input, "%.*s1%s", (int)(exponent - text), text, exponent);
+      else // the first 40 digits, just below it
+        sprintf(input, "%.41s%s", text, exponent);
+
+      t_json_number number;
+      if (scan_text(input, &number) != 0)
+      {
+        mismatches++;
+        continue;
+      }
+      double got = json_number_to_double(&number);
+      double expected = strtod(input, NULL);
+      if (memcmp(&got, &expected, sizeof(double)) != 0 && mismatches++ < 5)
+        fprintf(stderr, "%.60s...: got %.17g, strtod %.17g\n", input, got, expected);
+    }
+  }
+  CHECK(mismatches == 0);
+#endif
+}
+
+static void test_malformed(void)
+{
+  static const char *bad[] = {"", "-", "1.", ".5", "1e", "1e+", "+1", "--1", "0x10"};
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+  {
+    t_json_number number;
+    CHECK(scan_text(bad[i], &number) != 0);
+  }
+}
+
+static void test_format_double(void)
+{
+  char buffer[NUMBER_FORMAT_DOUBLE_MAX + 1];
+  int failures = 0;
+
+  for (int i = 0; i < RANDOM_INPUTS; i++)
+  {
+    uint64_t bits = next_random();
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    if (value != value || value - value != 0) // NaN or infinite
+      continue;
+
+    int length = format_double(buffer, value);
+    buffer[length] = '\0';
+
+    t_json_number number;
+    double back = strtod(buffer, NULL);
+    if ((scan_text(buffer, &number) != 0 || memcmp(&back, &value, sizeof(double)) != 0) && failures++ < 5)
+      fprintf(stderr, "format_double(%.17g) wrote %s\n", value, buffer);
+  }
+  CHECK(failures == 0);
+
+  int length = format_double(buffer, 1.0 / 0.0);
+  CHECK(length == 4 && memcmp(buffer, "null", 4) == 0);
+}
+
+static void test_format_float(void)
+{
+  char buffer[NUMBER_FORMAT_DOUBLE_MAX + 1];
+  int failures = 0;
+
+  for (int i = 0; i < RANDOM_INPUTS; i++)
+  {
+    uint32_t bits = (uint32_t)next_random();
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    if (value != value || value - value != 0)
+      continue;
+
+    int length = format_float(buffer, value);
+    buffer[length] = '\0';
+
+    t_json_number number;
+    float back = strtof(buffer, NULL);
+    if ((scan_text(buffer, &number) != 0 || memcmp(&back, &value, sizeof(float)) != 0) && failures++ < 5)
+      fprintf(stderr, "format_float(%.9g) wrote %s\n", value, buffer);
+  }
+  CHECK(failures == 0);
+
+  int length = format_float(buffer, 0.1f);
+  CHECK(length == 3 && memcmp(buffer, "0.1", 3) == 0);
+}
+
+static void test_format_integers(void)
+{
+  static const long long signed_values[] = {0, 7, -7, 10, 99, 100, INT_MAX, INT_MIN, LLONG_MAX, LLONG_MIN};
+  char buffer[NUMBER_FORMAT_INT_MAX + 1];
+  char expected[32];
+
+  for (size_t i = 0; i < sizeof(signed_values) / sizeof(signed_values[0]); i++)
+  {
+    buffer[format_int64(buffer, signed_values[i])] = '\0';
+    snprintf(expected, sizeof(expected), "%lld", signed_values[i]);
+    CHECK(strcmp(buffer, expected) == 0);
+  }
+
+  buffer[format_uint64(buffer, ULLONG_MAX)] = '\0';
+  CHECK(strcmp(buffer, "18446744073709551615") == 0);
+}
+
+static void test_integer_ranges(void)
+{
+  t_json_number number;
+  long long value;
+  unsigned long long unsigned_value;
+  int int_value;
+
+  CHECK(scan_text("2147483647", &number) == 0 && json_number_to_int(&number, &int_value) == 0 && int_value == INT_MAX);
+  CHECK(scan_text("2147483648", &number) == 0 && json_number_to_int(&number, &int_value) != 0);
+  CHECK(scan_text("-2.9", &number) == 0 && json_number_to_int(&number, &int_value) == 0 && int_value == -2);
+
+  CHECK(scan_text("-128", &number) == 0 && json_number_to_int_range(&number, -128, 127, &value) == 0 && value == -128);
+  CHECK(scan_text("-129", &number) == 0 && json_number_to_int_range(&number, -128, 127, &value) != 0);
+  CHECK(scan_text("127.9", &number) == 0 && json_number_to_int_range(&number, -128, 127, &value) == 0 && value == 127);
+  CHECK(scan_text("9223372036854775807", &number) == 0 && json_number_to_int_range(&number, LLONG_MIN, LLONG_MAX, &value) == 0);
+  CHECK(scan_text("9223372036854775808", &number) == 0 && json_number_to_int_range(&number, LLONG_MIN, LLONG_MAX, &value) != 0);
+
+  CHECK(scan_text("18446744073709551615", &number) == 0 &&
+        json_number_to_uint_range(&number, ULLONG_MAX, &unsigned_value) == 0 && unsigned_value == ULLONG_MAX);
+  CHECK(scan_text("18446744073709551616", &number) == 0 && json_number_to_uint_range(&number, ULLONG_MAX, &unsigned_value) != 0);
+  CHECK(scan_text("-1", &number) == 0 && json_number_to_uint_range(&number, 255, &unsigned_value) != 0);
+  CHECK(scan_text("-0", &number) == 0 && json_number_to_uint_range(&number, 255, &unsigned_value) == 0 && unsigned_value == 0);
+  CHECK(scan_text("255.5", &number) == 0 && json_number_to_uint_range(&number, 255, &unsigned_value) == 0 && unsigned_value == 255);
+  CHECK(scan_text("256", &number) == 0 && json_number_to_uint_range(&number, 255, &unsigned_value) != 0);
+}
+
+int main(void)
+{
+  test_parse_against_strtod();
+  test_halfway_against_strtod();
+  test_malformed();
+  test_format_double();
+  test_format_float();
+  test_format_integers();
+  test_integer_ranges();
+  return test_report("test_numbers");
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/cjson.h"
+#include "../include/arena.h"
+#include "../include/dynamic_array.h"
+#include "test.h"
+#include "test_models.h"
+
+// Parallel decoding must return every record in document order, decoded like
+// cjson_decode would, whatever the thread count; the instances live in the
+// caller's arena once the worker arenas were adopted.
+
+#define RECORDS 500
+
+// RECORDS copies of the sample numbered through a trailing "id" key, joined
+// either as a top-level array or as NDJSON lines.
+static char *build_records(bool ndjson, t_size *out_length)
+{
+  t_size record_length = strlen(sample_json);
+  char *line = malloc(record_length + 1);
+  for (t_size i = 0; i < record_length; i++)
+    line[i] = sample_json[i] == '\n' ? ' ' : sample_json[i];
+  line[record_length - 1] = '\0'; // drop the closing brace
+
+  char *buffer = malloc(RECORDS * (record_length + 32) + 8);
+  char *p = buffer;
+  if (!ndjson)
+    p += sprintf(p, "[\n");
+  for (int i = 0; i < RECORDS; i++)
+  {
+    p += sprintf(p, "%s, \"id\": %d}", line, i);
+    if (ndjson)
+      p += sprintf(p, i % 9 == 0 ? "\r\n\n" : "\n");
+    else if (i < RECORDS - 1)
+      p += sprintf(p, ",\n");
+  }
+  if (!ndjson)
+    p += sprintf(p, "\n]");
+  free(line);
+  *out_length = (t_size)(p - buffer);
+  return buffer;
+}
+
+static int check_result(Array *result, t_json_model *model, const char *expected)
+{
+  int mismatches = 0;
+  for (t_size i = 0; i < result->count; i++)
+  {
+    Sample *s = ((Sample **)result->data)[i];
+    if (!s || s->id != (int)i)
+    {
+      mismatches++;
+      continue;
+    }
+    s->id = 42;
+    char *json = cjson_encode(s, model, false);
+    if (!json || strcmp(json, expected) != 0)
+      mismatches++;
+    cjson_free(json);
+  }
+  return mismatches;
+}
+
+static void test_thread_counts(t_json_model *model, const char *expected, bool ndjson)
+{
+  t_size length = 0;
+  char *input = build_records(ndjson, &length);
+  static const int threads[] = {1, 2, 3, 8, 0};
+
+  for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++)
+  {
+    t_json_arena arena;
+    arena_init(&arena, NULL, 0, 64 * 1024);
+    Array *result = NULL;
+    int status = ndjson ? cjson_decode_ndjson_parallel(input, length, model, threads[t], &result, &arena)
+                        : cjson_decode_array_parallel(input, length, model, threads[t], &result, &arena);
+    CHECK(status == 0 && result && result->count == RECORDS);
+    if (status == 0 && result)
+      CHECK(check_result(result, model, expected) == 0);
+    arena_destroy(&arena);
+  }
+  free(input);
+}
+
+static void test_bad_input(t_json_model *model)
+{
+  t_json_arena arena;
+  arena_init(&arena, NULL, 0, 4096);
+  Array *result = NULL;
+
+  const char empty[] = " [ ] ";
+  CHECK(cjson_decode_array_parallel(empty, sizeof(empty) - 1, model, 4, &result, &arena) == 0);
+  CHECK(result && result->count == 0);
+
+  // A bad record anywhere fails the whole decode and leaves *out_array alone.
+  result = NULL;
+  const char bad_string[] = "[{\"id\": 1}, {\"full_name\": \"x\\q\"}, {\"id\": 3}]";
+  CHECK(cjson_decode_array_parallel(bad_string, sizeof(bad_string) - 1, model, 2, &result, &arena) == -1);
+  const char not_object[] = "[{\"id\": 1}, 2]";
+  CHECK(cjson_decode_array_parallel(not_object, sizeof(not_object) - 1, model, 2, &result, &arena) == -1);
+  const char two_per_line[] = "{\"id\": 1} {\"id\": 2}\n";
+  CHECK(cjson_decode_ndjson_parallel(two_per_line, sizeof(two_per_line) - 1, model, 2, &result, &arena) == -1);
+  CHECK(result == NULL);
+
+  arena_destroy(&arena);
+}
+
+int main(void)
+{
+  t_json_model *interpreted = sample_model(false);
+  t_json_model *compiled = sample_model(true);
+  CHECK(interpreted && compiled);
+  if (!interpreted || !compiled)
+    return test_report("test_parallel");
+
+  Sample s = {0};
+  CHECK(cjson_decode(sample_json, interpreted, &s) == 0);
+  char *expected = cjson_encode(&s, interpreted, false);
+  cjson_free_instance(&s, interpreted);
+
+  for (int ndjson = 0; ndjson <= 1; ndjson++)
+  {
+    test_thread_counts(interpreted, expected, ndjson);
+    test_thread_counts(compiled, expected, ndjson);
+  }
+  test_bad_input(interpreted);
+  test_bad_input(compiled);
+
+  cjson_free(expected);
+  return test_report("test_parallel");
+}
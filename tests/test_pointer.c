@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/cjson.h"
+#include "test.h"
+
+// JSON Pointer lookups must land on the exact raw text of the value, follow the
+// RFC 6901 escapes, and refuse paths that do not exist.
+
+static const char document[] =
+    "{\n"
+    "  \"id\": 42,\n"
+    "  \"active\": true,\n"
+    "  \"unknown\": {\"deep\": [1, {\"x\": \"]}\"}, [2, 3]]},\n"
+    "  \"home\": {\"city\": \"Rio\", \"zip\": 20000},\n"
+    "  \"ints\": [1, -2, 2147483647, -2147483648],\n"
+    "  \"doubles\": [0.1, 1e300, -0.0, 5e-324],\n"
+    "  \"tags\": [\"a\", \"\", \"tab\\there\"],\n"
+    "  \"pets\": [{\"name\": \"Rex\", \"pet_age\": 3}, {\"name\": \"Mia\", \"pet_age\": 1}],\n"
+    "  \"flags\": 4294967295\n"
+    "}";
+
+static bool extracts(const char *json, const char *pointer, const char *expected)
+{
+  t_json_slice slice;
+  if (cjson_extract(json, strlen(json), pointer, &slice) != 0)
+    return expected == NULL;
+  return expected && slice.length == strlen(expected) && memcmp(slice.ptr, expected, slice.length) == 0;
+}
+
+static void test_paths(void)
+{
+  CHECK(extracts(document, "/id", "42"));
+  CHECK(extracts(document, "/home", "{\"city\": \"Rio\", \"zip\": 20000}"));
+  CHECK(extracts(document, "/home/city", "\"Rio\""));
+  CHECK(extracts(document, "/pets/1/pet_age", "1"));
+  CHECK(extracts(document, "/unknown/deep/1/x", "\"]}\""));
+  CHECK(extracts(document, "/unknown/deep/2/1", "3"));
+  CHECK(extracts(document, "/doubles/3", "5e-324"));
+  CHECK(extracts(document, "", document));
+
+  // Absent members, indexes past the end, "-", leading zeros, indexing an object.
+  CHECK(extracts(document, "/nope", NULL));
+  CHECK(extracts(document, "/ints/4", NULL));
+  CHECK(extracts(document, "/ints/-", NULL));
+  CHECK(extracts(document, "/ints/01", NULL));
+  CHECK(extracts(document, "/home/0", NULL));
+  CHECK(extracts(document, "/id/x", NULL));
+  CHECK(extracts(document, "id", NULL));
+}
+
+static void test_escapes(void)
+{
+  const char json[] = "{\"a/b\": 1, \"m~n\": 2, \"\\u00e9t\\u00e9\": 3, \"q\\\"\": 4, \"\": 5}";
+  CHECK(extracts(json, "/a~1b", "1"));
+  CHECK(extracts(json, "/m~0n", "2"));
+  CHECK(extracts(json, "/\xc3\xa9t\xc3\xa9", "3"));
+  CHECK(extracts(json, "/q\"", "4"));
+  CHECK(extracts(json, "/", "5"));
+  CHECK(extracts(json, "/a/b", NULL));
+  CHECK(extracts(json, "/m~2n", NULL));
+
+  // Malformed along the path fails; malformed elsewhere is never looked at.
+  CHECK(extracts("{\"a\": [1, 2", "/a/1", "2"));
+  CHECK(extracts("{\"a\": [1, 2", "/a/2", NULL));
+  CHECK(extracts("{\"a\" 1}", "/a", NULL));
+}
+
+static void test_typed_reads(void)
+{
+  t_json_slice slice;
+  int i = 0;
+  double d = 0;
+  bool b = false;
+  char buffer[64];
+
+  CHECK(cjson_extract(document, strlen(document), "/ints/3", &slice) == 0);
+  CHECK(cjson_slice_to_int(&slice, &i) == 0 && i == -2147483647 - 1);
+  CHECK(cjson_slice_to_bool(&slice, &b) == -1);
+
+  CHECK(cjson_extract(document, strlen(document), "/flags", &slice) == 0);
+  CHECK(cjson_slice_to_int(&slice, &i) == -1); // does not fit
+  CHECK(cjson_slice_to_double(&slice, &d) == 0 && d == 4294967295.0);
+
+  CHECK(cjson_extract(document, strlen(document), "/active", &slice) == 0);
+  CHECK(cjson_slice_to_bool(&slice, &b) == 0 && b);
+
+  CHECK(cjson_extract(document, strlen(document), "/tags/2", &slice) == 0);
+  CHECK(cjson_slice_to_string(&slice, buffer, sizeof(buffer)) == 8 && strcmp(buffer, "tab\there") == 0);
+  CHECK(cjson_slice_to_string(&slice, buffer, 4) == -1);
+  CHECK(cjson_slice_to_double(&slice, &d) == -1);
+}
+
+int main(void)
+{
+  test_paths();
+  test_escapes();
+  test_typed_reads();
+  return test_report("test_pointer");
+}
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/cjson.h"
+#include "test.h"
+#include "test_models.h"
+
+// The chunk-fed decoder must produce the same instance as cjson_decode however
+// the input is split: at every byte offset, and one byte at a time.
+
+static int stream_decode(t_json_model *model, Sample *out, const char *json, t_size length, t_size split, t_size step)
+{
+  t_json_stream_decoder *decoder = cjson_decoder_new(model, out);
+  if (!decoder)
+    return -1;
+
+  int status = 0;
+  t_size offset = 0;
+  while (status == 0 && offset < length)
+  {
+    t_size chunk = step ? step : (offset < split ? split - offset : length - offset);
+    if (chunk > length - offset)
+      chunk = length - offset;
+    status = cjson_decoder_feed(decoder, json + offset, chunk);
+    offset += chunk;
+  }
+  if (status == 0)
+    status = cjson_decoder_finish(decoder);
+  cjson_decoder_free(decoder);
+  return status;
+}
+
+static void test_splits(t_json_model *model, const char *json)
+{
+  t_size length = strlen(json);
+  Sample expected = {0};
+  CHECK(cjson_decode(json, model, &expected) == 0);
+  char *expected_json = cjson_encode(&expected, model, false);
+
+  int mismatches = 0;
+  for (t_size split = 0; split <= length; split++)
+  {
+    Sample got = {0};
+    int status = stream_decode(model, &got, json, length, split, 0);
+    char *got_json = cjson_encode(&got, model, false);
+    if ((status != 0 || strcmp(got_json, expected_json) != 0) && mismatches++ < 3)
+      fprintf(stderr, "split at %lu: status %d\n%s\n", (unsigned long)split, status, got_json);
+    cjson_free(got_json);
+    cjson_free_instance(&got, model);
+  }
+  CHECK(mismatches == 0);
+
+  Sample bytewise = {0};
+  CHECK(stream_decode(model, &bytewise, json, length, 0, 1) == 0);
+  char *bytewise_json = cjson_encode(&bytewise, model, false);
+  CHECK(strcmp(bytewise_json, expected_json) == 0);
+  cjson_free(bytewise_json);
+  cjson_free_instance(&bytewise, model);
+
+  cjson_free(expected_json);
+  cjson_free_instance(&expected, model);
+}
+
+static void test_errors(t_json_model *model)
+{
+  static const char *bad[] = {"{\"id\": 1", "{\"id\": 1}}", "{\"id\" 1}", "{\"full_name\": \"open",
+                              "{\"flags\": -1}", "{\"code\": \"123456789\"}", "{\"grid\": [1, 2, 3, 4]}", "[1]"};
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+  {
+    Sample got = {0};
+    CHECK(stream_decode(model, &got, bad[i], strlen(bad[i]), 0, 1) != 0);
+    cjson_free_instance(&got, model);
+  }
+}
+
+int main(void)
+{
+  t_json_model *model = sample_model(false);
+  CHECK(model != NULL);
+  if (!model)
+    return test_report("test_stream");
+
+  test_splits(model, sample_json);
+  test_splits(model, "{}");
+  test_errors(model);
+  return test_report("test_stream");
+}
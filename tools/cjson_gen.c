@@ -0,0 +1,958 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+
+// cjson_gen: reads a schema and writes <out>.h / <out>.c with a struct, the
+// usual reflection tables and specialized decode_<Name> / encode_<Name> /
+// free_<Name> functions per struct. The generated code calls the cjson_rt_*
+// helpers (cjson_runtime.h), so it reads and writes the same JSON as
+// cjson_decode / cjson_encode with the same tables.
+//
+// Schema, one declaration per line, '#' starts a comment:
+//
+//   struct Pets
+//     string type json:pet_type
+//     int    age  json:pet_age
+//   end
+//
+//   struct User
+//     string email ignore
+//     Pets[] pets  json:user_pets
+//   end
+//
+// Field types: int double string bool int[] double[] string[], the name of a
+// struct (a pointer to it) or a struct name followed by [] (array of them).
+// The inline option stores a struct field by value and a struct array as
+// contiguous elements; an inline struct must be declared before its user.
+// Sized scalars: int8 int16 int32 int64 uint8 uint16 uint32 uint64 float.
+// char[N] is a NUL-terminated string stored in the struct, and T[N] a C array
+// of any scalar except string (int[16], uint8[4], bool[3]).
+
+#define GEN_MAX_STRUCTS 128
+#define GEN_MAX_FIELDS 256
+#define GEN_MAX_NAME 128
+#define GEN_MAX_COUNT (1 << 20) // char[N] / T[N]; N is packed into the field type
+
+typedef enum
+{
+  GEN_INT,
+  GEN_DOUBLE,
+  GEN_STRING,
+  GEN_BOOL,
+  GEN_ARRAY_INT,
+  GEN_ARRAY_DOUBLE,
+  GEN_ARRAY_STRING,
+  GEN_OBJECT,
+  GEN_ARRAY_OBJECT,
+  GEN_STRUCT,
+  GEN_ARRAY_STRUCT,
+  GEN_INT8,
+  GEN_INT16,
+  GEN_INT32,
+  GEN_INT64,
+  GEN_UINT8,
+  GEN_UINT16,
+  GEN_UINT32,
+  GEN_UINT64,
+  GEN_FLOAT,
+  GEN_CHARS,
+  GEN_FIXED_ARRAY
+} t_gen_kind;
+
+typedef struct
+{
+  t_gen_kind kind;
+  char name[GEN_MAX_NAME];      // C member
+  char json_name[GEN_MAX_NAME]; // key in the document
+  char child[GEN_MAX_NAME];     // struct name for the object and struct kinds
+  t_gen_kind element;           // GEN_FIXED_ARRAY element
+  long count;                   // N of char[N] / T[N]
+  bool has_json_name;
+  bool ignore;
+  int line;
+} t_gen_field;
+
+typedef struct
+{
+  char name[GEN_MAX_NAME];
+  t_gen_field *fields;
+  int field_count;
+  int line;
+} t_gen_struct;
+
+typedef struct
+{
+  t_gen_struct structs[GEN_MAX_STRUCTS];
+  int count;
+} t_gen_schema;
+
+static const struct
+{
+  const char *name;
+  t_gen_kind kind;
+} scalar_types[] = {
+    {"int", GEN_INT},
+    {"double", GEN_DOUBLE},
+    {"string", GEN_STRING},
+    {"bool", GEN_BOOL},
+    {"int[]", GEN_ARRAY_INT},
+    {"double[]", GEN_ARRAY_DOUBLE},
+    {"string[]", GEN_ARRAY_STRING},
+    {"int8", GEN_INT8},
+    {"int16", GEN_INT16},
+    {"int32", GEN_INT32},
+    {"int64", GEN_INT64},
+    {"uint8", GEN_UINT8},
+    {"uint16", GEN_UINT16},
+    {"uint32", GEN_UINT32},
+    {"uint64", GEN_UINT64},
+    {"float", GEN_FLOAT},
+    {NULL, GEN_INT}};
+
+// Fixed-size scalars, which are also the element types a T[N] accepts: the C
+// member type and the kind the runtime takes.
+static const struct
+{
+  t_gen_kind kind;
+  const char *c_type;
+  const char *cjson_kind;
+} number_types[] = {
+    {GEN_INT, "int", "REFLECT_TYPE_INTEGER"},
+    {GEN_DOUBLE, "double", "REFLECT_TYPE_DOUBLE"},
+    {GEN_BOOL, "bool", "REFLECT_TYPE_BOOL"},
+    {GEN_INT8, "int8_t", "CJSON_TYPE_INT8"},
+    {GEN_INT16, "int16_t", "CJSON_TYPE_INT16"},
+    {GEN_INT32, "int32_t", "CJSON_TYPE_INT32"},
+    {GEN_INT64, "int64_t", "CJSON_TYPE_INT64"},
+    {GEN_UINT8, "uint8_t", "CJSON_TYPE_UINT8"},
+    {GEN_UINT16, "uint16_t", "CJSON_TYPE_UINT16"},
+    {GEN_UINT32, "uint32_t", "CJSON_TYPE_UINT32"},
+    {GEN_UINT64, "uint64_t", "CJSON_TYPE_UINT64"},
+    {GEN_FLOAT, "float", "CJSON_TYPE_FLOAT"},
+    {GEN_INT, NULL, NULL}};
+
+static const char *schema_path;
+
+static void fail(int line, const char *message, const char *detail)
+{
+  fprintf(stderr, "%s:%d: %s%s%s\n", schema_path, line, message, detail ? ": " : "", detail ? detail : "");
+  exit(1);
+}
+
+static bool is_identifier(const char *text)
+{
+  if (!isalpha((unsigned char)text[0]) && text[0] != '_')
+    return false;
+  for (const char *p = text + 1; *p; p++)
+  {
+    if (!isalnum((unsigned char)*p) && *p != '_')
+      return false;
+  }
+  return true;
+}
+
+static void copy_name(char *dest, const char *src, int line)
+{
+  if (strlen(src) >= GEN_MAX_NAME)
+    fail(line, "name too long", src);
+  strcpy(dest, src);
+}
+
+// NULL when kind is not a fixed-size scalar.
+static const char *number_c_type(t_gen_kind kind)
+{
+  for (int i = 0; number_types[i].c_type; i++)
+  {
+    if (number_types[i].kind == kind)
+      return number_types[i].c_type;
+  }
+  return NULL;
+}
+
+static const char *number_cjson_kind(t_gen_kind kind)
+{
+  for (int i = 0; number_types[i].c_type; i++)
+  {
+    if (number_types[i].kind == kind)
+      return number_types[i].cjson_kind;
+  }
+  return NULL;
+}
+
+static t_gen_struct *find_struct(t_gen_schema *schema, const char *name)
+{
+  for (int i = 0; i < schema->count; i++)
+  {
+    if (strcmp(schema->structs[i].name, name) == 0)
+      return &schema->structs[i];
+  }
+  return NULL;
+}
+
+// Splits line in place on whitespace; returns the number of tokens.
+static int tokenize(char *line, char **tokens, int max)
+{
+  int count = 0;
+  char *p = line;
+
+  while (*p && count < max)
+  {
+    while (isspace((unsigned char)*p))
+      p++;
+    if (*p == '\0' || *p == '#')
+      break;
+    tokens[count++] = p;
+    while (*p && !isspace((unsigned char)*p))
+      p++;
+    if (*p)
+      *p++ = '\0';
+  }
+  return count;
+}
+
+// "<base>[N]": char[N] or a fixed array of a number type. false when type has
+// no [N] suffix.
+static bool parse_sized_type(t_gen_field *field, const char *type, int line)
+{
+  const char *open = strchr(type, '[');
+  size_t length = strlen(type);
+  if (!open || open == type || type[length - 1] != ']' || open + 1 == type + length - 1)
+    return false;
+
+  char *digits_end;
+  long count = strtol(open + 1, &digits_end, 10);
+  if (!isdigit((unsigned char)open[1]) || digits_end != type + length - 1)
+    return false;
+  if (count < 1 || count > GEN_MAX_COUNT)
+    fail(line, "array length out of range", type);
+
+  char base[GEN_MAX_NAME];
+  if ((size_t)(open - type) >= GEN_MAX_NAME)
+    fail(line, "name too long", type);
+  memcpy(base, type, open - type);
+  base[open - type] = '\0';
+  field->count = count;
+
+  if (strcmp(base, "char") == 0)
+  {
+    field->kind = GEN_CHARS;
+    return true;
+  }
+
+  for (int i = 0; scalar_types[i].name; i++)
+  {
+    if (strcmp(base, scalar_types[i].name) == 0 && number_c_type(scalar_types[i].kind))
+    {
+      field->kind = GEN_FIXED_ARRAY;
+      field->element = scalar_types[i].kind;
+      return true;
+    }
+  }
+  fail(line, "fixed arrays hold numbers or bools", type);
+  return false;
+}
+
+static void parse_field(t_gen_field *field, char **tokens, int count, int line)
+{
+  memset(field, 0, sizeof(*field));
+  field->line = line;
+
+  const char *type = tokens[0];
+  int i;
+  for (i = 0; scalar_types[i].name; i++)
+  {
+    if (strcmp(type, scalar_types[i].name) == 0)
+    {
+      field->kind = scalar_types[i].kind;
+      break;
+    }
+  }
+
+  if (!scalar_types[i].name && !parse_sized_type(field, type, line))
+  {
+    size_t length = strlen(type);
+    bool is_array = length > 2 && strcmp(type + length - 2, "[]") == 0;
+    if (is_array)
+      length -= 2;
+    if (length >= GEN_MAX_NAME)
+      fail(line, "name too long", type);
+    memcpy(field->child, type, length);
+    field->child[length] = '\0';
+    if (!is_identifier(field->child))
+      fail(line, "unknown field type", type);
+    field->kind = is_array ? GEN_ARRAY_OBJECT : GEN_OBJECT;
+  }
+
+  if (count < 2 || !is_identifier(tokens[1]))
+    fail(line, "expected a field name after the type", count < 2 ? NULL : tokens[1]);
+  copy_name(field->name, tokens[1], line);
+  copy_name(field->json_name, tokens[1], line);
+
+  for (i = 2; i < count; i++)
+  {
+    if (strncmp(tokens[i], "json:", 5) == 0 && tokens[i][5] != '\0')
+    {
+      copy_name(field->json_name, tokens[i] + 5, line);
+      field->has_json_name = true;
+    }
+    else if (strcmp(tokens[i], "ignore") == 0)
+      field->ignore = true;
+    else if (strcmp(tokens[i], "inline") == 0 && field->kind == GEN_OBJECT)
+      field->kind = GEN_STRUCT;
+    else if (strcmp(tokens[i], "inline") == 0 && field->kind == GEN_ARRAY_OBJECT)
+      field->kind = GEN_ARRAY_STRUCT;
+    else
+      fail(line, "unknown field option", tokens[i]);
+  }
+}
+
+static void parse_schema(FILE *in, t_gen_schema *schema)
+{
+  char buffer[1024];
+  char *tokens[8];
+  t_gen_struct *current = NULL;
+  int line = 0;
+
+  while (fgets(buffer, sizeof(buffer), in))
+  {
+    line++;
+    if (!strchr(buffer, '\n') && !feof(in))
+      fail(line, "line too long", NULL);
+
+    int count = tokenize(buffer, tokens, 8);
+    if (count == 0)
+      continue;
+
+    if (strcmp(tokens[0], "struct") == 0)
+    {
+      if (current)
+        fail(line, "missing 'end' before", "struct");
+      if (count != 2 || !is_identifier(tokens[1]))
+        fail(line, "expected 'struct <Name>'", NULL);
+      if (find_struct(schema, tokens[1]))
+        fail(line, "duplicate struct", tokens[1]);
+      if (schema->count == GEN_MAX_STRUCTS)
+        fail(line, "too many structs", NULL);
+
+      current = &schema->structs[schema->count++];
+      copy_name(current->name, tokens[1], line);
+      current->fields = calloc(GEN_MAX_FIELDS, sizeof(t_gen_field));
+      if (!current->fields)
+        fail(line, "out of memory", NULL);
+      current->line = line;
+    }
+    else if (strcmp(tokens[0], "end") == 0)
+    {
+      if (!current)
+        fail(line, "'end' outside of a struct", NULL);
+      current = NULL;
+    }
+    else
+    {
+      if (!current)
+        fail(line, "field outside of a struct", tokens[0]);
+      if (current->field_count == GEN_MAX_FIELDS)
+        fail(line, "too many fields", NULL);
+      parse_field(&current->fields[current->field_count++], tokens, count, line);
+    }
+  }
+
+  if (current)
+    fail(current->line, "missing 'end' for struct", current->name);
+
+  for (int s = 0; s < schema->count; s++)
+  {
+    t_gen_struct *st = &schema->structs[s];
+    for (int f = 0; f < st->field_count; f++)
+    {
+      t_gen_field *field = &st->fields[f];
+      bool has_child = field->kind == GEN_OBJECT || field->kind == GEN_ARRAY_OBJECT || field->kind == GEN_STRUCT ||
+                       field->kind == GEN_ARRAY_STRUCT;
+      if (has_child && !find_struct(schema, field->child))
+        fail(field->line, "unknown struct", field->child);
+      // Members are emitted in schema order, so an embedded struct must be complete first.
+      if (field->kind == GEN_STRUCT && find_struct(schema, field->child) >= st)
+        fail(field->line, "inline struct must be declared earlier", field->child);
+      for (int g = 0; g < f; g++)
+      {
+        if (strcmp(st->fields[g].name, field->name) == 0)
+          fail(field->line, "duplicate field", field->name);
+      }
+    }
+  }
+}
+
+// --- Output helpers ---
+
+// text as a C string literal body.
+static void write_c_escaped(FILE *out, const char *text)
+{
+  for (const unsigned char *p = (const unsigned char *)text; *p; p++)
+  {
+    if (*p == '"' || *p == '\\')
+      fprintf(out, "\\%c", *p);
+    else if (*p < 0x20 || *p >= 0x7F)
+      fprintf(out, "\\%03o", *p);
+    else
+      fputc(*p, out);
+  }
+}
+
+// "key": as the encoder writes it (JSON-escaped, pretty form), as a C literal
+// body; returns its length in bytes.
+static size_t write_key_fragment(FILE *out, const char *key)
+{
+  static const char hex[] = "0123456789abcdef";
+  char fragment[GEN_MAX_NAME * 6 + 4];
+  size_t length = 0;
+
+  fragment[length++] = '"';
+  for (const unsigned char *p = (const unsigned char *)key; *p; p++)
+  {
+    if (*p == '"' || *p == '\\')
+    {
+      fragment[length++] = '\\';
+      fragment[length++] = (char)*p;
+    }
+    else if (*p < 0x20)
+    {
+      memcpy(fragment + length, "\\u00", 4);
+      fragment[length + 4] = hex[*p >> 4];
+      fragment[length + 5] = hex[*p & 0xF];
+      length += 6;
+    }
+    else
+    {
+      fragment[length++] = (char)*p;
+    }
+  }
+  memcpy(fragment + length, "\": ", 3);
+  length += 3;
+  fragment[length] = '\0';
+
+  write_c_escaped(out, fragment);
+  return length;
+}
+
+static const char *reflect_type_name(t_gen_kind kind)
+{
+  switch (kind)
+  {
+  case GEN_INT:
+    return "REFLECT_TYPE_INTEGER";
+  case GEN_DOUBLE:
+    return "REFLECT_TYPE_DOUBLE";
+  case GEN_STRING:
+    return "REFLECT_TYPE_STRING";
+  case GEN_BOOL:
+    return "REFLECT_TYPE_BOOL";
+  case GEN_ARRAY_INT:
+    return "REFLECT_TYPE_ARRAY_INT";
+  case GEN_ARRAY_DOUBLE:
+    return "REFLECT_TYPE_ARRAY_DOUBLE";
+  case GEN_ARRAY_STRING:
+    return "REFLECT_TYPE_ARRAY_STRING";
+  case GEN_OBJECT:
+    return "REFLECT_TYPE_OBJECT";
+  case GEN_ARRAY_OBJECT:
+    return "REFLECT_TYPE_ARRAY_OBJECT";
+  case GEN_STRUCT:
+    return "CJSON_FIELD_TYPE(CJSON_TYPE_STRUCT)";
+  case GEN_ARRAY_STRUCT:
+    return "CJSON_FIELD_TYPE(CJSON_TYPE_ARRAY_STRUCT)";
+  default:
+    break;
+  }
+  return "REFLECT_TYPE_INTEGER";
+}
+
+static void write_reflect_type(FILE *out, const t_gen_field *field)
+{
+  if (field->kind == GEN_CHARS)
+    fprintf(out, "CJSON_FIELD_CHARS(%ld)", field->count);
+  else if (field->kind == GEN_FIXED_ARRAY)
+    fprintf(out, "CJSON_FIELD_ARRAY_OF(%s, %ld)", number_cjson_kind(field->element), field->count);
+  else if (field->kind >= GEN_INT8 && field->kind <= GEN_FLOAT)
+    fprintf(out, "CJSON_FIELD_TYPE(%s)", number_cjson_kind(field->kind));
+  else
+    fprintf(out, "%s", reflect_type_name(field->kind));
+}
+
+static void write_member(FILE *out, const t_gen_field *field)
+{
+  switch (field->kind)
+  {
+  case GEN_INT:
+    fprintf(out, "  int %s;\n", field->name);
+    break;
+  case GEN_DOUBLE:
+    fprintf(out, "  double %s;\n", field->name);
+    break;
+  case GEN_STRING:
+    fprintf(out, "  char *%s;\n", field->name);
+    break;
+  case GEN_BOOL:
+    fprintf(out, "  bool %s;\n", field->name);
+    break;
+  case GEN_OBJECT:
+    fprintf(out, "  %s *%s;\n", field->child, field->name);
+    break;
+  case GEN_STRUCT:
+    fprintf(out, "  %s %s;\n", field->child, field->name);
+    break;
+  case GEN_CHARS:
+    fprintf(out, "  char %s[%ld];\n", field->name, field->count);
+    break;
+  case GEN_FIXED_ARRAY:
+    fprintf(out, "  %s %s[%ld];\n", number_c_type(field->element), field->name, field->count);
+    break;
+  case GEN_INT8:
+  case GEN_INT16:
+  case GEN_INT32:
+  case GEN_INT64:
+  case GEN_UINT8:
+  case GEN_UINT16:
+  case GEN_UINT32:
+  case GEN_UINT64:
+  case GEN_FLOAT:
+    fprintf(out, "  %s %s;\n", number_c_type(field->kind), field->name);
+    break;
+  default:
+    fprintf(out, "  Array *%s;\n", field->name);
+    break;
+  }
+}
+
+// --- Header ---
+
+static void write_header(FILE *out, const t_gen_schema *schema, const char *guard, const char *source)
+{
+  fprintf(out, "// Generated by cjson_gen from %s. Do not edit.\n", source);
+  fprintf(out, "#ifndef %s\n#define %s\n", guard, guard);
+  fprintf(out, "#include <stdint.h>\n#include \"cjson.h\"\n#include \"dynamic_array.h\"\n\n");
+
+  for (int s = 0; s < schema->count; s++)
+    fprintf(out, "typedef struct s_%s %s;\n", schema->structs[s].name, schema->structs[s].name);
+
+  for (int s = 0; s < schema->count; s++)
+  {
+    const t_gen_struct *st = &schema->structs[s];
+    fprintf(out, "\nstruct s_%s\n{\n", st->name);
+    for (int f = 0; f < st->field_count; f++)
+      write_member(out, &st->fields[f]);
+    fprintf(out, "};\n");
+  }
+
+  for (int s = 0; s < schema->count; s++)
+  {
+    const char *name = schema->structs[s].name;
+    fprintf(out, "\n// Tables for cjson_create_model, when %s also goes through the generic API.\n", name);
+    fprintf(out, "extern t_reflect_field %s_fields[];\n", name);
+    fprintf(out, "extern t_json_field_config %s_json_fields[];\n", name);
+    fprintf(out, "int decode_%s(const char *json, t_size len, %s *out);\n", name, name);
+    fprintf(out, "char *encode_%s(const %s *in, bool pretty);\n", name, name);
+    fprintf(out, "void free_%s(%s *in); // members only, like cjson_free_instance\n", name, name);
+  }
+
+  fprintf(out, "\n#endif\n");
+}
+
+// --- Source ---
+
+static void write_tables(FILE *out, const t_gen_struct *st)
+{
+  fprintf(out, "t_reflect_field %s_fields[] = {\n", st->name);
+  for (int f = 0; f < st->field_count; f++)
+  {
+    const t_gen_field *field = &st->fields[f];
+    fprintf(out, "    {\"%s\", ", field->name);
+    write_reflect_type(out, field);
+    fprintf(out, ", REFLECT_OFFSET(%s, %s), NULL},\n", st->name, field->name);
+  }
+  fprintf(out, "    NO_MORE_FIELDS};\n\n");
+
+  fprintf(out, "t_json_field_config %s_json_fields[] = {\n", st->name);
+  for (int f = 0; f < st->field_count; f++)
+  {
+    const t_gen_field *field = &st->fields[f];
+    fprintf(out, "    {\"%s\", ", field->name);
+    if (field->has_json_name)
+    {
+      fputc('"', out);
+      write_c_escaped(out, field->json_name);
+      fputc('"', out);
+    }
+    else
+    {
+      fprintf(out, "NULL");
+    }
+    fprintf(out, ", %s},\n", field->ignore ? "true" : "false");
+  }
+  fprintf(out, "    NO_MORE_FIELDS};\n\n");
+}
+
+static void write_decode_call(FILE *out, const t_gen_field *field)
+{
+  const char *m = field->name;
+  switch (field->kind)
+  {
+  case GEN_INT:
+    fprintf(out, "cjson_rt_int(ctx, cursor, &out->%s);\n", m);
+    break;
+  case GEN_DOUBLE:
+    fprintf(out, "cjson_rt_double(ctx, cursor, &out->%s);\n", m);
+    break;
+  case GEN_STRING:
+    fprintf(out, "cjson_rt_string(ctx, cursor, &out->%s);\n", m);
+    break;
+  case GEN_BOOL:
+    fprintf(out, "cjson_rt_bool(ctx, cursor, &out->%s);\n", m);
+    break;
+  case GEN_ARRAY_INT:
+    fprintf(out, "cjson_rt_int_array(ctx, cursor, &out->%s);\n", m);
+    break;
+  case GEN_ARRAY_DOUBLE:
+    fprintf(out, "cjson_rt_double_array(ctx, cursor, &out->%s);\n", m);
+    break;
+  case GEN_ARRAY_STRING:
+    fprintf(out, "cjson_rt_string_array(ctx, cursor, &out->%s);\n", m);
+    break;
+  case GEN_OBJECT:
+    fprintf(out, "cjson_rt_object(ctx, cursor, (void **)&out->%s, sizeof(%s), decode_%s_object);\n", m, field->child,
+            field->child);
+    break;
+  case GEN_ARRAY_OBJECT:
+    fprintf(out, "cjson_rt_object_array(ctx, cursor, &out->%s, sizeof(%s), decode_%s_object);\n", m, field->child,
+            field->child);
+    break;
+  case GEN_STRUCT:
+    fprintf(out, "cjson_rt_struct(ctx, cursor, &out->%s, decode_%s_object);\n", m, field->child);
+    break;
+  case GEN_ARRAY_STRUCT:
+    fprintf(out, "cjson_rt_struct_array(ctx, cursor, &out->%s, sizeof(%s), decode_%s_object);\n", m, field->child,
+            field->child);
+    break;
+  case GEN_CHARS:
+    fprintf(out, "cjson_rt_chars(ctx, cursor, out->%s, sizeof(out->%s));\n", m, m);
+    break;
+  case GEN_FIXED_ARRAY:
+    fprintf(out, "cjson_rt_fixed_array(ctx, cursor, out->%s, %s, %ld);\n", m, number_cjson_kind(field->element),
+            field->count);
+    break;
+  default:
+    fprintf(out, "cjson_rt_number(ctx, cursor, &out->%s, %s);\n", m, number_cjson_kind(field->kind));
+    break;
+  }
+}
+
+// Is field the first decodable one with its json name? Later ones never match,
+// as in cjson_decode.
+static bool first_with_key(const t_gen_struct *st, int index)
+{
+  for (int g = 0; g < index; g++)
+  {
+    if (!st->fields[g].ignore && strcmp(st->fields[g].json_name, st->fields[index].json_name) == 0)
+      return false;
+  }
+  return true;
+}
+
+static void write_decoder(FILE *out, const t_gen_struct *st)
+{
+  fprintf(out, "static int decode_%s_object(t_json_decode_ctx *ctx, const char **cursor, void *instance)\n{\n", st->name);
+
+  bool any = false;
+  for (int f = 0; f < st->field_count; f++)
+    any = any || !st->fields[f].ignore;
+
+  if (any)
+    fprintf(out, "  %s *out = instance;\n", st->name);
+  else
+    fprintf(out, "  (void)instance;\n");
+  fprintf(out, "  t_json_slice key;\n  int status;\n\n");
+  fprintf(out, "  if (cjson_rt_object_begin(ctx, cursor) != 0)\n    return -1;\n\n");
+  fprintf(out, "  while ((status = cjson_rt_object_key(ctx, cursor, &key)) > 0)\n  {\n");
+
+  if (any)
+  {
+    // Keys grouped by length, then compared in full.
+    fprintf(out, "    switch (key.length)\n    {\n");
+    bool *done = calloc((size_t)st->field_count, sizeof(bool));
+    if (!done)
+      fail(st->line, "out of memory", NULL);
+
+    for (int f = 0; f < st->field_count; f++)
+    {
+      const t_gen_field *field = &st->fields[f];
+      if (done[f] || field->ignore)
+        continue;
+
+      size_t length = strlen(field->json_name);
+      fprintf(out, "    case %zu:\n", length);
+      for (int g = f; g < st->field_count; g++)
+      {
+        const t_gen_field *other = &st->fields[g];
+        if (done[g] || other->ignore || strlen(other->json_name) != length)
+          continue;
+        done[g] = true;
+        if (!first_with_key(st, g))
+          continue;
+
+        fprintf(out, "      if (memcmp(key.ptr, \"");
+        write_c_escaped(out, other->json_name);
+        fprintf(out, "\", %zu) == 0)\n      {\n        ", length);
+        write_decode_call(out, other);
+        fprintf(out, "        continue;\n      }\n");
+      }
+      fprintf(out, "      break;\n");
+    }
+    free(done);
+    fprintf(out, "    default:\n      break;\n    }\n");
+  }
+
+  fprintf(out, "    cjson_rt_skip(ctx, cursor);\n  }\n  return status;\n}\n\n");
+}
+
+static void write_encode_value(FILE *out, const t_gen_field *field)
+{
+  const char *m = field->name;
+  switch (field->kind)
+  {
+  case GEN_INT:
+    fprintf(out, "  cjson_rt_write_int(w, in->%s);\n", m);
+    break;
+  case GEN_DOUBLE:
+    fprintf(out, "  cjson_rt_write_double(w, in->%s);\n", m);
+    break;
+  case GEN_STRING:
+    fprintf(out, "  cjson_rt_write_string(w, in->%s);\n", m);
+    break;
+  case GEN_BOOL:
+    fprintf(out, "  cjson_rt_write_bool(w, in->%s);\n", m);
+    break;
+  case GEN_ARRAY_INT:
+    fprintf(out, "  cjson_rt_write_int_array(w, in->%s);\n", m);
+    break;
+  case GEN_ARRAY_DOUBLE:
+    fprintf(out, "  cjson_rt_write_double_array(w, in->%s);\n", m);
+    break;
+  case GEN_ARRAY_STRING:
+    fprintf(out, "  cjson_rt_write_string_array(w, in->%s);\n", m);
+    break;
+  case GEN_OBJECT:
+    fprintf(out, "  cjson_rt_write_object(w, in->%s, encode_%s_object, pretty, depth);\n", m, field->child);
+    break;
+  case GEN_ARRAY_OBJECT:
+    fprintf(out, "  cjson_rt_write_object_array(w, in->%s, encode_%s_object, pretty, depth);\n", m, field->child);
+    break;
+  case GEN_STRUCT:
+    fprintf(out, "  cjson_rt_write_struct(w, &in->%s, encode_%s_object, pretty, depth);\n", m, field->child);
+    break;
+  case GEN_ARRAY_STRUCT:
+    fprintf(out, "  cjson_rt_write_struct_array(w, in->%s, encode_%s_object, pretty, depth);\n", m, field->child);
+    break;
+  case GEN_CHARS:
+    fprintf(out, "  cjson_rt_write_chars(w, in->%s, sizeof(in->%s));\n", m, m);
+    break;
+  case GEN_FIXED_ARRAY:
+    fprintf(out, "  cjson_rt_write_fixed_array(w, in->%s, %s, %ld);\n", m, number_cjson_kind(field->element),
+            field->count);
+    break;
+  default:
+    fprintf(out, "  cjson_rt_write_number(w, &in->%s, %s);\n", m, number_cjson_kind(field->kind));
+    break;
+  }
+}
+
+// Same layout as cjson_encode: members on their own lines when pretty, ": "
+// after keys when pretty and ":" otherwise.
+static void write_encoder(FILE *out, const t_gen_struct *st)
+{
+  fprintf(out, "static void encode_%s_object(t_json_writer *w, const void *instance, bool pretty, int depth)\n{\n",
+          st->name);
+
+  bool any = false;
+  for (int f = 0; f < st->field_count; f++)
+    any = any || !st->fields[f].ignore;
+
+  if (any)
+    fprintf(out, "  const %s *in = instance;\n\n", st->name);
+  else
+    fprintf(out, "  (void)instance;\n\n");
+  fprintf(out, "  cjson_rt_write_raw(w, \"{\\n\", pretty ? 2 : 1);\n");
+
+  bool first = true;
+  for (int f = 0; f < st->field_count; f++)
+  {
+    const t_gen_field *field = &st->fields[f];
+    if (field->ignore)
+      continue;
+
+    fprintf(out, "\n");
+    if (!first)
+      fprintf(out, "  cjson_rt_write_raw(w, \",\\n\", pretty ? 2 : 1);\n");
+    first = false;
+
+    fprintf(out, "  if (pretty)\n    cjson_rt_write_indent(w, depth + 1);\n");
+    fprintf(out, "  cjson_rt_write_raw(w, \"");
+    size_t length = write_key_fragment(out, field->json_name);
+    fprintf(out, "\", pretty ? %zu : %zu);\n", length, length - 1);
+    write_encode_value(out, field);
+  }
+
+  fprintf(out, "\n  if (pretty)\n  {\n    cjson_rt_write_raw(w, \"\\n\", 1);\n    cjson_rt_write_indent(w, depth);\n  }\n");
+  fprintf(out, "  cjson_rt_write_raw(w, \"}\", 1);\n}\n\n");
+}
+
+static void write_free(FILE *out, const t_gen_struct *st)
+{
+  fprintf(out, "void free_%s(%s *in)\n{\n  if (!in)\n    return;\n", st->name, st->name);
+
+  for (int f = 0; f < st->field_count; f++)
+  {
+    const t_gen_field *field = &st->fields[f];
+    const char *m = field->name;
+    switch (field->kind)
+    {
+    case GEN_STRING:
+      fprintf(out, "  allocator_free(NULL, in->%s);\n  in->%s = NULL;\n", m, m);
+      break;
+    case GEN_ARRAY_INT:
+    case GEN_ARRAY_DOUBLE:
+      fprintf(out, "  if (in->%s)\n    array_free(in->%s);\n  in->%s = NULL;\n", m, m, m);
+      break;
+    case GEN_ARRAY_STRING:
+      fprintf(out, "  if (in->%s)\n  {\n", m);
+      fprintf(out, "    for (t_size i = 0; i < in->%s->count; i++)\n      allocator_free(NULL, ((char **)in->%s->data)[i]);\n", m, m);
+      fprintf(out, "    array_free(in->%s);\n    in->%s = NULL;\n  }\n", m, m);
+      break;
+    case GEN_OBJECT:
+      fprintf(out, "  if (in->%s)\n  {\n    free_%s(in->%s);\n    allocator_free(NULL, in->%s);\n    in->%s = NULL;\n  }\n", m,
+              field->child, m, m, m);
+      break;
+    case GEN_ARRAY_OBJECT:
+      fprintf(out, "  if (in->%s)\n  {\n", m);
+      fprintf(out, "    for (t_size i = 0; i < in->%s->count; i++)\n    {\n", m);
+      fprintf(out, "      %s *item = ((%s **)in->%s->data)[i];\n", field->child, field->child, m);
+      fprintf(out, "      free_%s(item);\n      allocator_free(NULL, item);\n    }\n", field->child);
+      fprintf(out, "    array_free(in->%s);\n    in->%s = NULL;\n  }\n", m, m);
+      break;
+    case GEN_STRUCT:
+      fprintf(out, "  free_%s(&in->%s);\n", field->child, m);
+      break;
+    case GEN_ARRAY_STRUCT:
+      fprintf(out, "  if (in->%s)\n  {\n", m);
+      fprintf(out, "    for (t_size i = 0; i < in->%s->count; i++)\n      free_%s(&((%s *)in->%s->data)[i]);\n", m,
+              field->child, field->child, m);
+      fprintf(out, "    array_free(in->%s);\n    in->%s = NULL;\n  }\n", m, m);
+      break;
+    default:
+      break;
+    }
+  }
+  fprintf(out, "}\n\n");
+}
+
+static void write_source(FILE *out, const t_gen_schema *schema, const char *header, const char *source)
+{
+  fprintf(out, "// Generated by cjson_gen from %s. Do not edit.\n", source);
+  fprintf(out, "#include <stdlib.h>\n#include <string.h>\n#include \"cjson_runtime.h\"\n#include \"%s\"\n\n", header);
+
+  for (int s = 0; s < schema->count; s++)
+  {
+    const char *name = schema->structs[s].name;
+    fprintf(out, "static int decode_%s_object(t_json_decode_ctx *ctx, const char **cursor, void *instance);\n", name);
+    fprintf(out, "static void encode_%s_object(t_json_writer *w, const void *instance, bool pretty, int depth);\n", name);
+  }
+  fprintf(out, "\n");
+
+  for (int s = 0; s < schema->count; s++)
+  {
+    const t_gen_struct *st = &schema->structs[s];
+    write_tables(out, st);
+    write_decoder(out, st);
+    write_encoder(out, st);
+    write_free(out, st);
+
+    fprintf(out, "int decode_%s(const char *json, t_size len, %s *out)\n{\n", st->name, st->name);
+    fprintf(out, "  return cjson_decode_with(json, len, decode_%s_object, out);\n}\n\n", st->name);
+    fprintf(out, "char *encode_%s(const %s *in, bool pretty)\n{\n", st->name, st->name);
+    fprintf(out, "  return cjson_encode_with(encode_%s_object, in, pretty);\n}\n", st->name);
+    if (s + 1 < schema->count)
+      fprintf(out, "\n");
+  }
+}
+
+static const char *base_name(const char *path)
+{
+  const char *slash = strrchr(path, '/');
+  const char *backslash = strrchr(path, '\\');
+  if (backslash && (!slash || backslash > slash))
+    slash = backslash;
+  return slash ? slash + 1 : path;
+}
+
+static FILE *open_output(const char *prefix, const char *extension, char *path, size_t capacity)
+{
+  if ((size_t)snprintf(path, capacity, "%s%s", prefix, extension) >= capacity)
+  {
+    fprintf(stderr, "cjson_gen: output path too long\n");
+    exit(1);
+  }
+  FILE *file = fopen(path, "w");
+  if (!file)
+  {
+    perror(path);
+    exit(1);
+  }
+  return file;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 3)
+  {
+    fprintf(stderr, "usage: %s <schema> <output prefix>\n", argv[0]);
+    fprintf(stderr, "  writes <output prefix>.h and <output prefix>.c\n");
+    return 1;
+  }
+
+  schema_path = argv[1];
+  FILE *in = fopen(schema_path, "r");
+  if (!in)
+  {
+    perror(schema_path);
+    return 1;
+  }
+
+  static t_gen_schema schema;
+  parse_schema(in, &schema);
+  fclose(in);
+
+  const char *prefix = argv[2];
+  const char *source = base_name(schema_path);
+  char header_path[1024], source_path[1024], guard[GEN_MAX_NAME + 8];
+
+  // Include guard from the output file name: user_gen -> USER_GEN_H
+  const char *name = base_name(prefix);
+  size_t length = 0;
+  if (!isalpha((unsigned char)name[0]))
+    guard[length++] = '_';
+  for (const char *p = name; *p && length < GEN_MAX_NAME; p++)
+    guard[length++] = isalnum((unsigned char)*p) ? (char)toupper((unsigned char)*p) : '_';
+  strcpy(guard + length, "_H");
+
+  FILE *header = open_output(prefix, ".h", header_path, sizeof(header_path));
+  write_header(header, &schema, guard, source);
+  fclose(header);
+
+  FILE *out = open_output(prefix, ".c", source_path, sizeof(source_path));
+  write_source(out, &schema, base_name(header_path), source);
+  fclose(out);
+
+  for (int s = 0; s < schema.count; s++)
+    free(schema.structs[s].fields);
+  return 0;
+}